@@ -12,6 +12,7 @@
 #include "settings.h"
 
 #include <cstring>
+#include <future>
 #include <esp_log.h>
 #include <esp_timer.h>
 #include <cJSON.h>
@@ -245,7 +246,7 @@ void Application::ShowActivationCode(const std::string& code, const std::string&
         digit_sound{'9', Lang::Sounds::P3_9}
     }};
 
-    // This sentence uses 9KB of SRAM, so we need to wait for it to finish
+    // 提示音按顺序排队, 数字在激活提示之后依次播放
     Alert(Lang::Strings::ACTIVATION, message.c_str(), "happy", Lang::Sounds::P3_ACTIVATION);
 
     for (const auto& digit : code) {
@@ -280,6 +281,10 @@ void Application::DismissAlert() {
 
 void Application::ToggleChatState() {
     ESP_LOGI(TAG, "[ToggleChatState] >> Enter, state=%d", device_state_);
+    if (loopback_testing_) {
+        ESP_LOGW(TAG, "Loopback test running, ignoring %s", __func__);
+        return;
+    }
     if (device_state_ == kDeviceStateActivating) {
         SetDeviceState(kDeviceStateIdle);
         ESP_LOGI(TAG, "[ToggleChatState] << Exit (Activating->Idle)");
@@ -339,6 +344,10 @@ void Application::ToggleChatState() {
 }
 
 void Application::StartListening() {
+    if (loopback_testing_) {
+        ESP_LOGW(TAG, "Loopback test running, ignoring %s", __func__);
+        return;
+    }
     if (device_state_ == kDeviceStateActivating) {
         SetDeviceState(kDeviceStateIdle);
         return;
@@ -372,7 +381,39 @@ void Application::StartListening() {
     }
 }
 
+bool Application::RunAudioLoopbackTest(LoopbackTestResult& result) {
+    // Runs on the tool call thread: the device state is only changed on the main loop, the test blocks here
+    DeviceState previous_state = kDeviceStateUnknown;
+    bool started = false;
+    ScheduleAndWait([this, &previous_state, &started]() {
+        previous_state = device_state_;
+        if (!loopback_testing_ && (previous_state == kDeviceStateIdle || previous_state == kDeviceStateListening)) {
+            // The BOOT-button audio test also uses AudioTesting, the buttons must not end this one as if it were that
+            loopback_testing_ = true;
+            SetDeviceState(kDeviceStateAudioTesting);
+            started = true;
+        }
+    });
+    if (!started) {
+        result.error = "device busy";
+        return false;
+    }
+
+    bool success = audio_service_.RunLoopbackTest(result);
+    ScheduleAndWait([this, previous_state]() {
+        loopback_testing_ = false;
+        if (device_state_ == kDeviceStateAudioTesting) {
+            SetDeviceState(previous_state);
+        }
+    });
+    return success;
+}
+
 void Application::StopListening() {
+    if (loopback_testing_) {
+        ESP_LOGW(TAG, "Loopback test running, ignoring %s", __func__);
+        return;
+    }
     if (device_state_ == kDeviceStateAudioTesting) {
         audio_service_.EnableAudioTesting(false);
         SetDeviceState(kDeviceStateWifiConfiguring);
@@ -437,6 +478,13 @@ void Application::Start() {
     
     audio_service_.Start();
 
+    // Short acknowledgements start without Opus decoding on first use (no-op without PSRAM)
+    audio_service_.WarmUpPromptCache({
+        Lang::Sounds::P3_POPUP, Lang::Sounds::P3_SUCCESS, Lang::Sounds::P3_EXCLAMATION, Lang::Sounds::P3_VIBRATION,
+        Lang::Sounds::P3_0, Lang::Sounds::P3_1, Lang::Sounds::P3_2, Lang::Sounds::P3_3, Lang::Sounds::P3_4,
+        Lang::Sounds::P3_5, Lang::Sounds::P3_6, Lang::Sounds::P3_7, Lang::Sounds::P3_8, Lang::Sounds::P3_9,
+    });
+
     AudioServiceCallbacks callbacks;
     callbacks.on_send_queue_available = [this]() {
         xEventGroupSetBits(event_group_, MAIN_EVENT_SEND_AUDIO);
@@ -484,7 +532,11 @@ void Application::Start() {
         last_error_message_ = message;
         xEventGroupSetBits(event_group_, MAIN_EVENT_ERROR);
     });
-    protocol_->OnIncomingAudio([this](std::unique_ptr<AudioStreamPacket> packet) {
+    protocol_->OnIncomingAudio([this](AudioStreamPacketPtr packet) {
+        if (aborted_) {
+            // 已中止的回复在服务器停止发送前还会到达一些数据包
+            return;
+        }
         // 接受 Speaking, Idle, 或 Listening 状态的音频
         // Listening/Idle 状态：刚收到 AUDIO_START 但 Schedule 还没执行完
         if (device_state_ == kDeviceStateSpeaking ||
@@ -509,6 +561,8 @@ void Application::Start() {
             ESP_LOGW(TAG, "Server sample rate %d does not match device output sample rate %d, resampling may cause distortion",
                 protocol_->server_sample_rate(), codec->output_sample_rate());
         }
+        // 上行编码与音频处理器改用本会话协商的帧时长, 下行由数据包自带
+        audio_service_.SetFrameDuration(protocol_->server_frame_duration());
     });
     protocol_->OnAudioChannelClosed([this, &board]() {
         board.SetPowerSaveMode(true);
@@ -531,10 +585,11 @@ void Application::Start() {
         if (strcmp(type->valuestring, "tts") == 0) {
             auto state = cJSON_GetObjectItem(root, "state");
             if (strcmp(state->valuestring, "start") == 0) {
+                // 新回复的音频紧跟在 tts start 之后, 必须在这里立即恢复接收
+                aborted_ = false;
                 // 开始预缓冲：收到足够音频数据后再播放，避免断断续续
                 audio_service_.StartPrebuffering();
                 Schedule([this]() {
-                    aborted_ = false;
                     if (device_state_ == kDeviceStateIdle || device_state_ == kDeviceStateListening) {
                         SetDeviceState(kDeviceStateSpeaking);
                     }
@@ -714,6 +769,16 @@ void Application::Schedule(std::function<void()> callback) {
     ESP_LOGI(TAG, "[Schedule] << Task queued");
 }
 
+void Application::ScheduleAndWait(std::function<void()> callback) {
+    std::promise<void> done;
+    auto future = done.get_future();
+    Schedule([&callback, &done]() {
+        callback();
+        done.set_value();
+    });
+    future.wait();
+}
+
 // The Main Event Loop controls the chat state and websocket connection
 // If other tasks need to access the websocket or chat state,
 // they should use Schedule to call this function
@@ -734,8 +799,14 @@ void Application::MainEventLoop() {
         }
 
         if (bits & MAIN_EVENT_SEND_AUDIO) {
-            // 在 Speaking 状态时暂停发送 ASR 音频，减少 UART 竞争导致的卡顿
-            if (device_state_ == kDeviceStateSpeaking) {
+            bool barge_in = false;
+#if CONFIG_USE_BARGE_IN
+            barge_in = device_state_ == kDeviceStateSpeaking && listening_mode_ == kListeningModeRealtime;
+#endif
+            if (barge_in) {
+                ForwardBargeInAudio();
+            } else if (device_state_ == kDeviceStateSpeaking) {
+                // 在 Speaking 状态时暂停发送 ASR 音频，减少 UART 竞争导致的卡顿
                 // 清空队列，避免溢出（静默丢弃，不打印日志以减少 UART 竞争）
                 int discarded = 0;
                 while (audio_service_.PopPacketFromSendQueue()) { discarded++; }
@@ -745,8 +816,16 @@ void Application::MainEventLoop() {
                     ESP_LOGD(TAG, "Speaking: discarded %d ASR packets", discarded);
                 }
             } else {
+                if (barge_in_active_) {
+                    barge_in_active_ = false;
+                    auto stats = barge_in_gate_.GetStatistics();
+                    ESP_LOGI(TAG, "Barge-in: sent %lu of %lu packets (%lu bytes), %lu bursts, %lu triggers, %lu dropped",
+                             (unsigned long)stats.sent_packets, (unsigned long)stats.input_packets,
+                             (unsigned long)stats.sent_bytes, (unsigned long)stats.bursts,
+                             (unsigned long)stats.triggers, (unsigned long)stats.backoff_drops);
+                }
                 while (auto packet = audio_service_.PopPacketFromSendQueue()) {
-                    if (!protocol_->SendAudio(std::move(packet))) {
+                    if (!SendAudioPacket(std::move(packet))) {
                         break;
                     }
                 }
@@ -831,9 +910,52 @@ void Application::OnWakeWordDetected() {
     }
 }
 
+void Application::ForwardBargeInAudio() {
+    if (!barge_in_active_) {
+        barge_in_active_ = true;
+        barge_in_gate_.Reset();
+    }
+
+    // AEC 已消除扬声器回声, 本地 VAD 认为有人声时才上行
+    int64_t now = esp_timer_get_time();
+    bool voice = audio_service_.IsVoiceDetected();
+    bool interrupt = false;
+    while (auto packet = audio_service_.PopPacketFromSendQueue()) {
+        interrupt |= barge_in_gate_.Feed(std::move(packet), voice, now, barge_in_packets_);
+    }
+    for (auto& packet : barge_in_packets_) {
+        size_t bytes = packet->payload.size();
+        if (!SendAudioPacket(std::move(packet))) {
+            barge_in_gate_.OnSendFailure(now);
+            break;
+        }
+        barge_in_gate_.OnPacketSent(bytes);
+    }
+    barge_in_packets_.clear();
+
+    if (interrupt && !aborted_) {
+        ESP_LOGI(TAG, "Barge-in detected");
+        AbortSpeaking(kAbortReasonNone);
+    }
+}
+
+bool Application::SendAudioPacket(AudioStreamPacketPtr packet) {
+    int64_t capture_us = packet->capture_us;
+    int64_t start_us = esp_timer_get_time();
+    if (!protocol_->SendAudio(std::move(packet))) {
+        // Lets the encoder rate controller back off on a congested link
+        audio_service_.OnSendAudioFailed();
+        return false;
+    }
+    audio_service_.OnAudioSent(capture_us, start_us);
+    return true;
+}
+
 void Application::AbortSpeaking(AbortReason reason) {
     ESP_LOGI(TAG, "Abort speaking");
     aborted_ = true;
+    // 先本地静音, 不等服务器响应; 剩余的 TTS 数据包在下一次 tts start 之前都丢弃
+    audio_service_.AbortPlayback();
     protocol_->SendAbortSpeaking(reason);
 }
 
@@ -859,6 +981,11 @@ void Application::SetDeviceState(DeviceState state) {
     auto display = board.GetDisplay();
     auto led = board.GetLed();
     led->OnStateChanged();
+    if (previous_state == kDeviceStateSpeaking) {
+        audio_service_.SetUplinkBitrateCeiling(0);
+        audio_service_.LogLatencyStatistics();
+        audio_service_.ResetLatencyStatistics();
+    }
     switch (state) {
         case kDeviceStateUnknown:
         case kDeviceStateIdle:
@@ -888,6 +1015,12 @@ void Application::SetDeviceState(DeviceState state) {
             break;
         case kDeviceStateSpeaking:
             display->SetStatus(Lang::Strings::SPEAKING);
+#if CONFIG_USE_BARGE_IN
+            // 播放期间的上行只用于检测打断, 降低码率给下行让出带宽
+            if (listening_mode_ == kListeningModeRealtime) {
+                audio_service_.SetUplinkBitrateCeiling(BARGE_IN_BITRATE);
+            }
+#endif
 
             if (listening_mode_ != kListeningModeRealtime) {
                 audio_service_.EnableVoiceProcessing(false);
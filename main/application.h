@@ -19,10 +19,12 @@
 #include <deque>
 #include <vector>
 #include <memory>
+#include <atomic>
 
 #include "protocol.h"
 #include "ota.h"
 #include "audio_service.h"
+#include "barge_in_gate.h"
 #include "device_state_event.h"
 #include "display/display_engine.h"
 
@@ -55,6 +57,8 @@ public:
     DeviceState GetDeviceState() const { return device_state_; }
     bool IsVoiceDetected() const { return audio_service_.IsVoiceDetected(); }
     void Schedule(std::function<void()> callback);
+    // Runs the callback on the main loop and waits for it, never call it from the main loop itself
+    void ScheduleAndWait(std::function<void()> callback);
     void SetDeviceState(DeviceState state);
     void Alert(const char* status, const char* message, const char* emotion = "", const std::string_view& sound = "");
     void DismissAlert();
@@ -69,6 +73,9 @@ public:
     void SetAecMode(AecMode mode);
     AecMode GetAecMode() const { return aec_mode_; }
     void PlaySound(const std::string_view& sound);
+    // Runs the acoustic loopback self-test in the AudioTesting state, from Idle or Listening only.
+    // ToggleChatState/StartListening/StopListening are ignored while it runs.
+    bool RunAudioLoopbackTest(LoopbackTestResult& result);
     AudioService& GetAudioService() { return audio_service_; }
 
 private:
@@ -93,12 +100,19 @@ private:
     DisplayEngine display_engine_;
 
     bool has_server_time_ = false;
-    bool aborted_ = false;
+    std::atomic<bool> aborted_{false};     // 网络任务与主任务都会读写
+    std::atomic<bool> loopback_testing_{false};    // 回环自测进行中, 按键输入被忽略 (主任务写, 按键任务读)
     bool waiting_for_playback_complete_ = false;  // 等待 TTS 播放完成后再切换状态
     int clock_ticks_ = 0;
+    // 播放期间的上行 (只由主任务访问)
+    BargeInGate barge_in_gate_;
+    std::vector<AudioStreamPacketPtr> barge_in_packets_;
+    bool barge_in_active_ = false;
     TaskHandle_t check_new_version_task_handle_ = nullptr;
 
     void OnWakeWordDetected();
+    void ForwardBargeInAudio();
+    bool SendAudioPacket(AudioStreamPacketPtr packet);
     void CheckNewVersion(Ota& ota);
     void ShowActivationCode(const std::string& code, const std::string& message);
     void OnClockTimer();
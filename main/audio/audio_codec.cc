@@ -3,8 +3,15 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_attr.h>
+#include <soc/soc_caps.h>
 #include <cstring>
+#include <algorithm>
 #include <driver/i2s_common.h>
+#if SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
+#include <esp_cache.h>
+#endif
 
 #define TAG "AudioCodec"
 
@@ -15,6 +22,10 @@ AudioCodec::~AudioCodec() {
 }
 
 void AudioCodec::OutputData(std::vector<int16_t>& data) {
+    // Counted before the write: the DMA may start sending these samples while Write() is still blocked
+    portENTER_CRITICAL(&tx_lock_);
+    tx_written_frames_ += data.size();
+    portEXIT_CRITICAL(&tx_lock_);
     Write(data.data(), data.size());
 }
 
@@ -26,6 +37,10 @@ bool AudioCodec::InputData(std::vector<int16_t>& data) {
     return false;
 }
 
+bool AudioCodec::InputData(int16_t* data, int samples) {
+    return Read(data, samples) > 0;
+}
+
 void AudioCodec::Start() {
     Settings settings("audio", false);
     output_volume_ = settings.GetInt("output_volume", output_volume_);
@@ -35,7 +50,7 @@ void AudioCodec::Start() {
     }
 
     if (tx_handle_ != nullptr) {
-        ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
+        EnableTxChannel();
     }
 
     if (rx_handle_ != nullptr) {
@@ -47,6 +62,14 @@ void AudioCodec::Start() {
     ESP_LOGI(TAG, "Audio codec started");
 }
 
+void AudioCodec::EnableTxChannel() {
+    // 回调只能在通道启用前注册, 用来跟踪 DMA 播放位置
+    i2s_event_callbacks_t callbacks = {};
+    callbacks.on_sent = OnTxSent;
+    ESP_ERROR_CHECK_WITHOUT_ABORT(i2s_channel_register_event_callback(tx_handle_, &callbacks, this));
+    ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
+}
+
 void AudioCodec::SetOutputVolume(int volume) {
     output_volume_ = volume;
     ESP_LOGI(TAG, "Set output volume to %d", output_volume_);
@@ -55,6 +78,11 @@ void AudioCodec::SetOutputVolume(int volume) {
     settings.SetInt("output_volume", output_volume_);
 }
 
+int32_t AudioCodec::output_gain_q15() const {
+    int32_t volume = output_volume_;
+    return volume * volume * audio_dsp::kUnityGain / 10000;
+}
+
 void AudioCodec::EnableInput(bool enable) {
     if (enable == input_enabled_) {
         return;
@@ -70,3 +98,236 @@ void AudioCodec::EnableOutput(bool enable) {
     output_enabled_ = enable;
     ESP_LOGI(TAG, "Set output enable to %s", enable ? "true" : "false");
 }
+
+// 直接改写 DMA 缓冲区后要写回缓存, 否则 DMA 读到的仍是旧数据
+static inline void IRAM_ATTR SyncTxBuffer(void* buffer, size_t bytes) {
+#if SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
+    esp_cache_msync(buffer, bytes, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_UNALIGNED);
+#endif
+}
+
+int IRAM_ATTR AudioCodec::FindTxBuffer(void* buffer) {
+    for (int i = 0; i < tx_learned_; i++) {
+        if (tx_buffers_[i] == buffer) {
+            // DMA 按环形顺序发送, 第一次重复时就知道了环的大小
+            if (tx_ring_size_ == 0) {
+                tx_ring_size_ = tx_learned_;
+            }
+            return i;
+        }
+    }
+    if (tx_ring_size_ != 0 || tx_learned_ >= AUDIO_CODEC_MAX_DMA_DESC) {
+        return -1;
+    }
+    tx_buffers_[tx_learned_] = buffer;
+    return tx_learned_++;
+}
+
+bool IRAM_ATTR AudioCodec::OnTxSent(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx) {
+    auto codec = static_cast<AudioCodec*>(user_ctx);
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL_ISR(&codec->tx_lock_);
+    int index = codec->FindTxBuffer(event->dma_buf);
+    if (index >= 0) {
+        if (codec->tx_last_sent_ >= 0) {
+            codec->tx_period_us_ = now - codec->tx_last_sent_us_;
+        }
+        codec->tx_last_sent_ = index;
+        codec->tx_last_sent_us_ = now;
+        codec->tx_buffer_bytes_ = event->size;
+        codec->AdvancePlaybackClock(event->size, now);
+
+        if (index == codec->fade_buffer_ && codec->tx_buffer_bytes_ > 0) {
+            int64_t tail_us = codec->fade_tail_bytes_ * codec->tx_period_us_ / codec->tx_buffer_bytes_;
+            uint32_t silence_us = std::max<int64_t>(0, now - codec->flush_request_us_ - tail_us);
+            codec->flush_statistics_.last_silence_us = silence_us;
+            codec->flush_statistics_.max_silence_us = std::max(codec->flush_statistics_.max_silence_us, silence_us);
+            codec->fade_buffer_ = -1;
+        }
+
+        // 静音期间, 在每个描述符播放前一个周期把它清零 (此时正在播放的是 index + 1)
+        if (codec->tx_muted_ && codec->tx_ring_size_ > 2) {
+            void* upcoming = codec->tx_buffers_[(index + 2) % codec->tx_ring_size_];
+            memset(upcoming, 0, event->size);
+            SyncTxBuffer(upcoming, event->size);
+        }
+    }
+    portEXIT_CRITICAL_ISR(&codec->tx_lock_);
+    return false;
+}
+
+void AudioCodec::FadeTxBuffer(int index, size_t bytes, size_t from, size_t length, int32_t gain_from, int32_t gain_to) {
+    uint8_t* buffer = static_cast<uint8_t*>(tx_buffers_[index]);
+    size_t sample_bytes = tx_sample_bits_ / 8;
+    size_t samples = length / sample_bytes;
+    for (size_t i = 0; i < samples; i++) {
+        int64_t gain = gain_from + (int64_t)(gain_to - gain_from) * (int64_t)i / (int64_t)samples;
+        if (sample_bytes == 4) {
+            int32_t* sample = reinterpret_cast<int32_t*>(buffer + from) + i;
+            *sample = (int32_t)((*sample * gain) >> 15);
+        } else {
+            int16_t* sample = reinterpret_cast<int16_t*>(buffer + from) + i;
+            *sample = (int16_t)((*sample * gain) >> 15);
+        }
+    }
+    memset(buffer + from + length, 0, bytes - from - length);
+    SyncTxBuffer(buffer, bytes);
+}
+
+int AudioCodec::FlushOutput() {
+    if (tx_handle_ == nullptr) {
+        return -1;
+    }
+
+    // Only the plan is made under the lock, the fade runs with interrupts enabled.
+    // The interrupt only clears the descriptor after the one playing, never the two faded here.
+    struct Fade {
+        int index;
+        size_t from;
+        size_t length;
+        int32_t gain_from;
+        int32_t gain_to;
+    } fades[2];
+    int fade_count = 0;
+    size_t bytes = 0;
+    int silence_us = -1;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&tx_lock_);
+    tx_muted_ = true;
+    flush_statistics_.flushes++;
+    if (tx_ring_size_ > 2 && tx_period_us_ > 0 && tx_buffer_bytes_ > 0) {
+        // 位置以正在播放的描述符开头为 0, 淡出最多跨到下一个描述符
+        bytes = tx_buffer_bytes_;
+        int64_t period = tx_period_us_;
+        size_t sample_bytes = tx_sample_bits_ / 8;
+        auto to_bytes = [&](int64_t us) {
+            return static_cast<size_t>(std::max<int64_t>(0, us) * bytes / period) / sample_bytes * sample_bytes;
+        };
+        int64_t elapsed = now - tx_last_sent_us_;
+        size_t fade = std::clamp(to_bytes(AUDIO_CODEC_FLUSH_FADE_MS * 1000), sample_bytes, bytes);
+        size_t start = std::min(to_bytes(elapsed + AUDIO_CODEC_FLUSH_GUARD_MS * 1000), 2 * bytes - fade);
+        size_t end = start + fade;
+
+        int playing = (tx_last_sent_ + 1) % tx_ring_size_;
+        for (int i = 0; i < 2; i++) {
+            size_t base = i * bytes;
+            size_t from = std::clamp(start, base, base + bytes);
+            size_t to = std::clamp(end, base, base + bytes);
+            fades[fade_count++] = {
+                (playing + i) % tx_ring_size_, from - base, to - from,
+                (int32_t)(audio_dsp::kUnityGain * (int64_t)(end - from) / fade),
+                (int32_t)(audio_dsp::kUnityGain * (int64_t)(end - to) / fade),
+            };
+        }
+
+        fade_buffer_ = (playing + (end <= bytes ? 0 : 1)) % tx_ring_size_;
+        fade_tail_bytes_ = (end <= bytes ? bytes : 2 * bytes) - end;
+        flush_request_us_ = now;
+        silence_us = std::max<int64_t>(0, end * period / bytes - elapsed);
+    } else {
+        flush_statistics_.fallbacks++;
+    }
+    portEXIT_CRITICAL(&tx_lock_);
+
+    for (int i = 0; i < fade_count; i++) {
+        FadeTxBuffer(fades[i].index, bytes, fades[i].from, fades[i].length, fades[i].gain_from, fades[i].gain_to);
+    }
+    return silence_us;
+}
+
+void AudioCodec::ResumeOutput() {
+    portENTER_CRITICAL(&tx_lock_);
+    bool clear = tx_muted_ && tx_ring_size_ > 2;
+    int ring_size = tx_ring_size_;
+    size_t bytes = tx_buffer_bytes_;
+    int playing = clear ? (tx_last_sent_ + 1) % tx_ring_size_ : -1;
+    uint32_t flushes = flush_statistics_.flushes;
+    portEXIT_CRITICAL(&tx_lock_);
+
+    if (clear) {
+        // 正在播放的描述符已被清零, 其余描述符里可能还有静音期间写入的旧数据.
+        // 仍在静音, 中断会继续清零即将播放的描述符, 所以这里清零时 DMA 往前走也不会播出旧数据
+        for (int i = 0; i < ring_size; i++) {
+            if (i != playing) {
+                memset(tx_buffers_[i], 0, bytes);
+                SyncTxBuffer(tx_buffers_[i], bytes);
+            }
+        }
+    }
+
+    portENTER_CRITICAL(&tx_lock_);
+    // A flush that landed while the ring was being cleared keeps the output muted
+    if (flush_statistics_.flushes == flushes) {
+        tx_muted_ = false;
+        // What was written during the silence has been cleared, the clock restarts at the next write
+        tx_played_frames_ = tx_written_frames_;
+    }
+    portEXIT_CRITICAL(&tx_lock_);
+}
+
+void IRAM_ATTR AudioCodec::AdvancePlaybackClock(size_t bytes, int64_t now) {
+    auto& stats = clock_statistics_;
+    if (stats.frame_bytes == 0) {
+        if (tx_period_us_ <= 0 || output_sample_rate_ <= 0) {
+            return;
+        }
+        // Bytes per frame from one descriptor period, snapped to the nearest power of two (2 to 16)
+        int64_t measured_x100 = (int64_t)bytes * 100000000 / (tx_period_us_ * output_sample_rate_);
+        uint32_t best = 2;
+        for (uint32_t candidate = 4; candidate <= 16; candidate *= 2) {
+            if (std::abs(measured_x100 - (int64_t)candidate * 100) < std::abs(measured_x100 - (int64_t)best * 100)) {
+                best = candidate;
+            }
+        }
+        stats.frame_bytes = best;
+        tx_played_frames_ = tx_written_frames_;
+        tx_clock_us_ = now;
+        return;
+    }
+
+    uint64_t frames = bytes / stats.frame_bytes;
+    int64_t expected_us = tx_clock_us_ + (int64_t)frames * 1000000 / output_sample_rate_;
+    uint32_t residual_us = std::abs(now - expected_us);
+    if (residual_us < 1000000) {
+        stats.residual_us += ((int32_t)residual_us - (int32_t)stats.residual_us) / 16;
+        stats.max_residual_us = std::max(stats.max_residual_us, residual_us);
+    }
+
+    uint64_t pending = tx_written_frames_ - tx_played_frames_;
+    if (pending == 0) {
+        stats.underruns++;
+    }
+    tx_played_frames_ += std::min(frames, pending);
+    tx_clock_us_ = now;
+}
+
+bool AudioCodec::GetPlaybackPosition(int64_t time_us, uint64_t& position) {
+    bool valid = false;
+    portENTER_CRITICAL(&tx_lock_);
+    if (!tx_muted_ && clock_statistics_.frame_bytes > 0) {
+        // The DMA moves on at the sample rate from the last completion, this also works backwards
+        int64_t offset = (time_us - tx_clock_us_) * output_sample_rate_ / 1000000;
+        int64_t played = (int64_t)tx_played_frames_ + offset;
+        if (played >= 0 && (uint64_t)played < tx_written_frames_) {
+            position = played;
+            valid = true;
+        }
+    }
+    portEXIT_CRITICAL(&tx_lock_);
+    return valid;
+}
+
+AudioPlaybackClockStatistics AudioCodec::GetPlaybackClockStatistics() {
+    portENTER_CRITICAL(&tx_lock_);
+    AudioPlaybackClockStatistics statistics = clock_statistics_;
+    portEXIT_CRITICAL(&tx_lock_);
+    return statistics;
+}
+
+AudioFlushStatistics AudioCodec::GetFlushStatistics() {
+    portENTER_CRITICAL(&tx_lock_);
+    AudioFlushStatistics statistics = flush_statistics_;
+    portEXIT_CRITICAL(&tx_lock_);
+    return statistics;
+}
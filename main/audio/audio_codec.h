@@ -18,10 +18,38 @@
 #include <functional>
 
 #include "board.h"
+#include "dsp/audio_dsp.h"
 
 #define AUDIO_CODEC_DMA_DESC_NUM 12  // 折中：24kHz需要更大缓冲
 #define AUDIO_CODEC_DMA_FRAME_NUM 320
 #define AUDIO_CODEC_DEFAULT_MIC_GAIN 30.0
+// I2S 中转缓冲区容量 (int32 样本数): 一个双声道 DMA 帧
+#define AUDIO_CODEC_SCRATCH_SAMPLES (AUDIO_CODEC_DMA_FRAME_NUM * 2)
+// 快速中止: 在估计的 DMA 读位置之后留出的余量, 以及淡出时长
+#define AUDIO_CODEC_FLUSH_GUARD_MS 1
+#define AUDIO_CODEC_FLUSH_FADE_MS 3
+// 能跟踪的 TX DMA 描述符上限 (各驱动的 dma_desc_num 不超过它)
+#define AUDIO_CODEC_MAX_DMA_DESC 16
+
+/**
+ * 快速中止统计
+ */
+struct AudioFlushStatistics {
+    uint32_t flushes = 0;
+    uint32_t fallbacks = 0;         // DMA 环还没学完, 已写入 DMA 的数据照常播完
+    uint32_t last_silence_us = 0;   // 请求到淡出结束, 按淡出所在描述符的发送完成时间测得
+    uint32_t max_silence_us = 0;
+};
+
+/**
+ * 播放时钟统计
+ */
+struct AudioPlaybackClockStatistics {
+    uint32_t frame_bytes = 0;       // DMA 中每个采样帧 (所有声道) 的字节数, 由发送完成间隔测得, 0 表示还未知
+    uint32_t underruns = 0;         // 没有待播数据、DMA 播放静音的描述符数
+    uint32_t residual_us = 0;       // 发送完成时间与按采样率推算的时间之差 (绝对值的滑动平均)
+    uint32_t max_residual_us = 0;
+};
 
 class AudioCodec {
 public:
@@ -31,11 +59,40 @@ public:
     virtual void SetOutputVolume(int volume);
     virtual void EnableInput(bool enable);
     virtual void EnableOutput(bool enable);
+    // 驱动名, 用于日志与统计
+    virtual const char* name() const { return "I2S"; }
 
     virtual void OutputData(std::vector<int16_t>& data);
     virtual bool InputData(std::vector<int16_t>& data);
+    bool InputData(int16_t* data, int samples);
     virtual void Start();
 
+    /**
+     * 快速中止输出, 任意任务都可以调用, 不等待 DMA
+     * - 正在播放的描述符从估计的读位置 + AUDIO_CODEC_FLUSH_GUARD_MS 处淡出到零
+     * - 之后的描述符在轮到播放前由发送完成中断逐个清零, 期间写入的旧数据也不会播出
+     * 静音保持到 ResumeOutput().
+     * @return 预计多少微秒后静音, DMA 环还未知时返回 -1
+     */
+    int FlushOutput();
+
+    /**
+     * 结束 FlushOutput() 的静音并清掉环中的旧数据, 由写入数据的任务在写新数据之前调用
+     */
+    void ResumeOutput();
+    bool output_flushed() const { return tx_muted_; }
+    AudioFlushStatistics GetFlushStatistics();
+
+    /**
+     * 播放时钟: time_us 时刻正在播放的样本位置 (输出采样率)
+     * OutputData() 写入的样本按顺序编号, 位置由 TX DMA 发送完成计数得出, 欠载时 DMA 播放的静音不占位置.
+     * @return 该时刻没有写入的数据在播放 (欠载、静音中或 DMA 环还未知) 时返回 false
+     */
+    bool GetPlaybackPosition(int64_t time_us, uint64_t& position);
+    // 下一个写入的样本的位置, 只由写入数据的任务读取
+    uint64_t output_written_frames() const { return tx_written_frames_; }
+    AudioPlaybackClockStatistics GetPlaybackClockStatistics();
+
     inline bool duplex() const { return duplex_; }
     inline bool input_reference() const { return input_reference_; }
     inline int input_sample_rate() const { return input_sample_rate_; }
@@ -59,9 +116,59 @@ protected:
     int input_channels_ = 1;
     int output_channels_ = 1;
     int output_volume_ = 70;
+    int tx_sample_bits_ = 16;   // TX DMA 中每个声道样本的位宽, 淡出时按它解释数据
 
     virtual int Read(int16_t* dest, int samples) = 0;
     virtual int Write(const int16_t* data, int samples) = 0;
+
+    /**
+     * I2S 读写的中转缓冲区 (DMA 可用, 16 字节对齐), 首次使用时分配后一直复用
+     * 容量为 AUDIO_CODEC_SCRATCH_SAMPLES 个 int32, 更长的数据由调用方分段处理.
+     * 输入和输出在不同任务中运行, 各用一块.
+     * @return 分配失败时返回 nullptr
+     */
+    int32_t* tx_scratch() { return tx_scratch_.Resize(AUDIO_CODEC_SCRATCH_SAMPLES); }
+    int32_t* rx_scratch() { return rx_scratch_.Resize(AUDIO_CODEC_SCRATCH_SAMPLES); }
+
+    // output_volume_ (0-100) 按平方曲线映射的 Q15 增益
+    int32_t output_gain_q15() const;
+
+    /**
+     * 注册 TX 发送完成回调 (跟踪 DMA 播放位置, FlushOutput() 与 GetPlaybackPosition() 依赖它) 后启用 TX 通道.
+     * 回调只能在通道启用前注册, 重写 Start() 的 codec 也要用它启用 tx_handle_
+     */
+    void EnableTxChannel();
+
+private:
+    static bool OnTxSent(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
+    int FindTxBuffer(void* buffer);
+    // 在发送完成中断中推进播放时钟
+    void AdvancePlaybackClock(size_t bytes, int64_t now);
+    // 把 [from, from + length) 从 gain_from 线性衰减到 gain_to, 之后到描述符末尾 (bytes) 清零
+    void FadeTxBuffer(int index, size_t bytes, size_t from, size_t length, int32_t gain_from, int32_t gain_to);
+
+    // 以下由 TX 发送完成中断更新, 用 tx_lock_ 保护
+    portMUX_TYPE tx_lock_ = portMUX_INITIALIZER_UNLOCKED;
+    void* tx_buffers_[AUDIO_CODEC_MAX_DMA_DESC] = {};  // 按 DMA 播放顺序
+    int tx_learned_ = 0;
+    int tx_ring_size_ = 0;          // 发现第一个重复的描述符后确定, 0 表示未知
+    int tx_last_sent_ = -1;
+    size_t tx_buffer_bytes_ = 0;
+    int64_t tx_last_sent_us_ = 0;
+    int64_t tx_period_us_ = 0;      // 一个描述符的播放时长 (相邻两次发送完成的间隔)
+    volatile bool tx_muted_ = false;
+    int fade_buffer_ = -1;          // 淡出结束所在的描述符, 发送完成时记录静音时间
+    size_t fade_tail_bytes_ = 0;    // 淡出结束后该描述符剩余的字节
+    int64_t flush_request_us_ = 0;
+    AudioFlushStatistics flush_statistics_;
+    // 播放时钟
+    uint64_t tx_written_frames_ = 0;
+    uint64_t tx_played_frames_ = 0;
+    int64_t tx_clock_us_ = 0;       // tx_played_frames_ 对应的时间 (最近一次发送完成)
+    AudioPlaybackClockStatistics clock_statistics_;
+
+    AlignedBuffer<int32_t> tx_scratch_{MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT};
+    AlignedBuffer<int32_t> rx_scratch_{MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT};
 };
 
 #endif // _AUDIO_CODEC_H
@@ -0,0 +1,68 @@
+#include "audio_latency.h"
+
+static constexpr uint32_t kBucketBoundsMs[AUDIO_LATENCY_BUCKETS - 1] = AUDIO_LATENCY_BUCKET_BOUNDS_MS;
+
+const char* AudioLatencyStageName(AudioLatencyStage stage) {
+    static const char* const kNames[kAudioLatencyStageCount] = {
+        "process", "encode_wait", "encode", "send_wait", "send", "uplink",
+        "decode_wait", "decode", "resample", "playback_wait", "output", "downlink",
+    };
+    return stage < kAudioLatencyStageCount ? kNames[stage] : "unknown";
+}
+
+uint32_t AudioLatencyHistogram::PercentileUs(int percent) const {
+    if (count == 0) {
+        return 0;
+    }
+    // Counts are read one by one while the writer runs, so the total may differ slightly from count
+    uint64_t total = 0;
+    for (uint32_t bucket : buckets) {
+        total += bucket;
+    }
+    uint64_t target = (total * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < AUDIO_LATENCY_BUCKETS - 1; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return kBucketBoundsMs[i] * 1000;
+        }
+    }
+    return max_us;
+}
+
+void LatencyRecorder::Add(int64_t elapsed_us) {
+    uint32_t us = elapsed_us > 0 ? static_cast<uint32_t>(elapsed_us) : 0;
+    uint32_t count = count_.load(std::memory_order_relaxed);
+    int32_t average = average_us_.load(std::memory_order_relaxed);
+    average = count == 0 ? us : average + (static_cast<int32_t>(us) - average) / 16;
+    average_us_.store(average, std::memory_order_relaxed);
+    if (us > max_us_.load(std::memory_order_relaxed)) {
+        max_us_.store(us, std::memory_order_relaxed);
+    }
+
+    int bucket = 0;
+    while (bucket < AUDIO_LATENCY_BUCKETS - 1 && us > kBucketBoundsMs[bucket] * 1000) {
+        bucket++;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.store(count + 1, std::memory_order_relaxed);
+}
+
+AudioLatencyHistogram LatencyRecorder::Get() const {
+    AudioLatencyHistogram histogram;
+    histogram.count = count_.load(std::memory_order_relaxed);
+    histogram.average_us = average_us_.load(std::memory_order_relaxed);
+    histogram.max_us = max_us_.load(std::memory_order_relaxed);
+    for (int i = 0; i < AUDIO_LATENCY_BUCKETS; i++) {
+        histogram.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    return histogram;
+}
+
+void LatencyRecorder::Reset() {
+    count_.store(0, std::memory_order_relaxed);
+    max_us_.store(0, std::memory_order_relaxed);
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
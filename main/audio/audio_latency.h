@@ -0,0 +1,69 @@
+#ifndef AUDIO_LATENCY_H
+#define AUDIO_LATENCY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 直方图桶的上界 (ms), 最后一个桶收集更大的值
+#define AUDIO_LATENCY_BUCKET_BOUNDS_MS {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000}
+#define AUDIO_LATENCY_BUCKETS 12
+
+/**
+ * 音频管线的阶段, 每个阶段是两个时间戳 (esp_timer 单调时间) 之间的间隔
+ *
+ * 上行: capture -> process -> encode queue -> encode -> send queue -> send
+ * 下行: receive -> decode queue -> decode -> resample -> playback queue -> output
+ */
+enum AudioLatencyStage {
+    kAudioLatencyProcess = 0,       // 采集 -> 音频处理器输出 (以输出时最新一块输入计)
+    kAudioLatencyEncodeWait,        // 编码队列等待
+    kAudioLatencyEncode,            // Opus 编码
+    kAudioLatencySendWait,          // 发送队列等待
+    kAudioLatencySend,              // Protocol::SendAudio 耗时
+    kAudioLatencyUplink,            // 采集 -> 发送完成
+    kAudioLatencyDecodeWait,        // 收到 -> 开始解码 (解码队列等待)
+    kAudioLatencyDecode,            // Opus 解码 (含 PLC/FEC)
+    kAudioLatencyResample,          // 重采样与时间伸缩
+    kAudioLatencyPlaybackWait,      // 播放队列等待 (含预缓冲)
+    kAudioLatencyOutput,            // AudioCodec::OutputData 耗时
+    kAudioLatencyDownlink,          // 收到 -> 写入 codec 完成
+    kAudioLatencyStageCount,
+};
+
+const char* AudioLatencyStageName(AudioLatencyStage stage);
+
+/**
+ * 一个阶段的统计, buckets[i] 为落在第 i 个桶的帧数
+ */
+struct AudioLatencyHistogram {
+    uint32_t count = 0;
+    uint32_t average_us = 0;    // 约最近 16 帧的滑动平均
+    uint32_t max_us = 0;
+    uint32_t buckets[AUDIO_LATENCY_BUCKETS] = {};
+
+    // 估计的百分位 (取所在桶的上界, 最后一个桶取最大值)
+    uint32_t PercentileUs(int percent) const;
+};
+
+struct AudioLatencyStatistics {
+    AudioLatencyHistogram stages[kAudioLatencyStageCount];
+};
+
+/**
+ * 单个阶段的直方图, 由一个任务写入, 任意任务读取与重置
+ */
+class LatencyRecorder {
+public:
+    void Add(int64_t elapsed_us);
+    AudioLatencyHistogram Get() const;
+    void Reset();
+
+private:
+    std::atomic<uint32_t> count_{0};
+    std::atomic<int32_t> average_us_{0};
+    std::atomic<uint32_t> max_us_{0};
+    std::atomic<uint32_t> buckets_[AUDIO_LATENCY_BUCKETS] = {};
+};
+
+#endif // AUDIO_LATENCY_H
@@ -0,0 +1,16 @@
+#ifndef AUDIO_LIMITS_H
+#define AUDIO_LIMITS_H
+
+// 帧时长与队列上限, AudioService 与不依赖 FreeRTOS 的类 (以及主机上的回放工具) 共用
+
+// Frame duration before a session negotiates one (see Protocol::NegotiateFrameDuration), also the longest
+// frame the uplink falls back to under congestion. Wi-Fi sessions usually run at the minimum.
+#define OPUS_FRAME_DURATION_MS 60
+#define OPUS_MIN_FRAME_DURATION_MS 20
+// Queue limits are durations, converted to packets with the current frame duration
+#define MAX_DECODE_QUEUE_DURATION_MS 12000  // 4G网络：12秒缓冲 (200*60ms)
+#define MAX_SEND_QUEUE_DURATION_MS 2400
+#define MAX_DECODE_PACKETS_IN_QUEUE (MAX_DECODE_QUEUE_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
+#define MAX_SEND_PACKETS_IN_QUEUE (MAX_SEND_QUEUE_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
+
+#endif // AUDIO_LIMITS_H
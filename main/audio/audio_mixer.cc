@@ -0,0 +1,87 @@
+#include "audio_mixer.h"
+
+#include <algorithm>
+#include <cstring>
+
+void AudioMixer::Configure(int sample_rate) {
+    block_samples_ = std::max(1, sample_rate * AUDIO_MIXER_RAMP_BLOCK_MS / 1000);
+    main_gain_ = audio_dsp::kUnityGain;
+    UpdateRampSteps();
+}
+
+void AudioMixer::SetGain(AudioMixerStream stream, int32_t gain_q15) {
+    gains_[stream] = std::clamp<int32_t>(gain_q15, 0, audio_dsp::kUnityGain);
+}
+
+void AudioMixer::SetDuckGain(int32_t gain_q15) {
+    duck_gain_ = std::clamp<int32_t>(gain_q15, 0, audio_dsp::kUnityGain);
+    UpdateRampSteps();
+}
+
+void AudioMixer::UpdateRampSteps() {
+    int32_t range = audio_dsp::kUnityGain - duck_gain_;
+    attack_step_ = std::max<int32_t>(1, range * AUDIO_MIXER_RAMP_BLOCK_MS / AUDIO_MIXER_ATTACK_MS);
+    release_step_ = std::max<int32_t>(1, range * AUDIO_MIXER_RAMP_BLOCK_MS / AUDIO_MIXER_RELEASE_MS);
+}
+
+int32_t AudioMixer::StepMainGain(bool prompt_active) {
+    if (prompt_active) {
+        main_gain_ = std::max(duck_gain_, main_gain_ - attack_step_);
+    } else {
+        main_gain_ = std::min(audio_dsp::kUnityGain, main_gain_ + release_step_);
+    }
+    return (gains_[kAudioMixerStreamMain] * main_gain_) >> 15;
+}
+
+int16_t* AudioMixer::PromptBuffer(size_t samples) {
+    return prompt_.Resize(samples);
+}
+
+void AudioMixer::Mix(std::vector<int16_t>& main, size_t prompt_samples) {
+    size_t samples = main.size();
+    prompt_samples = std::min(prompt_samples, samples);
+    if (prompt_samples == 0 && main_gain_ == audio_dsp::kUnityGain &&
+        gains_[kAudioMixerStreamMain] == audio_dsp::kUnityGain) {
+        return;
+    }
+
+    // SIMD 需要 16 字节对齐, 池中任务的 vector 不保证, 不对齐时在对齐的工作区中计算
+    int16_t* out = main.data();
+    bool aligned = (reinterpret_cast<uintptr_t>(out) & 15) == 0;
+    if (!aligned && work_.Resize(samples) != nullptr) {
+        out = work_.data();
+        memcpy(out, main.data(), samples * sizeof(int16_t));
+    }
+
+    const int16_t* prompt = prompt_.data();
+    for (size_t offset = 0; offset < samples; offset += block_samples_) {
+        size_t count = std::min(block_samples_, samples - offset);
+        size_t mixed = offset < prompt_samples ? std::min(count, prompt_samples - offset) : 0;
+        int32_t main_gain = StepMainGain(mixed > 0);
+        if (mixed > 0) {
+            audio_dsp::MixSaturate(out + offset, prompt + offset, mixed, main_gain, gains_[kAudioMixerStreamPrompt]);
+        }
+        if (count > mixed) {
+            audio_dsp::ApplyGain(out + offset + mixed, out + offset + mixed, count - mixed, main_gain);
+        }
+    }
+
+    if (out != main.data()) {
+        memcpy(main.data(), out, samples * sizeof(int16_t));
+    }
+    if (prompt_samples > 0) {
+        statistics_.mixed_frames++;
+    }
+    if (main_gain_ != audio_dsp::kUnityGain || prompt_samples > 0) {
+        statistics_.ducked_frames++;
+    }
+}
+
+void AudioMixer::MixPromptOnly(std::vector<int16_t>& output, size_t prompt_samples) {
+    const int16_t* prompt = prompt_.data();
+    output.assign(prompt, prompt + prompt_samples);
+    audio_dsp::ApplyGain(output.data(), output.data(), output.size(), gains_[kAudioMixerStreamPrompt]);
+    // 没有主流可衰减, 直接进入 ducking, 提示音中途开始的 TTS 不会先以全音量出现
+    main_gain_ = duck_gain_;
+    statistics_.prompt_frames++;
+}
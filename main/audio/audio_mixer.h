@@ -0,0 +1,94 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dsp/audio_dsp.h"
+
+// 提示音播放期间主流 (TTS) 的增益, Q15: 8231 约 -12dB
+#define AUDIO_MIXER_DUCK_GAIN 8231
+// 主流增益从单位增益降到 ducking 增益 (及回升) 所用的时长
+#define AUDIO_MIXER_ATTACK_MS 20
+#define AUDIO_MIXER_RELEASE_MS 250
+// 增益按块阶梯变化, 每块 1ms (16/24/48kHz 下都是 8 个样本的整数倍, 不破坏 SIMD 对齐)
+#define AUDIO_MIXER_RAMP_BLOCK_MS 1
+
+enum AudioMixerStream {
+    kAudioMixerStreamMain = 0,      // 网络音频 (TTS)
+    kAudioMixerStreamPrompt,        // 本地提示音
+    kAudioMixerStreamCount,
+};
+
+struct AudioMixerStatistics {
+    uint32_t mixed_frames = 0;      // 主流与提示音叠加输出的帧数
+    uint32_t prompt_frames = 0;     // 只有提示音的帧数
+    uint32_t ducked_frames = 0;     // 主流被衰减的帧数 (含回升过程)
+};
+
+/**
+ * 播放混音器, 位于 AudioCodec::OutputData 之前
+ *
+ * - 两路输入: 主流一帧 (任意长度) 与同长度的提示音样本
+ * - 每路有独立增益 (Q15), 提示音存在时主流再乘以 ducking 增益
+ * - ducking 增益按 AUDIO_MIXER_RAMP_BLOCK_MS 阶梯线性过渡, 避免咔嗒声
+ * - 叠加使用 audio_dsp::MixSaturate, 结果饱和而不是回绕
+ *
+ * 提示音样本由调用方写入 PromptBuffer() 返回的对齐缓冲区.
+ * 只能被播放任务调用.
+ */
+class AudioMixer {
+public:
+    void Configure(int sample_rate);
+
+    /**
+     * 设置一路的增益 (Q15, 限制在 [0, kUnityGain])
+     */
+    void SetGain(AudioMixerStream stream, int32_t gain_q15);
+    int32_t gain(AudioMixerStream stream) const { return gains_[stream]; }
+
+    /**
+     * 提示音存在时主流的相对增益 (Q15), kUnityGain 表示不做 ducking
+     */
+    void SetDuckGain(int32_t gain_q15);
+
+    /**
+     * 返回可写入 samples 个提示音样本的 16 字节对齐缓冲区
+     */
+    int16_t* PromptBuffer(size_t samples);
+
+    /**
+     * 把 PromptBuffer() 中的 prompt_samples 个样本叠加到主流上 (就地写入 main)
+     * prompt_samples 可以为 0 或小于主流长度, 此时其余部分只施加主流增益
+     */
+    void Mix(std::vector<int16_t>& main, size_t prompt_samples);
+
+    /**
+     * 没有主流时输出提示音: output = 提示音 * 提示音增益
+     */
+    void MixPromptOnly(std::vector<int16_t>& output, size_t prompt_samples);
+
+    /**
+     * 主流当前是否处于 ducking (含回升过程)
+     */
+    bool ducking() const { return main_gain_ != audio_dsp::kUnityGain; }
+
+    AudioMixerStatistics GetStatistics() const { return statistics_; }
+
+private:
+    void UpdateRampSteps();
+    int32_t StepMainGain(bool prompt_active);
+
+    size_t block_samples_ = 16;
+    int32_t attack_step_ = 1;
+    int32_t release_step_ = 1;
+    int32_t gains_[kAudioMixerStreamCount] = {audio_dsp::kUnityGain, audio_dsp::kUnityGain};
+    int32_t duck_gain_ = AUDIO_MIXER_DUCK_GAIN;
+    int32_t main_gain_ = audio_dsp::kUnityGain;     // 相对增益, 只随 ducking 变化
+    AlignedBuffer<int16_t> prompt_;
+    AlignedBuffer<int16_t> work_;
+    AudioMixerStatistics statistics_;
+};
+
+#endif // AUDIO_MIXER_H
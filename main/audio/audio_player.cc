@@ -133,8 +133,8 @@ void AudioPlayer::OnAudioOutputData(const Event& e) {
     // 计算音频时长 (基于数据大小和 Opus 帧)
     int duration_ms = audio_event->duration_ms;
     if (duration_ms <= 0) {
-        // 默认 Opus 帧 60ms
-        duration_ms = 60;
+        // 沿用本会话上一帧的时长
+        duration_ms = controller_.GetFrameDurationMs();
     }
 
     controller_.OnAudioData(duration_ms);
@@ -0,0 +1,168 @@
+#ifndef AUDIO_QUEUE_H
+#define AUDIO_QUEUE_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * 任务等待器
+ *
+ * 一个等待器只服务一个任务: 任务在睡眠前调用 Prepare() 登记自己,
+ * 重新检查条件后调用 Wait() 睡眠; 其他任务调用 Notify() 定向唤醒它.
+ * 任务没有在等待时 Notify() 不做任何事, 避免无效唤醒.
+ *
+ * 使用方式:
+ * ```cpp
+ * while (!Ready()) {
+ *     waiter.Prepare();
+ *     if (Ready()) { waiter.Cancel(); break; }
+ *     waiter.Wait(portMAX_DELAY);
+ * }
+ * ```
+ */
+class TaskWaiter {
+public:
+    void Prepare() {
+        waiting_task_.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+    }
+
+    void Cancel() {
+        waiting_task_.store(nullptr, std::memory_order_release);
+    }
+
+    /**
+     * 睡眠直到被 Notify() 唤醒或超时
+     * @return 是否被唤醒 (false = 超时)
+     */
+    bool Wait(TickType_t ticks) {
+        bool notified = ulTaskNotifyTake(pdTRUE, ticks) > 0;
+        waiting_task_.store(nullptr, std::memory_order_release);
+        return notified;
+    }
+
+    void Notify() {
+        TaskHandle_t task = waiting_task_.exchange(nullptr, std::memory_order_acq_rel);
+        if (task != nullptr) {
+            wakeups_.fetch_add(1, std::memory_order_relaxed);
+            xTaskNotifyGive(task);
+        }
+    }
+
+    uint32_t wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+    void ResetStatistics() { wakeups_.store(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<TaskHandle_t> waiting_task_{nullptr};
+    std::atomic<uint32_t> wakeups_{0};
+};
+
+/**
+ * 有界单生产者/单消费者无锁环形队列
+ *
+ * - Push() 只能由生产者任务调用, Pop()/Front() 只能由消费者任务调用
+ * - Size()/Empty() 任何任务都可以调用 (结果是近似值)
+ * - Clear() 任何任务都可以调用: 记录当前写位置作为丢弃水位,
+ *   消费者在下一次 Pop() 时丢弃水位之前的所有元素, 因此不会与消费者竞争
+ *
+ * @tparam T 元素类型 (通常是 std::unique_ptr)
+ * @tparam Capacity 容量, 必须是 2 的幂
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    static constexpr size_t capacity() { return Capacity; }
+
+    bool Push(T&& item) {
+        uint32_t write = write_.load(std::memory_order_relaxed);
+        uint32_t read = read_.load(std::memory_order_acquire);
+        if (write - read >= Capacity) {
+            return false;
+        }
+        slots_[write & kMask] = std::move(item);
+        write_.store(write + 1, std::memory_order_release);
+        uint32_t size = write + 1 - read;
+        if (size > high_water_.load(std::memory_order_relaxed)) {
+            high_water_.store(size, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    bool Pop(T& item) {
+        uint32_t read = SkipDiscarded();
+        if (read == write_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(slots_[read & kMask]);
+        slots_[read & kMask] = T();
+        read_.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * 查看队首元素 (仅消费者), 队列为空时返回 nullptr
+     */
+    T* Front() {
+        uint32_t read = SkipDiscarded();
+        if (read == write_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots_[read & kMask];
+    }
+
+    void Clear() {
+        uint32_t write = write_.load(std::memory_order_acquire);
+        uint32_t discard = discard_until_.load(std::memory_order_relaxed);
+        while (static_cast<int32_t>(write - discard) > 0 &&
+               !discard_until_.compare_exchange_weak(discard, write, std::memory_order_acq_rel)) {
+        }
+    }
+
+    size_t Size() const {
+        uint32_t write = write_.load(std::memory_order_acquire);
+        uint32_t read = read_.load(std::memory_order_acquire);
+        uint32_t discard = discard_until_.load(std::memory_order_acquire);
+        if (static_cast<int32_t>(discard - read) > 0) {
+            read = discard;
+        }
+        return static_cast<int32_t>(write - read) > 0 ? write - read : 0;
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+    size_t high_water() const { return high_water_.load(std::memory_order_relaxed); }
+    void ResetStatistics() { high_water_.store(Size(), std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t kMask = Capacity - 1;
+
+    // 消费者侧: 丢弃 Clear() 水位之前的元素, 返回新的读位置
+    uint32_t SkipDiscarded() {
+        uint32_t read = read_.load(std::memory_order_relaxed);
+        uint32_t discard = discard_until_.load(std::memory_order_acquire);
+        if (static_cast<int32_t>(discard - read) <= 0) {
+            return read;
+        }
+        while (read != discard) {
+            slots_[read & kMask] = T();
+            read++;
+        }
+        read_.store(read, std::memory_order_release);
+        return read;
+    }
+
+    std::array<T, Capacity> slots_{};
+    std::atomic<uint32_t> write_{0};
+    std::atomic<uint32_t> read_{0};
+    std::atomic<uint32_t> discard_until_{0};
+    std::atomic<uint32_t> high_water_{0};
+};
+
+#endif // AUDIO_QUEUE_H
@@ -15,8 +15,54 @@
 #include "wake_words/custom_wake_word.h"
 #endif
 
+#include <algorithm>
+
 #define TAG "AudioService"
 
+static_assert(MAX_DECODE_PACKETS_IN_QUEUE <= 1024, "decode queue capacity too small");
+// The recording may overrun the limit by the frames still in the encode queue
+static_assert((AUDIO_TESTING_MAX_DURATION_MS + (MAX_ENCODE_TASKS_IN_QUEUE + 1) * OPUS_FRAME_DURATION_MS) / OPUS_MIN_FRAME_DURATION_MS <= 512,
+              "testing queue capacity too small");
+static_assert(MAX_SEND_PACKETS_IN_QUEUE <= 128, "send queue capacity too small");
+static_assert(MAX_ENCODE_TASKS_IN_QUEUE <= 4, "encode queue capacity too small");
+static_assert(MAX_PLAYBACK_TASKS_IN_QUEUE <= 16, "playback queue capacity too small");
+static_assert(MAX_PROMPT_TASKS_IN_QUEUE <= 4, "prompt queue capacity too small");
+static_assert(MAX_DECODE_PACKETS_IN_QUEUE + MAX_SEND_PACKETS_IN_QUEUE + 32 <= AUDIO_PACKET_POOL_SIZE,
+              "packet pool too small for the decode and send queues");
+
+static bool IsEncodeTask(AudioTaskType type) {
+    return type == kAudioTaskTypeEncodeToSendQueue || type == kAudioTaskTypeEncodeToTestingQueue;
+}
+
+static ObjectPool<AudioTask>& GetTaskPool(AudioTaskType type) {
+    static ObjectPool<AudioTask> playback_pool(AUDIO_PLAYBACK_TASK_POOL_SIZE);
+    static ObjectPool<AudioTask> encode_pool(AUDIO_ENCODE_TASK_POOL_SIZE);
+    return IsEncodeTask(type) ? encode_pool : playback_pool;
+}
+
+void AudioTaskDeleter::operator()(AudioTask* task) const {
+    task->timestamp = 0;
+    task->time_scale = 1.0f;
+    task->queued_us = 0;
+    task->origin_us = 0;
+    task->prompt_id = 0;
+    task->prompt_last = false;
+    task->generation = 0;
+    task->pcm.clear();
+    // The type is kept, it picks the pool the task came from
+    GetTaskPool(task->type).Release(task);
+}
+
+AudioTaskPtr AudioTask::Create(AudioTaskType type) {
+    AudioTaskPtr task(GetTaskPool(type).Acquire());
+    task->type = type;
+    return task;
+}
+
+ObjectPoolStatistics AudioTask::GetPoolStatistics(AudioTaskType type) {
+    return GetTaskPool(type).GetStatistics();
+}
+
 
 AudioService::AudioService() {
     event_group_ = xEventGroupCreate();
@@ -33,10 +79,31 @@ void AudioService::Initialize(AudioCodec* codec) {
     codec_ = codec;
     codec_->Start();
 
+    audio_dsp::SelfTest();
+
     /* Setup the audio codec */
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_->SetComplexity(0);
+    opus_decoder_ = std::make_unique<OpusStreamDecoder>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
+    opus_encoder_ = std::make_unique<OpusStreamEncoder>(16000, 1, OPUS_FRAME_DURATION_MS);
+    prompt_decoder_ = std::make_unique<OpusStreamDecoder>(PROMPT_SAMPLE_RATE, 1, PROMPT_FRAME_DURATION_MS);
+
+    /* The uplink encoder starts cheap and is adjusted at runtime from send queue depth and encode time */
+    ConfigureEncoder(OPUS_FRAME_DURATION_MS);
+    time_stretcher_.Configure(codec->output_sample_rate());
+    prompt_cache_.Configure(codec->output_sample_rate(), PROMPT_CACHE_BUDGET_BYTES);
+    audio_mixer_.Configure(codec->output_sample_rate());
+    playback_timeline_.Configure(codec->output_sample_rate());
+    played_prompt_frames_.reserve(MAX_PROMPT_TASKS_IN_QUEUE + 1);
+
+    /* Size the pooled PCM buffers for one frame: playback is mono at the output rate and may be
+       stretched, the encoder takes 16 kHz mono */
+    size_t playback_reserve = OPUS_FRAME_DURATION_MS * codec->output_sample_rate() / 1000 * (100 + TIME_STRETCH_MAX_PERCENT) / 100;
+    GetTaskPool(kAudioTaskTypeDecodeToPlaybackQueue).Prepare([playback_reserve](AudioTask& task) {
+        task.pcm.reserve(playback_reserve);
+    });
+    size_t encode_reserve = OPUS_FRAME_DURATION_MS * 16000 / 1000;
+    GetTaskPool(kAudioTaskTypeEncodeToSendQueue).Prepare([encode_reserve](AudioTask& task) {
+        task.pcm.reserve(encode_reserve);
+    });
 
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
@@ -59,12 +126,28 @@ void AudioService::Initialize(AudioCodec* codec) {
     wake_word_ = nullptr;
 #endif
 
+#if CONFIG_USE_AUDIO_DEBUGGER
+    audio_debugger_ = std::make_unique<AudioDebugger>();
+#endif
+
     audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
-        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
+#if CONFIG_USE_AUDIO_DEBUGGER
+        audio_debugger_->Feed(kAudioDebugTapProcessed, data.data(), data.size(), 16000);
+#endif
+        // The processor's output buffer is its own, copy into a pooled task whose capacity survives the round trip
+        auto task = AudioTask::Create(kAudioTaskTypeEncodeToSendQueue);
+        task->pcm.assign(data.begin(), data.end());
+        PushTaskToEncodeQueue(std::move(task));
     });
 
     audio_processor_->OnVadStateChange([this](bool speaking) {
         voice_detected_ = speaking;
+        if (speaking) {
+            // A reply is likely once the user stops talking
+            if (codec_power_.Request(kCodecPowerOutput)) {
+                output_waiter_.Notify();
+            }
+        }
         if (callbacks_.on_vad_change) {
             callbacks_.on_vad_change(speaking);
         }
@@ -72,30 +155,24 @@ void AudioService::Initialize(AudioCodec* codec) {
 
     if (wake_word_) {
         wake_word_->OnWakeWordDetected([this](const std::string& wake_word) {
+            // The popup sound or the greeting comes next
+            if (codec_power_.Request(kCodecPowerOutput)) {
+                output_waiter_.Notify();
+            }
             if (callbacks_.on_wake_word_detected) {
                 callbacks_.on_wake_word_detected(wake_word);
             }
         });
     }
 
-    esp_timer_create_args_t audio_power_timer_args = {
-        .callback = [](void* arg) {
-            AudioService* audio_service = (AudioService*)arg;
-            audio_service->CheckAndUpdateAudioPowerState();
-        },
-        .arg = this,
-        .dispatch_method = ESP_TIMER_TASK,
-        .name = "audio_power_timer",
-        .skip_unhandled_events = true,
-    };
-    esp_timer_create(&audio_power_timer_args, &audio_power_timer_);
+    codec_power_.Initialize(codec);
 }
 
 void AudioService::Start() {
     service_stopped_ = false;
     xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING | AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING);
 
-    esp_timer_start_periodic(audio_power_timer_, 1000000);
+    codec_power_.Start();
 
 #if CONFIG_USE_AUDIO_PROCESSOR
     /* Start the audio input task */
@@ -127,60 +204,71 @@ void AudioService::Start() {
     }, "audio_output", 4096, this, 9, &audio_output_task_handle_);
 #endif
 
-    /* Start the opus codec task - pinned to core 0 with audio_output */
+    /* Start the opus decoder next to audio_output and the encoder next to audio_input */
+    xTaskCreatePinnedToCore([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->OpusDecodeTask();
+        vTaskDelete(NULL);
+    }, "opus_decode", OPUS_DECODE_TASK_STACK_SIZE, this, OPUS_DECODE_TASK_PRIORITY, &opus_decode_task_handle_, OPUS_DECODE_TASK_CORE);
+
     xTaskCreatePinnedToCore([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
-        audio_service->OpusCodecTask();
+        audio_service->OpusEncodeTask();
         vTaskDelete(NULL);
-    }, "opus_codec", 2048 * 13, this, 5, &opus_codec_task_handle_, 0);
+    }, "opus_encode", OPUS_ENCODE_TASK_STACK_SIZE, this, OPUS_ENCODE_TASK_PRIORITY, &opus_encode_task_handle_, OPUS_ENCODE_TASK_CORE);
 }
 
 void AudioService::Stop() {
-    esp_timer_stop(audio_power_timer_);
+    codec_power_.Stop();
     service_stopped_ = true;
     xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
         AS_EVENT_WAKE_WORD_RUNNING |
         AS_EVENT_AUDIO_PROCESSOR_RUNNING);
 
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_encode_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    audio_encode_queue_.Clear();
+    audio_decode_queue_.Clear();
+    audio_playback_queue_.Clear();
+    audio_prompt_queue_.Clear();
+    audio_testing_queue_.Clear();
+    WakeAllTasks();
+}
+
+void AudioService::WakeAllTasks() {
+    decode_waiter_.Notify();
+    encode_waiter_.Notify();
+    output_waiter_.Notify();
+    decode_space_waiter_.Notify();
+    encode_space_waiter_.Notify();
 }
 
 bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
-    if (!codec_->input_enabled()) {
-        codec_->EnableInput(true);
-        esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-    }
+    codec_power_.Ensure(kCodecPowerInput);
 
     if (codec_->input_sample_rate() != sample_rate) {
-        data.resize(samples * codec_->input_sample_rate() / sample_rate);
-        if (!codec_->InputData(data)) {
+        int input_samples = samples * codec_->input_sample_rate() / sample_rate;
+        int16_t* raw = input_buffer_.Resize(input_samples);
+        if (raw == nullptr || !codec_->InputData(raw, input_samples)) {
             return false;
         }
         if (codec_->input_channels() == 2) {
-            auto mic_channel = std::vector<int16_t>(data.size() / 2);
-            auto reference_channel = std::vector<int16_t>(data.size() / 2);
-            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
-                mic_channel[i] = data[j];
-                reference_channel[i] = data[j + 1];
-            }
-            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
-            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
-            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
-            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
-            data.resize(resampled_mic.size() + resampled_reference.size());
-            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
-                data[j] = resampled_mic[i];
-                data[j + 1] = resampled_reference[i];
+            int frames = input_samples / 2;
+            int16_t* mic = mic_buffer_.Resize(frames);
+            int16_t* reference = reference_buffer_.Resize(frames);
+            int mic_samples = input_resampler_.GetOutputSamples(frames);
+            int reference_samples = reference_resampler_.GetOutputSamples(frames);
+            int16_t* resampled_mic = resampled_mic_buffer_.Resize(mic_samples);
+            int16_t* resampled_reference = resampled_reference_buffer_.Resize(reference_samples);
+            if (mic == nullptr || reference == nullptr || resampled_mic == nullptr || resampled_reference == nullptr) {
+                return false;
             }
+            audio_dsp::Deinterleave2(raw, mic, reference, frames);
+            input_resampler_.Process(mic, frames, resampled_mic);
+            reference_resampler_.Process(reference, frames, resampled_reference);
+            data.resize(mic_samples + reference_samples);
+            audio_dsp::Interleave2(resampled_mic, resampled_reference, data.data(), mic_samples);
         } else {
-            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
-            input_resampler_.Process(data.data(), data.size(), resampled.data());
-            data = std::move(resampled);
+            data.resize(input_resampler_.GetOutputSamples(input_samples));
+            input_resampler_.Process(raw, input_samples, data.data());
         }
     } else {
         data.resize(samples);
@@ -189,16 +277,17 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
         }
     }
 
-    /* Update the last input time */
-    last_input_time_ = std::chrono::steady_clock::now();
+    last_capture_us_.store(esp_timer_get_time(), std::memory_order_relaxed);
     debug_statistics_.input_count++;
 
 #if CONFIG_USE_AUDIO_DEBUGGER
-    // 音频调试：发送原始音频数据
-    if (audio_debugger_ == nullptr) {
-        audio_debugger_ = std::make_unique<AudioDebugger>();
+    if (codec_->input_channels() == 2) {
+        size_t frames = data.size() / 2;
+        audio_debugger_->FeedChannel(kAudioDebugTapMic, data.data(), frames, 2, 0, sample_rate);
+        audio_debugger_->FeedChannel(kAudioDebugTapReference, data.data(), frames, 2, 1, sample_rate);
+    } else {
+        audio_debugger_->Feed(kAudioDebugTapMic, data.data(), data.size(), sample_rate);
     }
-    audio_debugger_->Feed(data);
 #endif
 
     return true;
@@ -207,7 +296,7 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
 void AudioService::AudioInputTask() {
     while (true) {
         EventBits_t bits = xEventGroupWaitBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
-            AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING,
+            AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING | AS_EVENT_LOOPBACK_TEST_RUNNING,
             pdFALSE, pdFALSE, portMAX_DELAY);
 
         if (service_stopped_) {
@@ -215,40 +304,52 @@ void AudioService::AudioInputTask() {
         }
         if (audio_input_need_warmup_) {
             audio_input_need_warmup_ = false;
+            // The codec powers up while the pipeline settles, not on the first read
+            codec_power_.Ensure(kCodecPowerInput);
             vTaskDelay(pdMS_TO_TICKS(120));
             continue;
         }
 
+        /* Loopback self-test: wake word and audio processor are not fed until the capture ends */
+        if (bits & AS_EVENT_LOOPBACK_TEST_RUNNING) {
+            codec_power_.Ensure(kCodecPowerInput);
+            loopback_test_->Capture(codec_);
+            xEventGroupClearBits(event_group_, AS_EVENT_LOOPBACK_TEST_RUNNING);
+            xEventGroupSetBits(event_group_, AS_EVENT_LOOPBACK_INPUT_DONE);
+            ReleaseLoopbackTest();
+            continue;
+        }
+
         /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
         if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
-            if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
+            // Counted in time, the encoder may run 20 ms frames after a session negotiated them
+            if (audio_testing_duration_ms_.load(std::memory_order_relaxed) >= AUDIO_TESTING_MAX_DURATION_MS) {
                 ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
                 EnableAudioTesting(false);
                 continue;
             }
-            std::vector<int16_t> data;
+            // Read straight into the pooled task, it goes to the encoder as is
+            auto task = AudioTask::Create(kAudioTaskTypeEncodeToTestingQueue);
+            auto& data = task->pcm;
             int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
             if (ReadAudioData(data, 16000, samples)) {
                 // If input channels is 2, we need to fetch the left channel data
                 if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
-                    }
-                    data = std::move(mono_data);
+                    // In place: each output sample is written at or before the input it came from
+                    audio_dsp::ExtractChannel(data.data(), data.data(), data.size() / 2, 2, 0);
+                    data.resize(data.size() / 2);
                 }
-                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
+                PushTaskToEncodeQueue(std::move(task));
                 continue;
             }
         }
 
         /* Feed the wake word */
         if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
             int samples = wake_word_->GetFeedSize();
             if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    wake_word_->Feed(data);
+                if (ReadAudioData(input_data_, 16000, samples)) {
+                    wake_word_->Feed(input_data_);
                     continue;
                 }
             }
@@ -256,11 +357,11 @@ void AudioService::AudioInputTask() {
 
         /* Feed the audio processor */
         if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-            std::vector<int16_t> data;
             int samples = audio_processor_->GetFeedSize();
             if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    audio_processor_->Feed(std::move(data));
+                if (ReadAudioData(input_data_, 16000, samples)) {
+                    // The processors read the frame without taking it, input_data_ keeps its capacity
+                    audio_processor_->Feed(std::move(input_data_));
                     continue;
                 }
             }
@@ -273,113 +374,140 @@ void AudioService::AudioInputTask() {
     ESP_LOGW(TAG, "Audio input task stopped");
 }
 
+// Buffering state machine, evaluated by AudioOutputTask before it takes a frame
+bool AudioService::IsOutputReady() {
+    int total_frames = audio_decode_queue_.Size() + audio_playback_queue_.Size();
+    return buffering_.IsOutputReady(esp_timer_get_time(), total_frames, !audio_playback_queue_.Empty());
+}
+
 void AudioService::AudioOutputTask() {
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-
         // 等待条件：有数据可播放，或者需要停止
         // 如果正在预缓冲，还需要等待达到预缓冲阈值
-        audio_queue_cv_.wait(lock, [this]() {
-            if (service_stopped_) return true;
-            
-            int total_frames = audio_decode_queue_.size() + audio_playback_queue_.size();
-
-            // State Machine Logic for Waiting
-            if (audio_state_ == AudioState::BUFFERING) {
-                if (total_frames >= BUFFER_START_THRESHOLD_FRAMES) {
-                    ESP_LOGI(TAG, "Buffering complete: %d frames, starting playback", total_frames);
-                    audio_state_ = AudioState::PLAYING;
-                    // Fall through to check playback queue
-                } else {
-                    return false;
-                }
+        // Prompts do not wait for the speech buffering, they play alone until speech is ready
+        AudioTaskPtr task;
+        while (!service_stopped_) {
+            if (loopback_output_pending_.load(std::memory_order_acquire)) {
+                break;
             }
-            
-            if (audio_state_ == AudioState::REBUFFERING) {
-                if (total_frames >= BUFFER_RESUME_THRESHOLD_FRAMES) {
-                    ESP_LOGI(TAG, "Rebuffering complete: %d frames, resuming playback", total_frames);
-                    audio_state_ = AudioState::PLAYING;
-                    // Fall through to check playback queue
-                } else {
-                    return false;
+            if (IsOutputReady() && audio_playback_queue_.Pop(task)) {
+                if (task->generation == playback_generation_.load(std::memory_order_acquire)) {
+                    break;
                 }
+                // Decoded before AbortPlayback() cleared the queue
+                task.reset();
+                decode_waiter_.Notify();
+                continue;
             }
-
-            // In PLAYING state
-            if (audio_playback_queue_.empty()) {
-                // Check for underrun
-                if (audio_decode_queue_.empty()) {
-                    ESP_LOGW(TAG, "Buffer underrun, switching to REBUFFERING");
-                    audio_state_ = AudioState::REBUFFERING;
-                    return false;
-                }
-                // Wait for decoder to push to playback queue
-                ESP_LOGW(TAG, "Playback queue empty, waiting for decoder (decode queue: %d)", audio_decode_queue_.size());
-                return false;
+            if (HasPromptOutput()) {
+                break;
             }
-            
-            return true;
-        });
+            if (codec_power_.requested(kCodecPowerOutput)) {
+                // Power up while the jitter buffer fills, the first frame then plays without the warm-up
+                codec_power_.Ensure(kCodecPowerOutput);
+                continue;
+            }
+            output_waiter_.Prepare();
+            if (service_stopped_ || IsOutputReady() || HasPromptOutput() || codec_power_.requested(kCodecPowerOutput) ||
+                loopback_output_pending_.load(std::memory_order_acquire)) {
+                output_waiter_.Cancel();
+                continue;
+            }
+            output_waiter_.Wait(portMAX_DELAY);
+        }
 
         if (service_stopped_) {
             break;
         }
 
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
-        // 检查播放队列和解码队列是否都为空 (解码队列为空意味着没有更多数据会被添加到播放队列)
-        bool playback_idle = audio_playback_queue_.empty() && audio_decode_queue_.empty();
-        audio_queue_cv_.notify_all();
-        lock.unlock();
+        if (task == nullptr && loopback_output_pending_.load(std::memory_order_acquire)) {
+            // The self-test signal goes straight to the codec, the mixer and prompts wait
+            if (codec_->output_flushed()) {
+                codec_->ResumeOutput();
+            }
+            codec_power_.Ensure(kCodecPowerOutput);
+            loopback_test_->Play(codec_);
+            loopback_output_pending_.store(false, std::memory_order_release);
+            xEventGroupSetBits(event_group_, AS_EVENT_LOOPBACK_OUTPUT_DONE);
+            ReleaseLoopbackTest();
+            continue;
+        }
 
-        if (!codec_->output_enabled()) {
-            codec_->EnableOutput(true);
-            esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
+        // The decoder may be blocked on a full playback queue
+        decode_waiter_.Notify();
+
+        audio_mixer_.SetGain(kAudioMixerStreamMain, stream_gains_[kAudioMixerStreamMain].load(std::memory_order_relaxed));
+        audio_mixer_.SetGain(kAudioMixerStreamPrompt, stream_gains_[kAudioMixerStreamPrompt].load(std::memory_order_relaxed));
+        bool speech_frame = task != nullptr;
+        if (speech_frame && task->queued_us > 0) {
+            latency_[kAudioLatencyPlaybackWait].Add(esp_timer_get_time() - task->queued_us);
+        }
+        if (speech_frame) {
+            audio_mixer_.Mix(task->pcm, GatherPromptSamples(task->pcm.size()));
+        } else {
+            task = AudioTask::Create(kAudioTaskTypeDecodeToPlaybackQueue);
+            audio_mixer_.MixPromptOnly(task->pcm, GatherPromptSamples(0));
         }
-        
-        int64_t start_time = esp_timer_get_time();
-        codec_->OutputData(task->pcm);
-        int64_t end_time = esp_timer_get_time();
-        
-        int elapsed_us = (int)(end_time - start_time);
 
-        // Trace log every 100 frames (减少日志频率以降低 UART 竞争)
-        static int frame_count = 0;
-        static int slow_frame_count = 0;
-        frame_count++;
+        // 检查播放队列和解码队列是否都为空 (解码队列为空意味着没有更多数据会被添加到播放队列)
+        bool playback_idle = audio_playback_queue_.Empty() && audio_decode_queue_.Empty() && !HasPromptOutput() &&
+                             !prompt_player_.HasFrames() && !cached_prompt_playing_.load(std::memory_order_acquire);
 
-        // 只在真正异常时警告（>65ms，正常帧是60ms）
-        if (elapsed_us > 65000) {
-            slow_frame_count++;
-            // 每 500 次慢帧打印一次
-            if (slow_frame_count % 500 == 0) {
-                ESP_LOGW(TAG, "OutputData slow: %d us (slow_count=%d), Queue: %d",
-                         elapsed_us, slow_frame_count, (int)audio_playback_queue_.size());
+        if (task->pcm.empty()) {
+            // Every prompt frame that was waiting had been cancelled
+            for (const auto& played : played_prompt_frames_) {
+                prompt_player_.OnFramePlayed(played.first, played.second);
+            }
+            played_prompt_frames_.clear();
+            if (playback_idle && callbacks_.on_playback_idle) {
+                callbacks_.on_playback_idle();
             }
+            continue;
         }
 
-        if (frame_count % 500 == 0) {  // 从 100 改为 500，减少日志
-             ESP_LOGI(TAG, "Playback: Frame %d, Q: P=%d D=%d",
-                      frame_count, (int)audio_playback_queue_.size(), (int)audio_decode_queue_.size());
+        if (codec_->output_flushed()) {
+            // The abort may have landed while this frame was being mixed
+            if (speech_frame && task->generation != playback_generation_.load(std::memory_order_acquire)) {
+                played_prompt_frames_.clear();
+                continue;
+            }
+            codec_->ResumeOutput();
+        }
+
+        codec_power_.Ensure(kCodecPowerOutput);
+
+#if CONFIG_USE_AUDIO_DEBUGGER
+        audio_debugger_->Feed(kAudioDebugTapOutput, task->pcm.data(), task->pcm.size(), codec_->output_sample_rate());
+#endif
+#if CONFIG_USE_SERVER_AEC
+        if (speech_frame && task->timestamp > 0) {
+            playback_timeline_.OnFrameWritten(codec_->output_written_frames(), task->pcm.size(), task->timestamp,
+                                              task->time_scale);
+        }
+#endif
+        int64_t start_time = esp_timer_get_time();
+        codec_->OutputData(task->pcm);
+        int64_t end_time = esp_timer_get_time();
+        latency_[kAudioLatencyOutput].Add(end_time - start_time);
+        if (speech_frame && task->origin_us > 0) {
+            latency_[kAudioLatencyDownlink].Add(end_time - task->origin_us);
         }
 
         // 只在队列严重不足时才警告
-        if (audio_state_ == AudioState::PLAYING && audio_playback_queue_.size() < 3) {
-             ESP_LOGW(TAG, "Playback queue critical: %d", (int)audio_playback_queue_.size());
+        if (speech_frame && buffering_.state() == AudioState::PLAYING && audio_playback_queue_.Size() < 3) {
+             ESP_LOGW(TAG, "Playback queue critical: %d", (int)audio_playback_queue_.Size());
+        }
+
+        if (speech_frame) {
+            buffering_.OnFramePlayed();
         }
+        for (const auto& played : played_prompt_frames_) {
+            prompt_player_.OnFramePlayed(played.first, played.second);
+        }
+        played_prompt_frames_.clear();
 
-        /* Update the last output time */
-        last_output_time_ = std::chrono::steady_clock::now();
         debug_statistics_.playback_count++;
 
-#if CONFIG_USE_SERVER_AEC
-        /* Record the timestamp for server AEC */
-        if (task->timestamp > 0) {
-            lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
-            lock.unlock();
-        }
-#endif
         // 在播放完成后，如果队列为空，通知应用层
         if (playback_idle && callbacks_.on_playback_idle) {
             callbacks_.on_playback_idle();
@@ -389,91 +517,410 @@ void AudioService::AudioOutputTask() {
     ESP_LOGW(TAG, "Audio output task stopped");
 }
 
-void AudioService::OpusCodecTask() {
+bool AudioService::HasPromptOutput() const {
+    return mixing_prompt_ != nullptr || !audio_prompt_queue_.Empty();
+}
+
+size_t AudioService::GatherPromptSamples(size_t max_samples) {
+    // With max_samples == 0 the rest of one prompt task is taken, which keeps cached 20 ms chunks short
+    size_t gathered = 0;
+    int16_t* buffer = max_samples > 0 ? audio_mixer_.PromptBuffer(max_samples) : nullptr;
+    while (max_samples == 0 ? gathered == 0 : gathered < max_samples) {
+        if (mixing_prompt_ == nullptr) {
+            if (!audio_prompt_queue_.Pop(mixing_prompt_)) {
+                break;
+            }
+            mixing_prompt_offset_ = 0;
+            decode_waiter_.Notify();
+        }
+        if (!prompt_player_.IsActive(mixing_prompt_->prompt_id)) {
+            // The prompt was cancelled after this frame was decoded
+            mixing_prompt_.reset();
+            continue;
+        }
+
+        size_t count = mixing_prompt_->pcm.size() - mixing_prompt_offset_;
+        if (max_samples == 0) {
+            buffer = count > 0 ? audio_mixer_.PromptBuffer(count) : nullptr;
+        } else {
+            count = std::min(count, max_samples - gathered);
+        }
+        if (count > 0) {
+            if (buffer == nullptr) {
+                break;
+            }
+            std::copy_n(mixing_prompt_->pcm.data() + mixing_prompt_offset_, count, buffer + gathered);
+            gathered += count;
+            mixing_prompt_offset_ += count;
+        }
+        if (mixing_prompt_offset_ == mixing_prompt_->pcm.size()) {
+            played_prompt_frames_.emplace_back(mixing_prompt_->prompt_id, mixing_prompt_->prompt_last);
+            mixing_prompt_.reset();
+            if (max_samples == 0) {
+                break;
+            }
+        }
+    }
+    return gathered;
+}
+
+bool AudioService::CanDecodePrompt() const {
+    return (prompt_player_.HasFrames() || cached_prompt_ != nullptr) &&
+           audio_prompt_queue_.Size() < MAX_PROMPT_TASKS_IN_QUEUE;
+}
+
+bool AudioService::CanDecode() const {
+    return CanDecodePrompt() ||
+           (!audio_decode_queue_.Empty() && audio_playback_queue_.Size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
+}
+
+bool AudioService::CanEncode() const {
+    return !audio_encode_queue_.Empty() && audio_send_queue_.Size() < MaxSendPackets();
+}
+
+size_t AudioService::MaxDecodePackets() const {
+    return MAX_DECODE_QUEUE_DURATION_MS / decode_frame_duration_ms_.load(std::memory_order_relaxed);
+}
+
+size_t AudioService::MaxSendPackets() const {
+    return MAX_SEND_QUEUE_DURATION_MS / encode_frame_duration_ms_.load(std::memory_order_relaxed);
+}
+
+void AudioService::OpusDecodeTask() {
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() {
-            return service_stopped_ ||
-                (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
-        });
+        while (!service_stopped_ && !CanDecode()) {
+            decode_waiter_.Prepare();
+            if (service_stopped_ || CanDecode()) {
+                decode_waiter_.Cancel();
+                break;
+            }
+            decode_waiter_.Wait(portMAX_DELAY);
+        }
         if (service_stopped_) {
             break;
         }
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
-            audio_decode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto task = std::make_unique<AudioTask>();
-            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
-
-            SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
-                // Resample if the sample rate is different
-                // Resample if the sample rate is different
-                if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
-                    int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
-                    if (resample_buffer_.size() < target_size) {
-                        resample_buffer_.resize(target_size);
-                    }
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resample_buffer_.data());
-                    task->pcm.assign(resample_buffer_.begin(), resample_buffer_.begin() + target_size);
-                }
+        // Read before popping, a packet popped just before an abort is tagged with the old generation
+        uint32_t generation = playback_generation_.load(std::memory_order_acquire);
+        if (decoder_reset_pending_.exchange(false)) {
+            opus_decoder_->ResetState();
+            if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
+                output_resampler_.Configure(opus_decoder_->sample_rate(), codec_->output_sample_rate());
+            }
+        }
 
-                lock.lock();
-                audio_playback_queue_.push_back(std::move(task));
-                audio_queue_cv_.notify_all();
-            } else {
-                ESP_LOGE(TAG, "Failed to decode audio");
-                lock.lock();
-            }
-            debug_statistics_.decode_count++;
-        }
-        
-        /* Encode the audio to send queue */
-        if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
-            auto task = std::move(audio_encode_queue_.front());
-            audio_encode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->frame_duration = OPUS_FRAME_DURATION_MS;
-            packet->sample_rate = 16000;
-            packet->timestamp = task->timestamp;
-            if (!opus_encoder_->Encode(std::move(task->pcm), packet->payload)) {
-                ESP_LOGE(TAG, "Failed to encode audio");
-                continue;
+        if (CanDecodePrompt()) {
+            // Prompts are short and mixed over the speech, they do not wait behind queued packets
+            DecodePromptFrame();
+            continue;
+        }
+
+        AudioStreamPacketPtr packet;
+        if (!audio_decode_queue_.Pop(packet)) {
+            continue;
+        }
+        decode_space_waiter_.Notify();
+
+        int64_t start_time = esp_timer_get_time();
+        if (packet->queued_us > 0) {
+            latency_[kAudioLatencyDecodeWait].Add(start_time - packet->queued_us);
+        }
+
+        auto task = AudioTask::Create(kAudioTaskTypeDecodeToPlaybackQueue);
+        task->timestamp = packet->timestamp;
+        task->generation = generation;
+        task->origin_us = packet->queued_us;
+
+        SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
+        if (packet->missing_before > 0) {
+            ConcealLostFrames(*packet, generation);
+        }
+        // The payload may still be referenced by event subscribers, decoding only reads it
+        bool decoded = opus_decoder_->Decode(packet->payload, task->pcm);
+        latency_[kAudioLatencyDecode].Add(esp_timer_get_time() - start_time);
+        if (decoded) {
+#if CONFIG_USE_AUDIO_DEBUGGER
+            audio_debugger_->Feed(kAudioDebugTapDecoded, task->pcm.data(), task->pcm.size(), opus_decoder_->sample_rate());
+#endif
+            PushTaskToPlaybackQueue(std::move(task));
+        } else {
+            ESP_LOGE(TAG, "Failed to decode audio");
+        }
+        debug_statistics_.decode_count++;
+    }
+
+    ESP_LOGW(TAG, "Opus decode task stopped");
+}
+
+void AudioService::DecodePromptFrame() {
+    if (cached_prompt_ != nullptr) {
+        PlayCachedPromptChunk();
+        return;
+    }
+
+    PromptFrame frame;
+    if (!prompt_player_.NextFrame(frame)) {
+        return;
+    }
+
+    if (frame.first) {
+        auto pcm = prompt_cache_.Lookup(frame.sound);
+        if (pcm != nullptr) {
+            // Hit: the rest of the asset is not read, the PCM goes out in DMA sized chunks
+            prompt_player_.SkipRest(frame.id);
+            cached_prompt_ = std::move(pcm);
+            cached_prompt_id_ = frame.id;
+            cached_prompt_offset_ = 0;
+            cached_prompt_playing_.store(true, std::memory_order_release);
+            PlayCachedPromptChunk();
+            return;
+        }
+        // Miss: record the output while decoding so the next play is a hit
+        recording_prompt_ = frame.last ? nullptr : prompt_cache_.CreateEntry(frame.sound);
+        recording_prompt_sound_ = frame.sound;
+        recording_prompt_id_ = frame.id;
+    }
+
+    auto task = AudioTask::Create(kAudioTaskTypeDecodeToPlaybackQueue);
+    task->prompt_id = frame.id;
+    task->prompt_last = frame.last;
+
+    // Prompts have their own decoder so they never disturb the state of the speech decoder
+    if (frame.first) {
+        prompt_decoder_->ResetState();
+        if (codec_->output_sample_rate() != PROMPT_SAMPLE_RATE) {
+            prompt_resampler_.Configure(PROMPT_SAMPLE_RATE, codec_->output_sample_rate());
+        }
+    }
+    // Decoded straight from the mapped asset, the frame is never copied
+    if (prompt_decoder_->Decode(frame.data, frame.size, task->pcm)) {
+        if (codec_->output_sample_rate() != PROMPT_SAMPLE_RATE) {
+            int target_size = prompt_resampler_.GetOutputSamples(task->pcm.size());
+            if (resample_buffer_.size() < target_size) {
+                resample_buffer_.resize(target_size);
+            }
+            prompt_resampler_.Process(task->pcm.data(), task->pcm.size(), resample_buffer_.data());
+            task->pcm.assign(resample_buffer_.begin(), resample_buffer_.begin() + target_size);
+        }
+        if (recording_prompt_ != nullptr && recording_prompt_id_ == frame.id &&
+            !recording_prompt_->Append(task->pcm.data(), task->pcm.size())) {
+            recording_prompt_.reset();
+        }
+        PushTaskToPromptQueue(std::move(task));
+    } else {
+        ESP_LOGE(TAG, "Failed to decode prompt frame");
+        recording_prompt_.reset();
+        prompt_player_.OnFramePlayed(frame.id, frame.last);
+    }
+    if (frame.last && recording_prompt_ != nullptr && recording_prompt_id_ == frame.id) {
+        prompt_cache_.Insert(recording_prompt_sound_, std::move(recording_prompt_));
+        recording_prompt_.reset();
+    }
+}
+
+void AudioService::PlayCachedPromptChunk() {
+    if (!prompt_player_.IsActive(cached_prompt_id_)) {
+        // Cancelled while being played
+        cached_prompt_.reset();
+        cached_prompt_playing_.store(false, std::memory_order_release);
+        return;
+    }
+
+    size_t chunk = PROMPT_CACHE_CHUNK_MS * codec_->output_sample_rate() / 1000;
+    size_t count = std::min(chunk, cached_prompt_->size() - cached_prompt_offset_);
+    auto task = AudioTask::Create(kAudioTaskTypeDecodeToPlaybackQueue);
+    task->prompt_id = cached_prompt_id_;
+    const int16_t* samples = cached_prompt_->samples() + cached_prompt_offset_;
+    task->pcm.assign(samples, samples + count);
+    cached_prompt_offset_ += count;
+    task->prompt_last = cached_prompt_offset_ >= cached_prompt_->size();
+    if (task->prompt_last) {
+        cached_prompt_.reset();
+        cached_prompt_playing_.store(false, std::memory_order_release);
+    }
+    PushTaskToPromptQueue(std::move(task));
+}
+
+void AudioService::PushTaskToPromptQueue(AudioTaskPtr task) {
+    audio_prompt_queue_.Push(std::move(task));
+    output_waiter_.Notify();
+}
+
+void AudioService::OpusEncodeTask() {
+    while (true) {
+        while (!service_stopped_ && !CanEncode()) {
+            encode_waiter_.Prepare();
+            if (service_stopped_ || CanEncode()) {
+                encode_waiter_.Cancel();
+                break;
             }
+            encode_waiter_.Wait(portMAX_DELAY);
+        }
+        if (service_stopped_) {
+            break;
+        }
 
+        AudioTaskPtr task;
+        if (!audio_encode_queue_.Pop(task)) {
+            continue;
+        }
+        encode_space_waiter_.Notify();
+
+        if (task->queued_us > 0) {
+            latency_[kAudioLatencyEncodeWait].Add(esp_timer_get_time() - task->queued_us);
+        }
+
+        int frame_duration = pending_frame_duration_ms_.exchange(0);
+        if (frame_duration > 0) {
+            ConfigureEncoder(frame_duration);
+            ESP_LOGI(TAG, "Encoder frame duration %d ms", opus_encoder_->duration_ms());
+        }
+
+        // One input block may yield zero, one or several frames depending on the current frame duration
+        opus_encoder_->Write(task->pcm.data(), task->pcm.size(), task->timestamp);
+        while (true) {
+            int64_t start_time = esp_timer_get_time();
+            auto packet = AudioStreamPacket::Create();
+            // The timestamp of the packet's first sample, which may lie in an earlier input block
+            if (!opus_encoder_->Read(packet->payload, &packet->timestamp)) {
+                break;
+            }
+            int64_t end_time = esp_timer_get_time();
+            int encode_us = end_time - start_time;
+            latency_[kAudioLatencyEncode].Add(encode_us);
+
+            packet->frame_duration = opus_encoder_->duration_ms();
+            packet->sample_rate = 16000;
+#if CONFIG_USE_SERVER_AEC
+            if (packet->timestamp > 0) {
+                packet->timestamp_skew_us = codec_->GetPlaybackClockStatistics().residual_us;
+            }
+#endif
+            packet->capture_us = task->origin_us;
             if (task->type == kAudioTaskTypeEncodeToSendQueue) {
-                {
-                    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                    audio_send_queue_.push_back(std::move(packet));
+                packet->queued_us = end_time;
+                if (!audio_send_queue_.Push(std::move(packet))) {
+                    ESP_LOGW(TAG, "Send queue full, dropping encoded frame");
                 }
                 if (callbacks_.on_send_queue_available) {
                     callbacks_.on_send_queue_available();
                 }
+                // Only the live uplink drives rate control
+                int queued_ms = audio_send_queue_.Size() * opus_encoder_->duration_ms();
+                rate_controller_.OnFrameEncoded(encode_us, opus_encoder_->duration_ms(), queued_ms);
             } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
-                std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                audio_testing_queue_.push_back(std::move(packet));
+                if (audio_testing_queue_.Push(std::move(packet))) {
+                    audio_testing_duration_ms_.fetch_add(opus_encoder_->duration_ms(), std::memory_order_relaxed);
+                }
             }
             debug_statistics_.encode_count++;
-            lock.lock();
         }
-        
-        static int codec_frame_count = 0;
-        if (++codec_frame_count % 500 == 0) {  // 减少日志频率
-            ESP_LOGI(TAG, "Codec Stack: %d", (int)uxTaskGetStackHighWaterMark(NULL));
+
+        OpusEncoderSettings settings;
+        if (rate_controller_.Update(settings)) {
+            ApplyEncoderSettings(settings);
+            auto stats = rate_controller_.GetStatistics();
+            ESP_LOGI(TAG, "Encoder: %d bps, complexity %d, dtx %d, %d ms (%s, load %lu%%, backlog %lu ms)",
+                     settings.bitrate, settings.complexity, settings.dtx, settings.frame_duration_ms,
+                     stats.last_reason, (unsigned long)stats.load_percent, (unsigned long)stats.max_queued_ms);
         }
     }
 
-    ESP_LOGW(TAG, "Opus codec task stopped");
+    ESP_LOGW(TAG, "Opus encode task stopped");
+}
+
+void AudioService::ConfigureEncoder(int frame_duration_ms) {
+    // A clear link uses the negotiated duration, congestion may still fall back to the longest frame
+    OpusRateBounds rate_bounds;
+    rate_bounds.min_frame_duration_ms = frame_duration_ms;
+    rate_bounds.max_frame_duration_ms = std::max(frame_duration_ms, OPUS_FRAME_DURATION_MS);
+    OpusEncoderSettings encoder_settings = rate_controller_.GetStatistics().settings;
+    encoder_settings.frame_duration_ms = frame_duration_ms;
+    rate_controller_.Configure(rate_bounds, encoder_settings);
+    ApplyEncoderSettings(rate_controller_.GetStatistics().settings);
+}
+
+void AudioService::ApplyEncoderSettings(const OpusEncoderSettings& settings) {
+    opus_encoder_->SetBitrate(settings.bitrate);
+    opus_encoder_->SetComplexity(settings.complexity);
+    opus_encoder_->SetDtx(settings.dtx);
+    opus_encoder_->SetDuration(settings.frame_duration_ms);
+    encode_frame_duration_ms_.store(opus_encoder_->duration_ms(), std::memory_order_relaxed);
+}
+
+void AudioService::SetFrameDuration(int frame_duration_ms) {
+    if (frame_duration_ms_.exchange(frame_duration_ms) == frame_duration_ms) {
+        return;
+    }
+    ESP_LOGI(TAG, "Session frame duration %d ms", frame_duration_ms);
+    pending_frame_duration_ms_ = frame_duration_ms;
+}
+
+void AudioService::PushTaskToPlaybackQueue(AudioTaskPtr task) {
+    int64_t start_time = esp_timer_get_time();
+    // Resample if the sample rate is different
+    if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
+        int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
+        if (resample_buffer_.size() < target_size) {
+            resample_buffer_.resize(target_size);
+        }
+        output_resampler_.Process(task->pcm.data(), task->pcm.size(), resample_buffer_.data());
+        task->pcm.assign(resample_buffer_.begin(), resample_buffer_.begin() + target_size);
+    }
+
+    if (stretch_reset_pending_.exchange(false)) {
+        time_stretcher_.Reset();
+        buffering_.ResetStretchRatio();
+    }
+    int buffered_frames = audio_decode_queue_.Size() + audio_playback_queue_.Size();
+    float ratio = buffering_.UpdateStretchRatio(buffered_frames, decode_frame_duration_ms_.load(std::memory_order_relaxed));
+    time_stretcher_.Process(task->pcm, ratio);
+    int64_t end_time = esp_timer_get_time();
+    latency_[kAudioLatencyResample].Add(end_time - start_time);
+    if (task->pcm.empty()) {
+        // Held back as look-ahead for the next segment
+        return;
+    }
+    if (task->timestamp > 0) {
+        // The stretched output starts behind this frame's input by the look-ahead, and runs at another speed
+        int64_t timestamp = task->timestamp +
+                            (int64_t)time_stretcher_.output_offset() * 1000 / codec_->output_sample_rate();
+        task->timestamp = timestamp > 0 ? timestamp : 0;
+        task->time_scale = time_stretcher_.output_scale();
+    }
+
+    task->queued_us = end_time;
+    audio_playback_queue_.Push(std::move(task));
+    output_waiter_.Notify();
+}
+
+void AudioService::ConcealLostFrames(const AudioStreamPacket& next_packet, uint32_t generation) {
+    int missing = next_packet.missing_before;
+    int count = std::min(missing, MAX_CONCEALED_FRAMES);
+    lost_frames_ += missing;
+
+    for (int i = 0; i < count; i++) {
+        auto task = AudioTask::Create(kAudioTaskTypeDecodeToPlaybackQueue);
+        task->generation = generation;
+        task->origin_us = next_packet.queued_us;
+        // Only the frame right before the next packet can be recovered from its in-band FEC
+        bool use_fec = (i == count - 1);
+        bool ok = use_fec ? opus_decoder_->DecodeFec(next_packet.payload, task->pcm)
+                          : opus_decoder_->Conceal(task->pcm);
+        if (!ok) {
+            break;
+        }
+        concealed_frames_++;
+        if (use_fec) {
+            fec_frames_++;
+        }
+        PushTaskToPlaybackQueue(std::move(task));
+    }
+
+    if (concealed_frames_ <= 10 || concealed_frames_ % 100 == 0) {
+        ESP_LOGW(TAG, "Concealed %d of %d lost frames (total concealed %lu)",
+                 count, missing, (unsigned long)concealed_frames_);
+    }
 }
 
 void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
@@ -482,7 +929,7 @@ void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
     }
 
     opus_decoder_.reset();
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
+    opus_decoder_ = std::make_unique<OpusStreamDecoder>(sample_rate, 1, frame_duration);
 
     auto codec = Board::GetInstance().GetAudioCodec();
     if (opus_decoder_->sample_rate() != codec->output_sample_rate()) {
@@ -491,56 +938,83 @@ void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
     }
 }
 
-void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm) {
-    auto task = std::make_unique<AudioTask>();
-    task->type = type;
-    task->pcm = std::move(pcm);
-    
-    /* Push the task to the encode queue */
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
+void AudioService::PushTaskToEncodeQueue(AudioTaskPtr task) {
+    task->timestamp = 0;
 
-    /* If the task is to send queue, we need to set the timestamp */
-    if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_queue_.empty()) {
-        if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
-            task->timestamp = timestamp_queue_.front();
-        } else {
-            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
+    if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+        task->origin_us = last_capture_us_.load(std::memory_order_relaxed);
+#if CONFIG_USE_SERVER_AEC
+        /* Tag the frame with the downlink position the speaker was playing when its first sample was captured */
+        uint64_t position;
+        int64_t first_sample_us = task->origin_us - (int64_t)task->pcm.size() * 1000000 / 16000;
+        if (task->origin_us > 0 && codec_->GetPlaybackPosition(first_sample_us, position)) {
+            task->timestamp = playback_timeline_.TimestampAt(position);
         }
-        timestamp_queue_.pop_front();
+#endif
     }
 
-    audio_queue_cv_.wait(lock, [this]() { return audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE; });
-    audio_encode_queue_.push_back(std::move(task));
+    /* Push the task to the encode queue, wait for the codec task to make room */
+    while (!service_stopped_ && audio_encode_queue_.Size() >= MAX_ENCODE_TASKS_IN_QUEUE) {
+        encode_space_waiter_.Prepare();
+        if (service_stopped_ || audio_encode_queue_.Size() < MAX_ENCODE_TASKS_IN_QUEUE) {
+            encode_space_waiter_.Cancel();
+            break;
+        }
+        encode_space_waiter_.Wait(pdMS_TO_TICKS(AUDIO_PRODUCER_WAIT_SLICE_MS));
+    }
+    if (service_stopped_) {
+        return;
+    }
+    task->queued_us = esp_timer_get_time();
+    if (task->origin_us > 0) {
+        latency_[kAudioLatencyProcess].Add(task->queued_us - task->origin_us);
+    }
+    {
+        std::lock_guard<std::mutex> lock(encode_producer_mutex_);
+        audio_encode_queue_.Push(std::move(task));
+    }
+    encode_waiter_.Notify();
     
     // Memory Monitoring (每 200 帧打印一次，减少 UART 竞争)
     static int encode_log_counter = 0;
     if (++encode_log_counter % 200 == 0) {
         ESP_LOGI(TAG, "Queue: D=%d, P=%d, Heap=%lu",
-                 (int)audio_decode_queue_.size(), (int)audio_playback_queue_.size(),
+                 (int)audio_decode_queue_.Size(), (int)audio_playback_queue_.Size(),
                  (unsigned long)esp_get_free_heap_size());
     }
-
-    audio_queue_cv_.notify_all();
 }
 
-bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait) {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    if (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
+bool AudioService::PushPacketToDecodeQueue(AudioStreamPacketPtr packet, bool wait) {
+    if (packet->frame_duration > 0) {
+        decode_frame_duration_ms_.store(packet->frame_duration, std::memory_order_relaxed);
+    }
+    const size_t max_packets = MaxDecodePackets();
+    if (audio_decode_queue_.Size() >= max_packets) {
         if (wait) {
             // 4G 最佳实践：使用超时等待，避免无限阻塞导致 URC 队列溢出
             // 超时 100ms：足够等待解码处理一帧 (60ms)，但不会阻塞太久
-            auto timeout = std::chrono::milliseconds(100);
-            if (!audio_queue_cv_.wait_for(lock, timeout, [this]() {
-                return audio_decode_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE;
-            })) {
-                // 超时仍满，降级为丢包（保护 URC 处理不被阻塞）
-                static uint32_t timeout_drop_count = 0;
-                timeout_drop_count++;
-                if (timeout_drop_count <= 10 || timeout_drop_count % 100 == 0) {
-                    ESP_LOGW(TAG, "Decode queue full after timeout, dropping packet #%lu",
-                             timeout_drop_count);
+            int64_t deadline = esp_timer_get_time() + 100 * 1000;
+            while (audio_decode_queue_.Size() >= max_packets) {
+                int64_t remaining_us = deadline - esp_timer_get_time();
+                if (remaining_us <= 0 || service_stopped_) {
+                    // 超时仍满，降级为丢包（保护 URC 处理不被阻塞）
+                    static uint32_t timeout_drop_count = 0;
+                    timeout_drop_count++;
+                    if (timeout_drop_count <= 10 || timeout_drop_count % 100 == 0) {
+                        ESP_LOGW(TAG, "Decode queue full after timeout, dropping packet #%lu",
+                                 timeout_drop_count);
+                    }
+                    CountDroppedPacket();
+                    return false;
                 }
-                return false;
+                decode_space_waiter_.Prepare();
+                if (audio_decode_queue_.Size() < max_packets) {
+                    decode_space_waiter_.Cancel();
+                    break;
+                }
+                // Wait in short slices, another producer may have replaced us as the registered waiter
+                int wait_ms = std::min<int>(remaining_us / 1000 + 1, AUDIO_PRODUCER_WAIT_SLICE_MS);
+                decode_space_waiter_.Wait(pdMS_TO_TICKS(wait_ms));
             }
         } else {
             // 4G 网络最佳实践：记录丢包警告，便于排查
@@ -548,27 +1022,66 @@ bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> pa
             drop_count++;
             if (drop_count <= 10 || drop_count % 100 == 0) {
                 ESP_LOGW(TAG, "Decode queue full (%d/%d), dropping packet #%lu!",
-                         (int)audio_decode_queue_.size(), MAX_DECODE_PACKETS_IN_QUEUE, drop_count);
+                         (int)audio_decode_queue_.Size(), (int)max_packets, drop_count);
             }
+            CountDroppedPacket();
+            return false;
+        }
+    }
+
+    int frame_duration = packet->frame_duration;
+    packet->queued_us = esp_timer_get_time();
+    uint32_t missing = pending_missing_frames_.exchange(0);
+    if (missing > 0) {
+        packet->missing_before = std::min<uint32_t>(packet->missing_before + missing, UINT16_MAX);
+    }
+    {
+        std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+        if (!audio_decode_queue_.Push(std::move(packet))) {
+            CountDroppedPacket();
             return false;
         }
     }
-    audio_decode_queue_.push_back(std::move(packet));
-    audio_queue_cv_.notify_all();
+    decode_waiter_.Notify();
+    buffering_.OnPacketArrival(esp_timer_get_time(), frame_duration);
+    // Only a buffering output task cares about the decode queue depth
+    if (buffering_.state() != AudioState::PLAYING) {
+        output_waiter_.Notify();
+    }
     return true;
 }
 
-std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_send_queue_.empty()) {
+void AudioService::CountDroppedPacket() {
+    dropped_packets_++;
+    // Only a gap inside a TTS stream is worth concealing
+    if (buffering_.stream_active()) {
+        pending_missing_frames_++;
+    }
+}
+
+AudioStreamPacketPtr AudioService::PopPacketFromSendQueue() {
+    bool was_full = audio_send_queue_.Size() >= MaxSendPackets();
+    AudioStreamPacketPtr packet;
+    if (!audio_send_queue_.Pop(packet)) {
         return nullptr;
     }
-    auto packet = std::move(audio_send_queue_.front());
-    audio_send_queue_.pop_front();
-    audio_queue_cv_.notify_all();
+    if (was_full) {
+        encode_waiter_.Notify();
+    }
+    if (packet->queued_us > 0) {
+        latency_[kAudioLatencySendWait].Add(esp_timer_get_time() - packet->queued_us);
+    }
     return packet;
 }
 
+void AudioService::OnAudioSent(int64_t capture_us, int64_t send_start_us) {
+    int64_t now = esp_timer_get_time();
+    latency_[kAudioLatencySend].Add(now - send_start_us);
+    if (capture_us > 0) {
+        latency_[kAudioLatencyUplink].Add(now - capture_us);
+    }
+}
+
 void AudioService::EncodeWakeWord() {
     if (wake_word_) {
         wake_word_->EncodeWakeWordData();
@@ -579,8 +1092,8 @@ const std::string& AudioService::GetLastWakeWord() const {
     return wake_word_->GetLastDetectedWakeWord();
 }
 
-std::unique_ptr<AudioStreamPacket> AudioService::PopWakeWordPacket() {
-    auto packet = std::make_unique<AudioStreamPacket>();
+AudioStreamPacketPtr AudioService::PopWakeWordPacket() {
+    auto packet = AudioStreamPacket::Create();
     if (wake_word_->GetWakeWordOpus(packet->payload)) {
         return packet;
     }
@@ -612,14 +1125,17 @@ void AudioService::EnableWakeWordDetection(bool enable) {
 void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
     if (enable) {
-        if (!audio_processor_initialized_) {
-            audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS);
-            audio_processor_initialized_ = true;
+        InitializeAudioProcessor();
+        int frame_duration = frame_duration_ms();
+        if (processor_frame_duration_ms_ != frame_duration) {
+            audio_processor_->SetFrameDuration(frame_duration);
+            processor_frame_duration_ms_ = frame_duration;
         }
 
         /* We should make sure no audio is playing */
         ResetDecoder();
         audio_input_need_warmup_ = true;
+        codec_power_.Request(kCodecPowerInput);
         audio_processor_->Start();
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
     } else {
@@ -631,92 +1147,272 @@ void AudioService::EnableVoiceProcessing(bool enable) {
 void AudioService::EnableAudioTesting(bool enable) {
     ESP_LOGI(TAG, "%s audio testing", enable ? "Enabling" : "Disabling");
     if (enable) {
+        audio_testing_duration_ms_ = 0;
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
-        /* Copy audio_testing_queue_ to audio_decode_queue_ */
-        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-        audio_decode_queue_ = std::move(audio_testing_queue_);
-        audio_queue_cv_.notify_all();
+        /* Move audio_testing_queue_ to audio_decode_queue_ */
+        {
+            std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+            audio_decode_queue_.Clear();
+            AudioStreamPacketPtr packet;
+            while (audio_testing_queue_.Pop(packet)) {
+                if (!audio_decode_queue_.Push(std::move(packet))) {
+                    break;
+                }
+            }
+        }
+        decode_waiter_.Notify();
+        output_waiter_.Notify();
     }
 }
 
-void AudioService::EnableDeviceAec(bool enable) {
-    ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
-    if (!audio_processor_initialized_) {
-        audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS);
-        audio_processor_initialized_ = true;
+bool AudioService::RunLoopbackTest(LoopbackTestResult& result) {
+    // Claimed for this call and the input and output tasks, also held after a timeout while they still run it
+    int idle = 0;
+    if (!loopback_users_.compare_exchange_strong(idle, 3, std::memory_order_acq_rel)) {
+        result.error = "loopback test busy";
+        return false;
+    }
+    auto test = std::make_unique<LoopbackTest>();
+    if (!test->Prepare(codec_)) {
+        loopback_users_.store(0, std::memory_order_release);
+        result.error = "not enough memory";
+        return false;
+    }
+    ESP_LOGI(TAG, "Starting loopback test");
+    AbortPlayback();
+    loopback_test_ = std::move(test);
+
+    xEventGroupClearBits(event_group_, AS_EVENT_LOOPBACK_INPUT_DONE | AS_EVENT_LOOPBACK_OUTPUT_DONE);
+    loopback_output_pending_.store(true, std::memory_order_release);
+    xEventGroupSetBits(event_group_, AS_EVENT_LOOPBACK_TEST_RUNNING);
+    output_waiter_.Notify();
+    const EventBits_t done = AS_EVENT_LOOPBACK_INPUT_DONE | AS_EVENT_LOOPBACK_OUTPUT_DONE;
+    EventBits_t bits = xEventGroupWaitBits(event_group_, done, pdTRUE, pdTRUE, pdMS_TO_TICKS(LOOPBACK_TEST_TIMEOUT_MS));
+    if ((bits & done) != done) {
+        ESP_LOGE(TAG, "Loopback test timed out");
+        result.error = "timed out";
+        ReleaseLoopbackTest();
+        return false;
+    }
+
+    loopback_test_->Analyze(result);
+    ReleaseLoopbackTest();
+    if (!result.success) {
+        ESP_LOGW(TAG, "Loopback test failed: %s", result.error);
+        return false;
+    }
+    ESP_LOGI(TAG, "Loopback %s: round trip %ld us (output buffer %ld us, playback to capture %ld us), correlation %.2f",
+        codec_->name(), (long)result.round_trip_us, (long)result.output_buffer_us, (long)result.playback_to_capture_us,
+        result.correlation);
+    if (result.has_reference) {
+        ESP_LOGI(TAG, "Loopback reference %ld us, acoustic %ld us", (long)result.reference_us, (long)result.acoustic_us);
+    }
+    if (result.drift_valid) {
+        ESP_LOGI(TAG, "Loopback clock drift %.1f ppm (input %d Hz, output %d Hz)", result.drift_ppm,
+            result.input_sample_rate, result.output_sample_rate);
     }
+    return true;
+}
 
+void AudioService::ReleaseLoopbackTest() {
+    // Whichever of RunLoopbackTest() and the input and output tasks finishes last frees the test
+    if (loopback_users_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        loopback_test_.reset();
+    }
+}
+
+void AudioService::EnableDeviceAec(bool enable) {
+    ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
+    InitializeAudioProcessor();
     audio_processor_->EnableDeviceAec(enable);
 }
 
+void AudioService::InitializeAudioProcessor() {
+    if (audio_processor_initialized_) {
+        return;
+    }
+    processor_frame_duration_ms_ = frame_duration_ms();
+    audio_processor_->Initialize(codec_, processor_frame_duration_ms_);
+    audio_processor_initialized_ = true;
+}
+
 void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
     callbacks_ = callbacks;
 }
 
-void AudioService::PlaySound(const std::string_view& sound) {
-    const char* data = sound.data();
-    size_t size = sound.size();
-    for (const char* p = data; p < data + size; ) {
-        auto p3 = (BinaryProtocol3*)p;
-        p += sizeof(BinaryProtocol3);
+uint32_t AudioService::PlaySound(const std::string_view& sound, PromptPlayer::Callback on_complete) {
+    uint32_t id = prompt_player_.Enqueue(sound, std::move(on_complete));
+    if (id != 0) {
+        decode_waiter_.Notify();
+    }
+    return id;
+}
 
-        auto payload_size = ntohs(p3->payload_size);
-        auto packet = std::make_unique<AudioStreamPacket>();
-        packet->sample_rate = 16000;
-        packet->frame_duration = 60;
-        packet->payload.resize(payload_size);
-        memcpy(packet->payload.data(), p3->payload, payload_size);
-        p += payload_size;
+void AudioService::WarmUpPromptCache(std::vector<std::string_view> sounds) {
+    if (sounds.empty() || prompt_cache_.GetStatistics().budget_bytes == 0) {
+        return;
+    }
+    warmup_sounds_ = std::move(sounds);
+    xTaskCreate([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->WarmUpPromptTask();
+        vTaskDelete(NULL);
+    }, "prompt_warmup", PROMPT_WARMUP_TASK_STACK_SIZE, this, PROMPT_WARMUP_TASK_PRIORITY, NULL);
+}
 
-        PushPacketToDecodeQueue(std::move(packet), true);
+void AudioService::WarmUpPromptTask() {
+    // Own decoder and resampler, the decode task keeps running meanwhile
+    OpusStreamDecoder decoder(PROMPT_SAMPLE_RATE, 1, PROMPT_FRAME_DURATION_MS);
+    OpusResampler resampler;
+    int output_sample_rate = codec_->output_sample_rate();
+    std::vector<int16_t> pcm;
+    std::vector<int16_t> resampled;
+
+    int64_t start_time = esp_timer_get_time();
+    for (auto sound : warmup_sounds_) {
+        if (prompt_cache_.Contains(sound)) {
+            continue;
+        }
+        auto entry = prompt_cache_.CreateEntry(sound);
+        if (entry == nullptr) {
+            continue;
+        }
+        decoder.ResetState();
+        if (output_sample_rate != PROMPT_SAMPLE_RATE) {
+            resampler.Configure(PROMPT_SAMPLE_RATE, output_sample_rate);
+        }
+
+        size_t offset = 0;
+        const uint8_t* data;
+        size_t size;
+        bool ok = true;
+        while (ok && PromptPlayer::ReadFrame(sound, offset, data, size)) {
+            ok = decoder.Decode(data, size, pcm);
+            if (ok && output_sample_rate != PROMPT_SAMPLE_RATE) {
+                resampled.resize(resampler.GetOutputSamples(pcm.size()));
+                resampler.Process(pcm.data(), pcm.size(), resampled.data());
+                pcm.swap(resampled);
+            }
+            ok = ok && entry->Append(pcm.data(), pcm.size());
+        }
+        if (ok) {
+            prompt_cache_.Insert(sound, std::move(entry));
+        }
     }
+    warmup_sounds_.clear();
+
+    auto statistics = prompt_cache_.GetStatistics();
+    ESP_LOGI(TAG, "Prompt cache warmed up: %lu entries, %u bytes in %lu ms", (unsigned long)statistics.entries,
+             statistics.bytes, (unsigned long)((esp_timer_get_time() - start_time) / 1000));
 }
 
 bool AudioService::IsIdle() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    return audio_encode_queue_.Empty() && audio_decode_queue_.Empty() && audio_playback_queue_.Empty() &&
+           audio_testing_queue_.Empty() && prompt_player_.IsIdle();
 }
 
 void AudioService::ResetDecoder() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    opus_decoder_->ResetState();
-    timestamp_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_state_ = AudioState::IDLE;
-    audio_queue_cv_.notify_all();
+    // Prompts are mixed independently of the speech stream and keep playing, CancelAllSounds() drops them.
+    // The decoder belongs to OpusDecodeTask, it resets itself before the next packet.
+    decoder_reset_pending_ = true;
+    audio_decode_queue_.Clear();
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
+    audio_testing_duration_ms_ = 0;
+    pending_missing_frames_ = 0;
+    stretch_reset_pending_ = true;
+    buffering_.Reset();
+    decode_waiter_.Notify();
+    output_waiter_.Notify();
+    decode_space_waiter_.Notify();
+}
+
+int AudioService::AbortPlayback() {
+    // Silence the DMA ring first, the rest only keeps queued audio from reaching it again
+    int silence_us = codec_->output_enabled() ? codec_->FlushOutput() : 0;
+    playback_generation_.fetch_add(1, std::memory_order_acq_rel);
+    prompt_player_.CancelAll();
+    audio_prompt_queue_.Clear();
+    ResetDecoder();
+    ESP_LOGI(TAG, "Playback aborted, silent in %d us", silence_us);
+    return silence_us;
 }
 
-void AudioService::CheckAndUpdateAudioPowerState() {
-    auto now = std::chrono::steady_clock::now();
-    auto input_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_input_time_).count();
-    auto output_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_output_time_).count();
-    if (input_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->input_enabled()) {
-        codec_->EnableInput(false);
+void AudioService::StartPrebuffering() {
+    // The reply follows within a few hundred ms, longer than most codecs take to power up
+    if (codec_power_.Request(kCodecPowerOutput)) {
+        output_waiter_.Notify();
     }
-    if (output_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->output_enabled()) {
-        codec_->EnableOutput(false);
+    buffering_.StartStream(esp_timer_get_time());
+}
+
+void AudioService::StopPrebuffering() {
+    if (buffering_.EndStream(esp_timer_get_time())) {
+        output_waiter_.Notify();  // 唤醒 AudioOutputTask 播放剩余数据
     }
-    if (!codec_->input_enabled() && !codec_->output_enabled()) {
-        esp_timer_stop(audio_power_timer_);
+}
+
+AudioQueueStatistics AudioService::GetQueueStatistics() const {
+    AudioQueueStatistics stats;
+    stats.decode_queue_size = audio_decode_queue_.Size();
+    stats.decode_queue_high_water = audio_decode_queue_.high_water();
+    stats.send_queue_size = audio_send_queue_.Size();
+    stats.send_queue_high_water = audio_send_queue_.high_water();
+    stats.encode_queue_high_water = audio_encode_queue_.high_water();
+    stats.playback_queue_size = audio_playback_queue_.Size();
+    stats.playback_queue_high_water = audio_playback_queue_.high_water();
+    stats.decode_task_wakeups = decode_waiter_.wakeups();
+    stats.encode_task_wakeups = encode_waiter_.wakeups();
+    stats.output_task_wakeups = output_waiter_.wakeups();
+    stats.producer_wakeups = decode_space_waiter_.wakeups() + encode_space_waiter_.wakeups();
+    return stats;
+}
+
+void AudioService::ResetQueueStatistics() {
+    audio_decode_queue_.ResetStatistics();
+    audio_send_queue_.ResetStatistics();
+    audio_encode_queue_.ResetStatistics();
+    audio_playback_queue_.ResetStatistics();
+    decode_waiter_.ResetStatistics();
+    encode_waiter_.ResetStatistics();
+    output_waiter_.ResetStatistics();
+    decode_space_waiter_.ResetStatistics();
+    encode_space_waiter_.ResetStatistics();
+}
+
+AudioConcealmentStatistics AudioService::GetConcealmentStatistics() const {
+    AudioConcealmentStatistics stats;
+    stats.lost_frames = lost_frames_;
+    stats.dropped_packets = dropped_packets_.load();
+    stats.concealed_frames = concealed_frames_;
+    stats.fec_frames = fec_frames_;
+    return stats;
+}
+
+AudioLatencyStatistics AudioService::GetLatencyStatistics() const {
+    AudioLatencyStatistics stats;
+    for (int i = 0; i < kAudioLatencyStageCount; i++) {
+        stats.stages[i] = latency_[i].Get();
     }
+    return stats;
 }
 
-void AudioService::StartPrebuffering() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    ESP_LOGI(TAG, "Starting prebuffer, waiting for %d frames (%d ms)",
-             BUFFER_START_THRESHOLD_FRAMES, BUFFER_START_THRESHOLD_FRAMES * OPUS_FRAME_DURATION_MS);
-    audio_state_ = AudioState::BUFFERING;
+void AudioService::ResetLatencyStatistics() {
+    for (auto& recorder : latency_) {
+        recorder.Reset();
+    }
 }
 
-void AudioService::StopPrebuffering() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_state_ == AudioState::BUFFERING || audio_state_ == AudioState::REBUFFERING) {
-        ESP_LOGI(TAG, "Audio end received, stop prebuffering (may have insufficient data)");
-        audio_state_ = AudioState::PLAYING;
-        audio_queue_cv_.notify_all();  // 唤醒 AudioOutputTask 播放剩余数据
+void AudioService::LogLatencyStatistics() const {
+    for (int i = 0; i < kAudioLatencyStageCount; i++) {
+        auto stage = latency_[i].Get();
+        if (stage.count == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "Latency %-13s n=%lu avg=%lu p50<=%lu p95<=%lu max=%lu us", AudioLatencyStageName((AudioLatencyStage)i),
+                 (unsigned long)stage.count, (unsigned long)stage.average_us, (unsigned long)stage.PercentileUs(50),
+                 (unsigned long)stage.PercentileUs(95), (unsigned long)stage.max_us);
     }
-}
\ No newline at end of file
+}
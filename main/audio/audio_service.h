@@ -10,8 +10,7 @@
 #define AUDIO_SERVICE_H
 
 #include <memory>
-#include <deque>
-#include <condition_variable>
+#include <atomic>
 #include <chrono>
 #include <mutex>
 
@@ -21,11 +20,26 @@
 #include <esp_timer.h>
 
 #include <opus_encoder.h>
-#include <opus_decoder.h>
 #include <opus_resampler.h>
 
 #include "audio_codec.h"
+#include "audio_latency.h"
+#include "audio_limits.h"
+#include "audio_mixer.h"
+#include "codec_power.h"
 #include "audio_processor.h"
+#include "audio_queue.h"
+#include "dsp/audio_dsp.h"
+#include "loopback_test.h"
+#include "opus_stream_decoder.h"
+#include "opus_stream_encoder.h"
+#include "opus_rate_controller.h"
+#include "playback_buffering.h"
+#include "playback_timeline.h"
+#include "prompt_cache.h"
+#include "prompt_player.h"
+#include "time_stretcher.h"
+#include "object_pool.h"
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
 #include "protocol.h"
@@ -34,35 +48,59 @@
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
- * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
+ * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> [Mixer] -> (Speaker)
+ *    (Prompt) -> [Prompt Decoder / PCM Cache] -> {Prompt Queue} -> [Mixer]
  *
- * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * The mixer lays prompts over the speech and ducks the speech meanwhile, so a prompt never waits
+ * behind queued speech.
+ *
+ * We use one task for MIC / Speaker / Processors, and separate tasks for the Opus Encoder and the Opus Decoder,
+ * so a slow encode of a mic frame never delays decoding the next playback frame (and vice versa).
+ * On dual-core chips the encoder runs next to the MIC task and the decoder next to the speaker task.
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
  * 
+ * Every queue is a lock-free single-producer/single-consumer ring (see audio_queue.h). Tasks park on
+ * their own TaskWaiter and are woken with a direct task notification only by the queue that unblocks them.
  */
 
-#define OPUS_FRAME_DURATION_MS 60
 #define MAX_ENCODE_TASKS_IN_QUEUE 2
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 10  // 4G需要更大缓冲
-#define MAX_DECODE_PACKETS_IN_QUEUE 200 // 4G网络：12秒缓冲 (200*60ms)
-#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+#define MAX_PROMPT_TASKS_IN_QUEUE 4
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
-#define MAX_TIMESTAMPS_IN_QUEUE 3
-
-// Buffering Configuration - 4G网络需要更大预缓冲
-// URC 回调耗时 50-200ms，需要足够缓冲来平滑
-#define BUFFER_START_THRESHOLD_FRAMES 30   // 1800ms 预缓冲启动
-#define BUFFER_RESUME_THRESHOLD_FRAMES 15  // 900ms 恢复缓冲
-
-#define AUDIO_POWER_TIMEOUT_MS 15000
-#define AUDIO_POWER_CHECK_INTERVAL_MS 1000
+#define AUDIO_PRODUCER_WAIT_SLICE_MS 20
+// Longer gaps are left silent, PLC output fades out after a few frames anyway
+#define MAX_CONCEALED_FRAMES 3
+// Task pools, sized separately because playback PCM is at the output rate and encode PCM at 16 kHz mono.
+// Playback: playback queue plus concealed frames pushed past its limit, prompt queue, and the tasks held by
+// the decoder and the output task (speech frame and mixing prompt). Encode: encode queue, producer and encoder.
+#define AUDIO_PLAYBACK_TASK_POOL_SIZE (MAX_PLAYBACK_TASKS_IN_QUEUE + MAX_CONCEALED_FRAMES + MAX_PROMPT_TASKS_IN_QUEUE + 3)
+#define AUDIO_ENCODE_TASK_POOL_SIZE (MAX_ENCODE_TASKS_IN_QUEUE + 2)
+
+// Opus worker tasks: the decoder feeds playback so it outranks the encoder.
+// The encoder needs the larger stack (SILK analysis), the decoder also runs the resampler and time stretcher.
+#define OPUS_DECODE_TASK_CORE 0
+#define OPUS_DECODE_TASK_PRIORITY 6
+#define OPUS_DECODE_TASK_STACK_SIZE (2048 * 6)
+#if CONFIG_FREERTOS_UNICORE
+#define OPUS_ENCODE_TASK_CORE 0
+#else
+#define OPUS_ENCODE_TASK_CORE 1
+#endif
+#define OPUS_ENCODE_TASK_PRIORITY 5
+#define OPUS_ENCODE_TASK_STACK_SIZE (2048 * 12)
+// One-shot task that decodes the boot prompt set into the PCM cache
+#define PROMPT_WARMUP_TASK_PRIORITY 1
+#define PROMPT_WARMUP_TASK_STACK_SIZE (2048 * 6)
 
 
 #define AS_EVENT_AUDIO_TESTING_RUNNING      (1 << 0)
 #define AS_EVENT_WAKE_WORD_RUNNING          (1 << 1)
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING    (1 << 2)
 #define AS_EVENT_PLAYBACK_NOT_EMPTY         (1 << 3)
+#define AS_EVENT_LOOPBACK_TEST_RUNNING      (1 << 4)
+#define AS_EVENT_LOOPBACK_INPUT_DONE        (1 << 5)
+#define AS_EVENT_LOOPBACK_OUTPUT_DONE       (1 << 6)
 
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
@@ -79,17 +117,29 @@ enum AudioTaskType {
     kAudioTaskTypeDecodeToPlaybackQueue,
 };
 
-enum class AudioState {
-    IDLE,           // No audio session
-    BUFFERING,      // Initial buffering
-    PLAYING,        // Playing audio
-    REBUFFERING     // Buffer underrun, waiting for data
+struct AudioTask;
+
+// Returns tasks to the pool instead of freeing them
+struct AudioTaskDeleter {
+    void operator()(AudioTask* task) const;
 };
 
+using AudioTaskPtr = std::unique_ptr<AudioTask, AudioTaskDeleter>;
+
 struct AudioTask {
     AudioTaskType type;
     std::vector<int16_t> pcm;
     uint32_t timestamp;
+    float time_scale = 1.0f;    // Output/input length of the time stretcher, maps offsets in pcm back to timestamp
+    int64_t queued_us = 0;  // When the task entered its current queue, encode or playback (esp_timer)
+    int64_t origin_us = 0;  // Capture time for uplink, arrival time for downlink, see audio_latency.h
+    uint32_t prompt_id = 0; // Decoded from a prompt sound (PromptPlayer id), 0 for network audio
+    bool prompt_last = false;
+    uint32_t generation = 0;    // Playback generation it was decoded in, see AudioService::AbortPlayback()
+
+    // Take a task from the playback or encode pool by type (falls back to the heap when exhausted)
+    static AudioTaskPtr Create(AudioTaskType type);
+    static ObjectPoolStatistics GetPoolStatistics(AudioTaskType type);
 };
 
 struct DebugStatistics {
@@ -99,6 +149,29 @@ struct DebugStatistics {
     uint32_t playback_count = 0;
 };
 
+// Queue depth high-water marks and targeted wakeup counters, see GetQueueStatistics()
+struct AudioQueueStatistics {
+    size_t decode_queue_size = 0;
+    size_t decode_queue_high_water = 0;
+    size_t send_queue_size = 0;
+    size_t send_queue_high_water = 0;
+    size_t encode_queue_high_water = 0;
+    size_t playback_queue_size = 0;
+    size_t playback_queue_high_water = 0;
+    uint32_t decode_task_wakeups = 0;
+    uint32_t encode_task_wakeups = 0;
+    uint32_t output_task_wakeups = 0;
+    uint32_t producer_wakeups = 0;
+};
+
+// Downlink loss accounting, see GetConcealmentStatistics()
+struct AudioConcealmentStatistics {
+    uint32_t lost_frames = 0;       // Frames missing from the stream (sequence gaps and local drops)
+    uint32_t dropped_packets = 0;   // Packets dropped because the decode queue was full
+    uint32_t concealed_frames = 0;  // Frames synthesized by PLC or FEC
+    uint32_t fec_frames = 0;        // Of which decoded with in-band FEC from the next packet
+};
+
 class AudioService {
 public:
     AudioService();
@@ -108,7 +181,7 @@ public:
     void Start();
     void Stop();
     void EncodeWakeWord();
-    std::unique_ptr<AudioStreamPacket> PopWakeWordPacket();
+    AudioStreamPacketPtr PopWakeWordPacket();
     const std::string& GetLastWakeWord() const;
     bool IsVoiceDetected() const { return voice_detected_; }
     bool IsIdle();
@@ -119,31 +192,106 @@ public:
     void EnableVoiceProcessing(bool enable);
     void EnableAudioTesting(bool enable);
     void EnableDeviceAec(bool enable);
+    // Plays a chirp and records it back to measure the loopback latency and the input/output clock drift.
+    // Blocks for about three seconds; queued playback is aborted and the mic consumers pause meanwhile.
+    bool RunLoopbackTest(LoopbackTestResult& result);
 
     void SetCallbacks(AudioServiceCallbacks& callbacks);
 
-    bool PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait = false);
-    std::unique_ptr<AudioStreamPacket> PopPacketFromSendQueue();
-    void PlaySound(const std::string_view& sound);
+    bool PushPacketToDecodeQueue(AudioStreamPacketPtr packet, bool wait = false);
+    AudioStreamPacketPtr PopPacketFromSendQueue();
+    // Queues a p3 prompt and returns at once. The id can cancel it, 0 means the prompt was rejected.
+    uint32_t PlaySound(const std::string_view& sound, PromptPlayer::Callback on_complete = nullptr);
+    bool CancelSound(uint32_t id) { return prompt_player_.Cancel(id); }
+    void CancelAllSounds() { prompt_player_.CancelAll(); }
+    PromptStatistics GetPromptStatistics() const { return prompt_player_.GetStatistics(); }
+    // Decodes the given prompts into the PCM cache on a low priority task so their first play skips Opus
+    void WarmUpPromptCache(std::vector<std::string_view> sounds);
+    PromptCacheStatistics GetPromptCacheStatistics() const { return prompt_cache_.GetStatistics(); }
+    // Per-stream mixer gain (Q15, audio_dsp::kUnityGain = 1.0), applied from the next output frame
+    void SetStreamGain(AudioMixerStream stream, int32_t gain_q15) { stream_gains_[stream] = gain_q15; }
+    AudioMixerStatistics GetMixerStatistics() const { return audio_mixer_.GetStatistics(); }
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
     void ResetDecoder();
+    // Stops playback at once from any task: the audio already in the I2S DMA ring is faded out,
+    // queued speech and prompts are dropped and the decoder is reset.
+    // Returns the expected microseconds until silence, -1 when the codec could not tell.
+    int AbortPlayback();
+    AudioFlushStatistics GetFlushStatistics() const { return codec_->GetFlushStatistics(); }
+    CodecPowerStatistics GetCodecPowerStatistics(CodecPowerDirection direction) const {
+        return codec_power_.GetStatistics(direction);
+    }
+    // Server AEC: playback clock accuracy and how many uplink frames got a downlink timestamp
+    AudioPlaybackClockStatistics GetPlaybackClockStatistics() const { return codec_->GetPlaybackClockStatistics(); }
+    PlaybackTimelineStatistics GetPlaybackTimelineStatistics() { return playback_timeline_.GetStatistics(); }
 
     // 预缓冲控制
     void StartPrebuffering();  // 收到 AUDIO_START 时调用
     void StopPrebuffering();   // 收到 AUDIO_END 时调用
 
+    AudioQueueStatistics GetQueueStatistics() const;
+    void ResetQueueStatistics();
+    ObjectPoolStatistics GetPacketPoolStatistics() const { return AudioStreamPacket::GetPoolStatistics(); }
+    ObjectPoolStatistics GetTaskPoolStatistics(AudioTaskType type) const { return AudioTask::GetPoolStatistics(type); }
+    JitterBufferStatistics GetJitterBufferStatistics() const { return buffering_.GetStatistics(); }
+    AudioConcealmentStatistics GetConcealmentStatistics() const;
+    // Per-stage latency histograms from mic to network and from network to speaker
+    AudioLatencyStatistics GetLatencyStatistics() const;
+    void ResetLatencyStatistics();
+    void LogLatencyStatistics() const;
+    // Called after Protocol::SendAudio() succeeds with the packet's capture_us and the time the send began
+    void OnAudioSent(int64_t capture_us, int64_t send_start_us);
+    OpusRateStatistics GetEncoderRateStatistics() const { return rate_controller_.GetStatistics(); }
+    // Called by the application when the protocol fails to send an uplink packet
+    void OnSendAudioFailed() { rate_controller_.OnSendFailure(); }
+    // Temporary uplink bitrate limit (0 removes it), used while the uplink only serves barge-in
+    void SetUplinkBitrateCeiling(int bitrate) { rate_controller_.SetBitrateCeiling(bitrate); }
+
+    // Frame duration negotiated for the current session, the encoder and audio processor switch to it
+    // at their next frame / next start. Downlink packets carry their own duration.
+    void SetFrameDuration(int frame_duration_ms);
+    int frame_duration_ms() const { return frame_duration_ms_.load(std::memory_order_relaxed); }
+
 private:
     AudioCodec* codec_ = nullptr;
     AudioServiceCallbacks callbacks_;
     std::unique_ptr<AudioProcessor> audio_processor_;
     std::unique_ptr<WakeWord> wake_word_;
     std::unique_ptr<AudioDebugger> audio_debugger_;
-    std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
-    std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
+    std::unique_ptr<OpusStreamEncoder> opus_encoder_;
+    OpusRateController rate_controller_;
+    std::unique_ptr<OpusStreamDecoder> opus_decoder_;
+    PromptPlayer prompt_player_;
+    std::unique_ptr<OpusStreamDecoder> prompt_decoder_;
+    OpusResampler prompt_resampler_;
+    // Output-rate PCM of short prompts. A hit is chunked straight into the prompt queue,
+    // a miss is recorded while it is decoded. The fields below are only touched by OpusDecodeTask.
+    PromptCache prompt_cache_;
+    PromptPcmPtr cached_prompt_;
+    uint32_t cached_prompt_id_ = 0;
+    size_t cached_prompt_offset_ = 0;
+    std::shared_ptr<PromptPcm> recording_prompt_;
+    std::string_view recording_prompt_sound_;
+    uint32_t recording_prompt_id_ = 0;
+    std::atomic<bool> cached_prompt_playing_{false};  // Read by the output task for the idle check
+    std::vector<std::string_view> warmup_sounds_;
+    // Mixing state, only touched by AudioOutputTask
+    AudioMixer audio_mixer_;
+    AudioTaskPtr mixing_prompt_;
+    size_t mixing_prompt_offset_ = 0;
+    std::vector<std::pair<uint32_t, bool>> played_prompt_frames_;  // (prompt id, last) finished by the current frame
+    std::atomic<int32_t> stream_gains_[kAudioMixerStreamCount] = {audio_dsp::kUnityGain, audio_dsp::kUnityGain};
     OpusResampler input_resampler_;
     OpusResampler reference_resampler_;
     OpusResampler output_resampler_;
     std::vector<int16_t> resample_buffer_;
+    // Input scratch, 16-byte aligned for the SIMD kernels and reused across reads
+    AlignedBuffer<int16_t> input_buffer_;
+    AlignedBuffer<int16_t> mic_buffer_;
+    AlignedBuffer<int16_t> reference_buffer_;
+    AlignedBuffer<int16_t> resampled_mic_buffer_;
+    AlignedBuffer<int16_t> resampled_reference_buffer_;
+    std::vector<int16_t> input_data_;   // Wake word and audio processor feed, only touched by AudioInputTask
     DebugStatistics debug_statistics_;
 
     EventGroupHandle_t event_group_;
@@ -151,37 +299,92 @@ private:
     // Audio encode / decode
     TaskHandle_t audio_input_task_handle_ = nullptr;
     TaskHandle_t audio_output_task_handle_ = nullptr;
-    TaskHandle_t opus_codec_task_handle_ = nullptr;
-    std::mutex audio_queue_mutex_;
-    std::condition_variable audio_queue_cv_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
-    // For server AEC
-    std::deque<uint32_t> timestamp_queue_;
+    TaskHandle_t opus_decode_task_handle_ = nullptr;
+    TaskHandle_t opus_encode_task_handle_ = nullptr;
+    // Producer side locks, only for queues that more than one task may push into
+    std::mutex decode_producer_mutex_;
+    std::mutex encode_producer_mutex_;
+    SpscQueue<AudioStreamPacketPtr, 1024> audio_decode_queue_;
+    SpscQueue<AudioStreamPacketPtr, 128> audio_send_queue_;
+    SpscQueue<AudioStreamPacketPtr, 512> audio_testing_queue_;
+    std::atomic<int> audio_testing_duration_ms_{0};  // Recorded into audio_testing_queue_ since testing started
+    SpscQueue<AudioTaskPtr, 4> audio_encode_queue_;
+    SpscQueue<AudioTaskPtr, 16> audio_playback_queue_;
+    SpscQueue<AudioTaskPtr, 4> audio_prompt_queue_;
+    PlaybackTimeline playback_timeline_;     // Server AEC: downlink timestamps by codec sample position
+    // Acoustic loopback self-test, shared by RunLoopbackTest() and the input and output tasks while it runs
+    std::unique_ptr<LoopbackTest> loopback_test_;
+    std::atomic<int> loopback_users_{0};    // Holders of loopback_test_, the last one to let go frees it
+    std::atomic<bool> loopback_output_pending_ = false;
+
+    TaskWaiter decode_waiter_;          // OpusDecodeTask: packets to decode or playback queue space
+    TaskWaiter encode_waiter_;          // OpusEncodeTask: PCM to encode or send queue space
+    TaskWaiter output_waiter_;          // AudioOutputTask: playback or prompt data, or buffering progress
+    TaskWaiter decode_space_waiter_;    // Blocking PushPacketToDecodeQueue callers
+    TaskWaiter encode_space_waiter_;    // PushTaskToEncodeQueue callers
+
+    std::atomic<int> frame_duration_ms_{OPUS_FRAME_DURATION_MS};
+    std::atomic<int> pending_frame_duration_ms_{0};         // Picked up by OpusEncodeTask
+    std::atomic<int> encode_frame_duration_ms_{OPUS_FRAME_DURATION_MS};
+    std::atomic<int> decode_frame_duration_ms_{OPUS_FRAME_DURATION_MS};  // Of the last packet pushed
+    int processor_frame_duration_ms_ = OPUS_FRAME_DURATION_MS;
 
     bool wake_word_initialized_ = false;
     bool audio_processor_initialized_ = false;
     bool voice_detected_ = false;
-    bool service_stopped_ = true;
+    std::atomic<bool> service_stopped_{true};  // Written by Start()/Stop(), read by every task loop
     bool audio_input_need_warmup_ = false;
 
     // 预缓冲控制：收到足够音频数据后再开始播放，避免断断续续
-    // 4G 网络抖动可达 2 秒以上，需要足够的预缓冲来平滑播放
-    AudioState audio_state_ = AudioState::IDLE;
+    // 缓冲深度由 JitterBuffer 根据到达抖动动态决定 (Wi-Fi 很浅, 4G 会自动加深)
+    PlaybackBuffering buffering_;
+
+    // Packet loss concealment
+    std::atomic<uint32_t> pending_missing_frames_{0};  // Local drops, attached to the next accepted packet
+    std::atomic<uint32_t> dropped_packets_{0};
+    uint32_t lost_frames_ = 0;
+    uint32_t concealed_frames_ = 0;
+    uint32_t fec_frames_ = 0;
+
+    // Time stretching between decoder and output, only touched by OpusDecodeTask
+    TimeStretcher time_stretcher_;
+    std::atomic<bool> stretch_reset_pending_{false};
+
+    // Bumped by AbortPlayback(), frames decoded under an older generation are never played
+    std::atomic<uint32_t> playback_generation_{0};
+    std::atomic<bool> decoder_reset_pending_{false};   // Picked up by OpusDecodeTask
+
+    LatencyRecorder latency_[kAudioLatencyStageCount];
+    std::atomic<int64_t> last_capture_us_{0};   // Latest mic read, the audio processor outputs on its own task
 
-    esp_timer_handle_t audio_power_timer_ = nullptr;
-    std::chrono::steady_clock::time_point last_input_time_;
-    std::chrono::steady_clock::time_point last_output_time_;
+    CodecPowerManager codec_power_;
 
     void AudioInputTask();
     void AudioOutputTask();
-    void OpusCodecTask();
-    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
+    void OpusDecodeTask();
+    void OpusEncodeTask();
+    bool IsOutputReady();
+    bool CanDecode() const;
+    bool CanEncode() const;
+    size_t MaxDecodePackets() const;
+    size_t MaxSendPackets() const;
+    void ConfigureEncoder(int frame_duration_ms);
+    void InitializeAudioProcessor();
+    void WakeAllTasks();
+    void PushTaskToEncodeQueue(AudioTaskPtr task);
+    void PushTaskToPlaybackQueue(AudioTaskPtr task);
+    void DecodePromptFrame();
+    void PlayCachedPromptChunk();
+    void PushTaskToPromptQueue(AudioTaskPtr task);
+    bool CanDecodePrompt() const;
+    bool HasPromptOutput() const;
+    size_t GatherPromptSamples(size_t max_samples);
+    void WarmUpPromptTask();
+    void ApplyEncoderSettings(const OpusEncoderSettings& settings);
+    void ConcealLostFrames(const AudioStreamPacket& next_packet, uint32_t generation);
+    void CountDroppedPacket();
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
-    void CheckAndUpdateAudioPowerState();
+    void ReleaseLoopbackTest();
 };
 
 #endif
\ No newline at end of file
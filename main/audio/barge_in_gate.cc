@@ -0,0 +1,60 @@
+#include "barge_in_gate.h"
+
+void BargeInGate::Reset() {
+    preroll_.clear();
+    preroll_ms_ = 0;
+    open_ = false;
+    triggered_ = false;
+}
+
+bool BargeInGate::Feed(AudioStreamPacketPtr packet, bool voice, int64_t now_us, std::vector<AudioStreamPacketPtr>& out) {
+    statistics_.input_packets++;
+
+    if (voice) {
+        if (!open_) {
+            open_ = true;
+            triggered_ = false;
+            voice_start_us_ = now_us;
+            statistics_.bursts++;
+            while (!preroll_.empty()) {
+                Send(std::move(preroll_.front()), now_us, out);
+                preroll_.pop_front();
+            }
+            preroll_ms_ = 0;
+        }
+        last_voice_us_ = now_us;
+    } else if (open_ && now_us - last_voice_us_ > BARGE_IN_HANGOVER_MS * 1000) {
+        open_ = false;
+    }
+
+    if (open_) {
+        Send(std::move(packet), now_us, out);
+    } else {
+        preroll_ms_ += packet->frame_duration;
+        preroll_.push_back(std::move(packet));
+        while (preroll_ms_ > BARGE_IN_PREROLL_MS && preroll_.size() > 1) {
+            preroll_ms_ -= preroll_.front()->frame_duration;
+            preroll_.pop_front();
+        }
+    }
+
+    if (voice && !triggered_ && now_us - voice_start_us_ >= BARGE_IN_TRIGGER_MS * 1000) {
+        triggered_ = true;
+        statistics_.triggers++;
+        return true;
+    }
+    return false;
+}
+
+void BargeInGate::Send(AudioStreamPacketPtr packet, int64_t now_us, std::vector<AudioStreamPacketPtr>& out) {
+    if (now_us < backoff_until_us_) {
+        statistics_.backoff_drops++;
+        return;
+    }
+    out.push_back(std::move(packet));
+}
+
+void BargeInGate::OnSendFailure(int64_t now_us) {
+    statistics_.send_failures++;
+    backoff_until_us_ = now_us + BARGE_IN_BACKOFF_MS * 1000;
+}
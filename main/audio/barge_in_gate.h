@@ -0,0 +1,83 @@
+#ifndef BARGE_IN_GATE_H
+#define BARGE_IN_GATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "audio_stream_packet.h"
+
+// 播放期间上行的码率上限 (bps), 只用于检测打断和 ASR 起始, 不需要高音质
+#define BARGE_IN_BITRATE 12000
+// 人声开始前保留的上行音频, 打开时先发出, 避免丢掉第一个音节
+#define BARGE_IN_PREROLL_MS 200
+// 人声持续这么久才判定为打断 (短促的噪声或残留回声只上行, 不打断)
+#define BARGE_IN_TRIGGER_MS 300
+// 人声结束后继续上行的时长
+#define BARGE_IN_HANGOVER_MS 400
+// 发送失败后暂停上行的时长 (仍然检测打断)
+#define BARGE_IN_BACKOFF_MS 3000
+
+/**
+ * 打断统计, 用来评估播放期间上行的代价
+ */
+struct BargeInStatistics {
+    uint32_t input_packets = 0;     // 编码器产出的包
+    uint32_t sent_packets = 0;      // 交给协议层的包 (含 pre-roll)
+    uint32_t sent_bytes = 0;
+    uint32_t bursts = 0;            // 人声段数
+    uint32_t triggers = 0;          // 判定为打断的人声段数
+    uint32_t backoff_drops = 0;     // 链路退避期间丢弃的包
+    uint32_t send_failures = 0;
+};
+
+/**
+ * 播放期间 (全双工) 的上行闸门
+ *
+ * 只有开启 AEC 时才使用: 此时扬声器回声已被消除, 本地 VAD 检测到的人声可以认为来自用户.
+ * - 没有人声时不上行, 只保留最近 BARGE_IN_PREROLL_MS 的包
+ * - 检测到人声时先发 pre-roll, 再实时上行, 人声结束后再延续 BARGE_IN_HANGOVER_MS
+ * - 人声持续 BARGE_IN_TRIGGER_MS 时 Feed() 返回 true, 调用方据此中止播放 (每段人声一次)
+ * - 协议层发送失败后退避 BARGE_IN_BACKOFF_MS, 期间不上行
+ *
+ * 只由主任务调用, 类本身不依赖 FreeRTOS, 时间由调用方传入.
+ */
+class BargeInGate {
+public:
+    /**
+     * 进入新的播放时调用, 丢弃 pre-roll
+     */
+    void Reset();
+
+    /**
+     * 处理一个上行包
+     * @param voice 当前是否检测到人声
+     * @param out 需要发送的包追加到这里
+     * @return 是否应该打断播放
+     */
+    bool Feed(AudioStreamPacketPtr packet, bool voice, int64_t now_us, std::vector<AudioStreamPacketPtr>& out);
+
+    void OnSendFailure(int64_t now_us);
+
+    void OnPacketSent(size_t bytes) {
+        statistics_.sent_packets++;
+        statistics_.sent_bytes += bytes;
+    }
+
+    BargeInStatistics GetStatistics() const { return statistics_; }
+
+private:
+    void Send(AudioStreamPacketPtr packet, int64_t now_us, std::vector<AudioStreamPacketPtr>& out);
+
+    std::deque<AudioStreamPacketPtr> preroll_;
+    int preroll_ms_ = 0;
+    bool open_ = false;
+    bool triggered_ = false;
+    int64_t voice_start_us_ = 0;
+    int64_t last_voice_us_ = 0;
+    int64_t backoff_until_us_ = 0;
+    BargeInStatistics statistics_;
+};
+
+#endif // BARGE_IN_GATE_H
@@ -0,0 +1,150 @@
+#include "codec_power.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+
+#define TAG "CodecPower"
+
+static const char* const kDirectionNames[kCodecPowerDirectionCount] = { "input", "output" };
+
+CodecPowerManager::CodecPowerManager() {
+}
+
+CodecPowerManager::~CodecPowerManager() {
+    if (timer_ != nullptr) {
+        esp_timer_stop(timer_);
+        esp_timer_delete(timer_);
+    }
+}
+
+void CodecPowerManager::Initialize(AudioCodec* codec) {
+    codec_ = codec;
+    esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) {
+            auto manager = (CodecPowerManager*)arg;
+            manager->OnTimer();
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "audio_power_timer",
+        .skip_unhandled_events = true,
+    };
+    esp_timer_create(&timer_args, &timer_);
+}
+
+void CodecPowerManager::Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < kCodecPowerDirectionCount; i++) {
+        last_active_us_[i].store(now, std::memory_order_relaxed);
+    }
+    if (codec_->input_enabled() || codec_->output_enabled()) {
+        ArmTimer(AUDIO_POWER_TIMEOUT_MS * 1000);
+    }
+}
+
+void CodecPowerManager::Stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    esp_timer_stop(timer_);
+    timer_armed_ = false;
+}
+
+bool CodecPowerManager::enabled(CodecPowerDirection direction) const {
+    return direction == kCodecPowerInput ? codec_->input_enabled() : codec_->output_enabled();
+}
+
+bool CodecPowerManager::Request(CodecPowerDirection direction) {
+    last_active_us_[direction].store(esp_timer_get_time(), std::memory_order_relaxed);
+    if (enabled(direction)) {
+        return false;
+    }
+    requested_[direction].store(true, std::memory_order_release);
+    return true;
+}
+
+void CodecPowerManager::Touch(CodecPowerDirection direction) {
+    last_active_us_[direction].store(esp_timer_get_time(), std::memory_order_relaxed);
+}
+
+void CodecPowerManager::Ensure(CodecPowerDirection direction) {
+    Touch(direction);
+    // 已上电时也要清除预告, 否则在上电之后才到达的 Request() 会让调用方一直以为还需要 Ensure()
+    bool pre_powered = requested_[direction].exchange(false, std::memory_order_acq_rel);
+    if (enabled(direction)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (enabled(direction)) {
+        return;
+    }
+    int64_t start_time = esp_timer_get_time();
+    if (direction == kCodecPowerInput) {
+        codec_->EnableInput(true);
+    } else {
+        codec_->EnableOutput(true);
+    }
+    uint32_t warmup_us = esp_timer_get_time() - start_time;
+
+    auto& stats = statistics_[direction];
+    stats.power_ups++;
+    if (pre_powered) {
+        stats.pre_powered++;
+    } else {
+        stats.on_demand++;
+    }
+    stats.last_warmup_us = warmup_us;
+    stats.max_warmup_us = std::max(stats.max_warmup_us, warmup_us);
+    ESP_LOGI(TAG, "%s %s powered up in %lu us (%s)", codec_->name(), kDirectionNames[direction],
+             (unsigned long)warmup_us, pre_powered ? "ahead" : "on demand");
+
+    if (!timer_armed_) {
+        ArmTimer(AUDIO_POWER_TIMEOUT_MS * 1000);
+    }
+}
+
+void CodecPowerManager::OnTimer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timer_armed_ = false;
+    int64_t now = esp_timer_get_time();
+    int64_t next_us = INT64_MAX;
+    for (int i = 0; i < kCodecPowerDirectionCount; i++) {
+        auto direction = (CodecPowerDirection)i;
+        if (!enabled(direction)) {
+            continue;
+        }
+        int64_t remaining_us = last_active_us_[i].load(std::memory_order_relaxed) + AUDIO_POWER_TIMEOUT_MS * 1000 - now;
+        if (remaining_us > 0 || requested_[i].load(std::memory_order_acquire)) {
+            next_us = std::min(next_us, std::max<int64_t>(remaining_us, 1000));
+            continue;
+        }
+        if (direction == kCodecPowerInput) {
+            codec_->EnableInput(false);
+        } else {
+            codec_->EnableOutput(false);
+        }
+        statistics_[i].power_downs++;
+    }
+    if (next_us != INT64_MAX) {
+        ArmTimer(next_us);
+    }
+}
+
+void CodecPowerManager::ArmTimer(int64_t delay_us) {
+    esp_timer_stop(timer_);
+    esp_timer_start_once(timer_, delay_us);
+    timer_armed_ = true;
+}
+
+CodecPowerState CodecPowerManager::GetState(CodecPowerDirection direction) const {
+    if (enabled(direction)) {
+        return kCodecPowerOn;
+    }
+    return requested(direction) ? kCodecPowerRequested : kCodecPowerOff;
+}
+
+CodecPowerStatistics CodecPowerManager::GetStatistics(CodecPowerDirection direction) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_[direction];
+}
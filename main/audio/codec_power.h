@@ -0,0 +1,85 @@
+#ifndef CODEC_POWER_H
+#define CODEC_POWER_H
+
+#include <esp_timer.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "audio_codec.h"
+
+// 输入/输出连续多久没有数据后关闭 (ADC/DAC 与功放)
+#define AUDIO_POWER_TIMEOUT_MS 15000
+
+enum CodecPowerDirection {
+    kCodecPowerInput = 0,
+    kCodecPowerOutput,
+    kCodecPowerDirectionCount,
+};
+
+enum CodecPowerState {
+    kCodecPowerOff = 0,
+    kCodecPowerRequested,       // 已有事件预告要用, 等待使用它的任务上电
+    kCodecPowerOn,
+};
+
+struct CodecPowerStatistics {
+    uint32_t power_ups = 0;
+    uint32_t pre_powered = 0;       // 由事件提前上电, 第一帧不再等待
+    uint32_t on_demand = 0;         // 第一帧到达时才上电, 这一帧付出了整个 warm-up
+    uint32_t power_downs = 0;
+    uint32_t last_warmup_us = 0;    // EnableInput/EnableOutput(true) 的实测耗时 (codec 寄存器配置与功放)
+    uint32_t max_warmup_us = 0;
+};
+
+/**
+ * Codec 电源状态机, 每个方向: Off -> Requested -> On -> (空闲超时) Off
+ *
+ * - Request(): 管线事件 (收到 tts start、唤醒、VAD 起点、开始录音) 预告即将使用, 任意任务调用
+ * - Ensure(): 读写数据的任务在读写前调用, 未上电时在这里上电并计时; 同时记录活动时间
+ * - 空闲超时由单次定时器处理, 只在有方向上电时运行, 不再每秒轮询
+ *
+ * 上电只在 Ensure() 中发生, 所以 codec 驱动只会被使用它的任务和定时器任务操作.
+ */
+class CodecPowerManager {
+public:
+    CodecPowerManager();
+    ~CodecPowerManager();
+
+    void Initialize(AudioCodec* codec);
+    // 按 codec 当前状态开始计时 (AudioCodec::Start() 会打开输入和输出)
+    void Start();
+    void Stop();
+
+    /**
+     * 预告某个方向即将使用
+     * @return 该方向尚未上电, 调用方应唤醒使用它的任务执行 Ensure()
+     */
+    bool Request(CodecPowerDirection direction);
+    bool requested(CodecPowerDirection direction) const {
+        return requested_[direction].load(std::memory_order_acquire);
+    }
+
+    void Ensure(CodecPowerDirection direction);
+    // 只记录活动, 推迟空闲关闭
+    void Touch(CodecPowerDirection direction);
+
+    CodecPowerState GetState(CodecPowerDirection direction) const;
+    CodecPowerStatistics GetStatistics(CodecPowerDirection direction) const;
+
+private:
+    bool enabled(CodecPowerDirection direction) const;
+    void OnTimer();
+    void ArmTimer(int64_t delay_us);
+
+    AudioCodec* codec_ = nullptr;
+    esp_timer_handle_t timer_ = nullptr;
+    bool timer_armed_ = false;
+    mutable std::mutex mutex_;      // 上电与断电互斥, 也保护统计
+    std::atomic<bool> requested_[kCodecPowerDirectionCount] = {};
+    std::atomic<int64_t> last_active_us_[kCodecPowerDirectionCount] = {};
+    CodecPowerStatistics statistics_[kCodecPowerDirectionCount];
+};
+
+#endif // CODEC_POWER_H
@@ -32,6 +32,7 @@ public:
     virtual void SetOutputVolume(int volume) override;
     virtual void EnableInput(bool enable) override;
     virtual void EnableOutput(bool enable) override;
+    virtual const char* name() const override { return "Box"; }
 };
 
 #endif // _BOX_AUDIO_CODEC_H
@@ -11,6 +11,8 @@ private:
 public:
     DummyAudioCodec(int input_sample_rate, int output_sample_rate);
     virtual ~DummyAudioCodec();
+
+    virtual const char* name() const override { return "Dummy"; }
 };
 
 #endif // _DUMMY_AUDIO_CODEC_H
\ No newline at end of file
@@ -34,6 +34,7 @@ public:
     virtual void SetOutputVolume(int volume) override;
     virtual void EnableInput(bool enable) override;
     virtual void EnableOutput(bool enable) override;
+    virtual const char* name() const override { return "ES8311"; }
 };
 
 #endif // _ES8311_AUDIO_CODEC_H
\ No newline at end of file
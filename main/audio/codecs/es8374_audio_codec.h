@@ -33,6 +33,7 @@ public:
     virtual void SetOutputVolume(int volume) override;
     virtual void EnableInput(bool enable) override;
     virtual void EnableOutput(bool enable) override;
+    virtual const char* name() const override { return "ES8374"; }
 };
 
 #endif // _ES8374_AUDIO_CODEC_H
\ No newline at end of file
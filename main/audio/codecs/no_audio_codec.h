@@ -12,6 +12,7 @@ private:
     virtual int Read(int16_t* dest, int samples) override;
 
 public:
+    NoAudioCodec();
     virtual ~NoAudioCodec();
 };
 
@@ -0,0 +1,443 @@
+#include "audio_dsp.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+
+#include <algorithm>
+
+#define TAG "AudioDsp"
+
+#if CONFIG_IDF_TARGET_ESP32S3
+#define AUDIO_DSP_HAS_PIE 1
+#else
+#define AUDIO_DSP_HAS_PIE 0
+#endif
+
+// 自检数据长度 (一帧 60ms@16kHz) 与计时重复次数
+#define SELF_TEST_FRAMES 960
+#define SELF_TEST_ROUNDS 20
+
+namespace audio_dsp {
+
+static bool simd_ready = false;
+
+// ========== 标量参考实现 ==========
+
+static void Deinterleave2Scalar(const int16_t* src, int16_t* left, int16_t* right, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        left[i] = src[2 * i];
+        right[i] = src[2 * i + 1];
+    }
+}
+
+static void Interleave2Scalar(const int16_t* left, const int16_t* right, int16_t* dst, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        dst[2 * i] = left[i];
+        dst[2 * i + 1] = right[i];
+    }
+}
+
+static void DownmixStereoScalar(const int16_t* src, int16_t* dst, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        dst[i] = (src[2 * i] >> 1) + (src[2 * i + 1] >> 1);
+    }
+}
+
+static void ApplyGainScalar(const int16_t* src, int16_t* dst, size_t samples, int32_t gain_q15) {
+    for (size_t i = 0; i < samples; i++) {
+        int32_t value = (src[i] * gain_q15) >> 15;
+        dst[i] = std::clamp<int32_t>(value, INT16_MIN, INT16_MAX);
+    }
+}
+
+// 半增益 Q14: (x * g) >> 15 == (x * (g / 2)) >> 14 对偶数 g 精确成立, 且 g / 2 <= 16384 可以放进 int16
+static void MixSaturateScalar(int16_t* dst, const int16_t* src, size_t samples, int16_t dst_half, int16_t src_half) {
+    for (size_t i = 0; i < samples; i++) {
+        int32_t value = ((dst[i] * dst_half) >> 14) + ((src[i] * src_half) >> 14);
+        dst[i] = std::clamp<int32_t>(value, INT16_MIN, INT16_MAX);
+    }
+}
+
+static void Widen16To32Scalar(const int16_t* src, int32_t* dst, size_t samples, int32_t gain_q15) {
+    for (size_t i = 0; i < samples; i++) {
+        dst[i] = src[i] * gain_q15 * 2;
+    }
+}
+
+static void Narrow32To16Scalar(const int32_t* src, int16_t* dst, size_t samples, int shift) {
+    for (size_t i = 0; i < samples; i++) {
+        dst[i] = std::clamp<int32_t>(src[i] >> shift, -INT16_MAX, INT16_MAX);
+    }
+}
+
+// ========== ESP32-S3 PIE 实现 ==========
+// 每条 128 位指令处理 8 个 int16. Q 寄存器不参与编译器分配, 由 FreeRTOS 在任务切换时保存.
+// 每个 asm 块自行设置 SAR, 因为编译器生成的移位代码也会使用它.
+
+#if AUDIO_DSP_HAS_PIE
+
+static inline bool Aligned(const void* a, const void* b, const void* c = nullptr) {
+    return ((reinterpret_cast<uintptr_t>(a) | reinterpret_cast<uintptr_t>(b) | reinterpret_cast<uintptr_t>(c)) & 15) == 0;
+}
+
+static void Deinterleave2Pie(const int16_t* src, int16_t* left, int16_t* right, size_t frames) {
+    size_t blocks = frames / 8;
+    for (size_t i = 0; i < blocks; i++) {
+        asm volatile(
+            "ee.vld.128.ip q0, %0, 16\n"
+            "ee.vld.128.ip q1, %0, 16\n"
+            "ee.vunzip.16 q0, q1\n"
+            "ee.vst.128.ip q0, %1, 16\n"
+            "ee.vst.128.ip q1, %2, 16\n"
+            : "+r"(src), "+r"(left), "+r"(right) : : "memory");
+    }
+    Deinterleave2Scalar(src, left, right, frames % 8);
+}
+
+static void Interleave2Pie(const int16_t* left, const int16_t* right, int16_t* dst, size_t frames) {
+    size_t blocks = frames / 8;
+    for (size_t i = 0; i < blocks; i++) {
+        asm volatile(
+            "ee.vld.128.ip q0, %0, 16\n"
+            "ee.vld.128.ip q1, %1, 16\n"
+            "ee.vzip.16 q0, q1\n"
+            "ee.vst.128.ip q0, %2, 16\n"
+            "ee.vst.128.ip q1, %2, 16\n"
+            : "+r"(left), "+r"(right), "+r"(dst) : : "memory");
+    }
+    Interleave2Scalar(left, right, dst, frames % 8);
+}
+
+static void DownmixStereoPie(const int16_t* src, int16_t* dst, size_t frames) {
+    static const int16_t half = 16384;
+    size_t blocks = frames / 8;
+    for (size_t i = 0; i < blocks; i++) {
+        asm volatile(
+            "wsr.sar %2\n"
+            "ee.vldbc.16 q7, %3\n"
+            "ee.vld.128.ip q0, %0, 16\n"
+            "ee.vld.128.ip q1, %0, 16\n"
+            "ee.vunzip.16 q0, q1\n"
+            "ee.vmul.s16 q0, q0, q7\n"
+            "ee.vmul.s16 q1, q1, q7\n"
+            "ee.vadds.s16 q2, q0, q1\n"
+            "ee.vst.128.ip q2, %1, 16\n"
+            : "+r"(src), "+r"(dst) : "r"(15), "r"(&half) : "memory");
+    }
+    DownmixStereoScalar(src, dst, frames % 8);
+}
+
+// 仅用于 0 <= gain < 1.0, 乘积右移 15 位后不会溢出
+static void AttenuatePie(const int16_t* src, int16_t* dst, size_t samples, int16_t gain_q15) {
+    size_t blocks = samples / 8;
+    for (size_t i = 0; i < blocks; i++) {
+        asm volatile(
+            "wsr.sar %2\n"
+            "ee.vldbc.16 q7, %3\n"
+            "ee.vld.128.ip q0, %0, 16\n"
+            "ee.vmul.s16 q1, q0, q7\n"
+            "ee.vst.128.ip q1, %1, 16\n"
+            : "+r"(src), "+r"(dst) : "r"(15), "r"(&gain_q15) : "memory");
+    }
+    ApplyGainScalar(src, dst, samples % 8, gain_q15);
+}
+
+// 两路分别乘半增益 (SAR=14) 后饱和相加
+static void MixSaturatePie(int16_t* dst, const int16_t* src, size_t samples, int16_t dst_half, int16_t src_half) {
+    size_t blocks = samples / 8;
+    int16_t* out = dst;
+    for (size_t i = 0; i < blocks; i++) {
+        asm volatile(
+            "wsr.sar %3\n"
+            "ee.vldbc.16 q6, %4\n"
+            "ee.vldbc.16 q7, %5\n"
+            "ee.vld.128.ip q0, %0, 16\n"
+            "ee.vld.128.ip q1, %1, 16\n"
+            "ee.vmul.s16 q0, q0, q6\n"
+            "ee.vmul.s16 q1, q1, q7\n"
+            "ee.vadds.s16 q2, q0, q1\n"
+            "ee.vst.128.ip q2, %2, 16\n"
+            : "+r"(dst), "+r"(src), "+r"(out) : "r"(14), "r"(&dst_half), "r"(&src_half) : "memory");
+    }
+    MixSaturateScalar(out, src, samples % 8, dst_half, src_half);
+}
+
+// 32 位积 p = src * gain 拆成两个 16 位乘法: SAR=0 时 vmul 保留乘积低 16 位,
+// 用 2 * gain (按 int16 回绕) 得到 (p << 1) 的低半部分; SAR=15 得到高半部分, 再交错成 int32
+static void Widen16To32Pie(const int16_t* src, int32_t* dst, size_t samples, int16_t gain_q15) {
+    const int16_t gain_low = static_cast<int16_t>(gain_q15 * 2);
+    size_t blocks = samples / 8;
+    for (size_t i = 0; i < blocks; i++) {
+        asm volatile(
+            "ee.vldbc.16 q6, %4\n"
+            "ee.vldbc.16 q7, %5\n"
+            "ee.vld.128.ip q0, %0, 16\n"
+            "wsr.sar %2\n"
+            "ee.vmul.s16 q1, q0, q6\n"
+            "wsr.sar %3\n"
+            "ee.vmul.s16 q2, q0, q7\n"
+            "ee.vzip.16 q1, q2\n"
+            "ee.vst.128.ip q1, %1, 16\n"
+            "ee.vst.128.ip q2, %1, 16\n"
+            : "+r"(src), "+r"(dst) : "r"(0), "r"(15), "r"(&gain_low), "r"(&gain_q15) : "memory");
+    }
+    Widen16To32Scalar(src, dst, samples % 8, gain_q15);
+}
+
+// 单位增益: 低半部分为 0, 高半部分为原样本
+static void Widen16To32UnityPie(const int16_t* src, int32_t* dst, size_t samples) {
+    size_t blocks = samples / 8;
+    for (size_t i = 0; i < blocks; i++) {
+        asm volatile(
+            "ee.zero.q q1\n"
+            "ee.vld.128.ip q0, %0, 16\n"
+            "ee.vzip.16 q1, q0\n"
+            "ee.vst.128.ip q1, %1, 16\n"
+            "ee.vst.128.ip q0, %1, 16\n"
+            : "+r"(src), "+r"(dst) : : "memory");
+    }
+    Widen16To32Scalar(src, dst, samples % 8, kUnityGain);
+}
+
+static void Narrow32To16Pie(const int32_t* src, int16_t* dst, size_t samples, int shift) {
+    static const int32_t upper = INT16_MAX;
+    static const int32_t lower = -INT16_MAX;
+    size_t blocks = samples / 8;
+    for (size_t i = 0; i < blocks; i++) {
+        asm volatile(
+            "wsr.sar %2\n"
+            "ee.vldbc.32 q6, %3\n"
+            "ee.vldbc.32 q7, %4\n"
+            "ee.vld.128.ip q0, %0, 16\n"
+            "ee.vld.128.ip q1, %0, 16\n"
+            "ee.vsr.32 q0, q0\n"
+            "ee.vsr.32 q1, q1\n"
+            "ee.vmin.s32 q0, q0, q6\n"
+            "ee.vmin.s32 q1, q1, q6\n"
+            "ee.vmax.s32 q0, q0, q7\n"
+            "ee.vmax.s32 q1, q1, q7\n"
+            "ee.vunzip.16 q0, q1\n"
+            "ee.vst.128.ip q0, %1, 16\n"
+            : "+r"(src), "+r"(dst) : "r"(shift), "r"(&upper), "r"(&lower) : "memory");
+    }
+    Narrow32To16Scalar(src, dst, samples % 8, shift);
+}
+
+#endif // AUDIO_DSP_HAS_PIE
+
+// ========== 分发 ==========
+
+void Deinterleave2(const int16_t* src, int16_t* left, int16_t* right, size_t frames) {
+#if AUDIO_DSP_HAS_PIE
+    if (simd_ready && Aligned(src, left, right)) {
+        Deinterleave2Pie(src, left, right, frames);
+        return;
+    }
+#endif
+    Deinterleave2Scalar(src, left, right, frames);
+}
+
+void Interleave2(const int16_t* left, const int16_t* right, int16_t* dst, size_t frames) {
+#if AUDIO_DSP_HAS_PIE
+    if (simd_ready && Aligned(left, right, dst)) {
+        Interleave2Pie(left, right, dst, frames);
+        return;
+    }
+#endif
+    Interleave2Scalar(left, right, dst, frames);
+}
+
+void ExtractChannel(const int16_t* src, int16_t* dst, size_t frames, int channels, int channel) {
+    src += channel;
+    for (size_t i = 0; i < frames; i++) {
+        dst[i] = *src;
+        src += channels;
+    }
+}
+
+void DownmixStereo(const int16_t* src, int16_t* dst, size_t frames) {
+#if AUDIO_DSP_HAS_PIE
+    if (simd_ready && Aligned(src, dst)) {
+        DownmixStereoPie(src, dst, frames);
+        return;
+    }
+#endif
+    DownmixStereoScalar(src, dst, frames);
+}
+
+void ApplyGain(const int16_t* src, int16_t* dst, size_t samples, int32_t gain_q15) {
+    gain_q15 = std::clamp<int32_t>(gain_q15, -65535, 65535);
+    if (gain_q15 == kUnityGain) {
+        if (src != dst) {
+            std::copy(src, src + samples, dst);
+        }
+        return;
+    }
+#if AUDIO_DSP_HAS_PIE
+    if (simd_ready && gain_q15 >= 0 && gain_q15 < kUnityGain && Aligned(src, dst)) {
+        AttenuatePie(src, dst, samples, static_cast<int16_t>(gain_q15));
+        return;
+    }
+#endif
+    ApplyGainScalar(src, dst, samples, gain_q15);
+}
+
+void MixSaturate(int16_t* dst, const int16_t* src, size_t samples, int32_t dst_gain_q15, int32_t src_gain_q15) {
+    int16_t dst_half = static_cast<int16_t>(std::clamp<int32_t>(dst_gain_q15, 0, kUnityGain) >> 1);
+    int16_t src_half = static_cast<int16_t>(std::clamp<int32_t>(src_gain_q15, 0, kUnityGain) >> 1);
+#if AUDIO_DSP_HAS_PIE
+    if (simd_ready && Aligned(dst, src)) {
+        MixSaturatePie(dst, src, samples, dst_half, src_half);
+        return;
+    }
+#endif
+    MixSaturateScalar(dst, src, samples, dst_half, src_half);
+}
+
+void Widen16To32(const int16_t* src, int32_t* dst, size_t samples, int32_t gain_q15) {
+    gain_q15 = std::clamp<int32_t>(gain_q15, 0, kUnityGain);
+#if AUDIO_DSP_HAS_PIE
+    if (simd_ready && Aligned(src, dst)) {
+        if (gain_q15 == kUnityGain) {
+            Widen16To32UnityPie(src, dst, samples);
+        } else {
+            Widen16To32Pie(src, dst, samples, static_cast<int16_t>(gain_q15));
+        }
+        return;
+    }
+#endif
+    Widen16To32Scalar(src, dst, samples, gain_q15);
+}
+
+void Narrow32To16(const int32_t* src, int16_t* dst, size_t samples, int shift) {
+#if AUDIO_DSP_HAS_PIE
+    if (simd_ready && Aligned(src, dst)) {
+        Narrow32To16Pie(src, dst, samples, shift);
+        return;
+    }
+#endif
+    Narrow32To16Scalar(src, dst, samples, shift);
+}
+
+bool simd_enabled() {
+    return simd_ready;
+}
+
+// ========== 自检 ==========
+
+#if AUDIO_DSP_HAS_PIE
+
+template <typename Func>
+static int64_t Measure(Func func) {
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < SELF_TEST_ROUNDS; i++) {
+        func();
+    }
+    return esp_timer_get_time() - start;
+}
+
+template <typename T>
+static bool Check(const char* name, const T* expected, const T* actual, size_t count) {
+    if (std::equal(expected, expected + count, actual)) {
+        return true;
+    }
+    ESP_LOGE(TAG, "%s: SIMD result differs from scalar reference", name);
+    return false;
+}
+
+bool SelfTest() {
+    simd_ready = false;
+
+    const size_t frames = SELF_TEST_FRAMES;
+    AlignedBuffer<int16_t> input, left, right, expected, actual;
+    AlignedBuffer<int32_t> wide, wide_expected, wide_actual;
+    if (!input.Resize(frames * 2) || !left.Resize(frames) || !right.Resize(frames) ||
+        !expected.Resize(frames * 2) || !actual.Resize(frames * 2) ||
+        !wide.Resize(frames * 2) || !wide_expected.Resize(frames * 2) || !wide_actual.Resize(frames * 2)) {
+        ESP_LOGE(TAG, "Failed to allocate self test buffers");
+        return false;
+    }
+
+    // 覆盖正负满幅与奇数值 (检验移位的舍入方向)
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < frames * 2; i++) {
+        seed = seed * 1103515245 + 12345;
+        input.data()[i] = static_cast<int16_t>(seed >> 16);
+    }
+    input.data()[0] = INT16_MIN;
+    input.data()[1] = INT16_MAX;
+
+    bool ok = true;
+    int64_t scalar_us = 0;
+    int64_t simd_us = 0;
+
+    Deinterleave2Scalar(input.data(), expected.data(), expected.data() + frames, frames);
+    Deinterleave2Pie(input.data(), actual.data(), actual.data() + frames, frames);
+    ok &= Check("Deinterleave2", expected.data(), actual.data(), frames * 2);
+    scalar_us += Measure([&]() { Deinterleave2Scalar(input.data(), left.data(), right.data(), frames); });
+    simd_us += Measure([&]() { Deinterleave2Pie(input.data(), left.data(), right.data(), frames); });
+
+    Deinterleave2Scalar(input.data(), left.data(), right.data(), frames);
+    Interleave2Pie(left.data(), right.data(), actual.data(), frames);
+    ok &= Check("Interleave2", input.data(), actual.data(), frames * 2);
+    scalar_us += Measure([&]() { Interleave2Scalar(left.data(), right.data(), actual.data(), frames); });
+    simd_us += Measure([&]() { Interleave2Pie(left.data(), right.data(), actual.data(), frames); });
+
+    DownmixStereoScalar(input.data(), expected.data(), frames);
+    DownmixStereoPie(input.data(), actual.data(), frames);
+    ok &= Check("DownmixStereo", expected.data(), actual.data(), frames);
+    scalar_us += Measure([&]() { DownmixStereoScalar(input.data(), actual.data(), frames); });
+    simd_us += Measure([&]() { DownmixStereoPie(input.data(), actual.data(), frames); });
+
+    const int16_t gain = 23170;  // -3dB
+    ApplyGainScalar(input.data(), expected.data(), frames * 2, gain);
+    AttenuatePie(input.data(), actual.data(), frames * 2, gain);
+    ok &= Check("ApplyGain", expected.data(), actual.data(), frames * 2);
+    scalar_us += Measure([&]() { ApplyGainScalar(input.data(), actual.data(), frames * 2, gain); });
+    simd_us += Measure([&]() { AttenuatePie(input.data(), actual.data(), frames * 2, gain); });
+
+    // 两路满幅同号相加, 检验饱和
+    const int16_t duck_half = 4116;   // -12dB
+    std::copy(input.data(), input.data() + frames * 2, expected.data());
+    std::copy(input.data(), input.data() + frames * 2, actual.data());
+    MixSaturateScalar(expected.data(), input.data(), frames * 2, kUnityGain >> 1, duck_half);
+    MixSaturatePie(actual.data(), input.data(), frames * 2, kUnityGain >> 1, duck_half);
+    ok &= Check("MixSaturate", expected.data(), actual.data(), frames * 2);
+    scalar_us += Measure([&]() { MixSaturateScalar(actual.data(), input.data(), frames * 2, duck_half, kUnityGain >> 1); });
+    simd_us += Measure([&]() { MixSaturatePie(actual.data(), input.data(), frames * 2, duck_half, kUnityGain >> 1); });
+
+    Widen16To32Scalar(input.data(), wide_expected.data(), frames * 2, gain);
+    Widen16To32Pie(input.data(), wide_actual.data(), frames * 2, gain);
+    ok &= Check("Widen16To32", wide_expected.data(), wide_actual.data(), frames * 2);
+    Widen16To32Scalar(input.data(), wide_expected.data(), frames * 2, kUnityGain);
+    Widen16To32UnityPie(input.data(), wide_actual.data(), frames * 2);
+    ok &= Check("Widen16To32 (unity)", wide_expected.data(), wide_actual.data(), frames * 2);
+    scalar_us += Measure([&]() { Widen16To32Scalar(input.data(), wide_actual.data(), frames * 2, gain); });
+    simd_us += Measure([&]() { Widen16To32Pie(input.data(), wide_actual.data(), frames * 2, gain); });
+
+    // 模拟 32 位 I2S 麦克风数据: 有效位在高位, 部分样本右移后超出 int16
+    for (size_t i = 0; i < frames * 2; i++) {
+        wide.data()[i] = static_cast<int32_t>(input.data()[i]) << (i % 3 == 0 ? 16 : 12);
+    }
+    Narrow32To16Scalar(wide.data(), expected.data(), frames * 2, 12);
+    Narrow32To16Pie(wide.data(), actual.data(), frames * 2, 12);
+    ok &= Check("Narrow32To16", expected.data(), actual.data(), frames * 2);
+    scalar_us += Measure([&]() { Narrow32To16Scalar(wide.data(), actual.data(), frames * 2, 12); });
+    simd_us += Measure([&]() { Narrow32To16Pie(wide.data(), actual.data(), frames * 2, 12); });
+
+    ESP_LOGI(TAG, "Self test %s, %d rounds: scalar %lld us, SIMD %lld us",
+             ok ? "passed" : "failed", SELF_TEST_ROUNDS, scalar_us, simd_us);
+    simd_ready = ok;
+    return ok;
+}
+
+#else
+
+bool SelfTest() {
+    return false;
+}
+
+#endif // AUDIO_DSP_HAS_PIE
+
+}  // namespace audio_dsp
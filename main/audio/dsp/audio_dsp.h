@@ -0,0 +1,120 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <esp_heap_caps.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * 音频 DSP 基础运算
+ *
+ * - 所有函数写入调用方提供的缓冲区, 不分配内存
+ * - 每个运算都有可移植的标量实现 (参考实现)
+ * - ESP32-S3 上使用 PIE 128 位 SIMD 指令, 要求参与运算的缓冲区 16 字节对齐
+ *   (AlignedBuffer 分配的缓冲区满足), 不对齐时自动回退到标量实现
+ * - SIMD 路径在 SelfTest() 与标量实现逐样本比对通过后才启用
+ *
+ * 重采样仍使用 OpusResampler (libopus SILK 重采样器), 它同样写入调用方缓冲区.
+ */
+namespace audio_dsp {
+
+// Q15 单位增益
+constexpr int32_t kUnityGain = 32768;
+
+/**
+ * 双声道交错数据拆分: L R L R ... -> L L ..., R R ...
+ */
+void Deinterleave2(const int16_t* src, int16_t* left, int16_t* right, size_t frames);
+
+/**
+ * 双声道合并为交错数据
+ */
+void Interleave2(const int16_t* left, const int16_t* right, int16_t* dst, size_t frames);
+
+/**
+ * 从交错数据中取出一个声道
+ */
+void ExtractChannel(const int16_t* src, int16_t* dst, size_t frames, int channels, int channel);
+
+/**
+ * 双声道混为单声道: (L >> 1) + (R >> 1)
+ */
+void DownmixStereo(const int16_t* src, int16_t* dst, size_t frames);
+
+/**
+ * 增益 (Q15, kUnityGain = 1.0, 绝对值不超过 65535 即约 +6dB), 结果饱和到 int16, src 与 dst 可以相同
+ */
+void ApplyGain(const int16_t* src, int16_t* dst, size_t samples, int32_t gain_q15);
+
+/**
+ * 两路混合: dst = dst * dst_gain + src * src_gain, 结果饱和到 int16
+ * 增益限制在 [0, kUnityGain], 按偶数取整 (SIMD 路径以半增益相乘), 两条路径结果一致
+ */
+void MixSaturate(int16_t* dst, const int16_t* src, size_t samples, int32_t dst_gain_q15, int32_t src_gain_q15);
+
+/**
+ * 16 位样本扩展为 32 位 I2S 样本并施加增益: dst = src * gain_q15 * 2
+ * gain_q15 限制在 [0, kUnityGain], 单位增益时即 src << 16, 结果不会溢出
+ */
+void Widen16To32(const int16_t* src, int32_t* dst, size_t samples, int32_t gain_q15);
+
+/**
+ * 32 位 I2S 样本收窄为 16 位: dst = src >> shift, 饱和到 ±INT16_MAX
+ */
+void Narrow32To16(const int32_t* src, int16_t* dst, size_t samples, int shift);
+
+/**
+ * 比对 SIMD 与标量实现并测量耗时, 通过后启用 SIMD 路径
+ * @return SIMD 路径是否可用 (没有 SIMD 的芯片返回 false)
+ */
+bool SelfTest();
+
+bool simd_enabled();
+
+}  // namespace audio_dsp
+
+/**
+ * 16 字节对齐的缓冲区, 只增不减, 供 SIMD 路径使用
+ * caps 可指定 MALLOC_CAP_DMA, 用作 I2S 读写的中转缓冲区
+ */
+template <typename T>
+class AlignedBuffer {
+public:
+    explicit AlignedBuffer(uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) : caps_(caps) {}
+    ~AlignedBuffer() {
+        if (data_ != nullptr) {
+            heap_caps_free(data_);
+        }
+    }
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    /**
+     * 确保容量不少于 size 个元素, 内容不保留
+     */
+    T* Resize(size_t size) {
+        if (size > capacity_) {
+            if (data_ != nullptr) {
+                heap_caps_free(data_);
+            }
+            data_ = static_cast<T*>(heap_caps_aligned_alloc(16, size * sizeof(T), caps_));
+            capacity_ = data_ != nullptr ? size : 0;
+        }
+        size_ = data_ != nullptr ? size : 0;
+        return data_;
+    }
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    uint32_t caps_;
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+#endif // AUDIO_DSP_H
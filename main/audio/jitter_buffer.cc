@@ -0,0 +1,133 @@
+#include "jitter_buffer.h"
+
+#include <algorithm>
+
+JitterBuffer::JitterBuffer() {
+    UpdateTarget();
+}
+
+void JitterBuffer::StartStream(int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 媒体时钟和最小 transit 按流重新计算, 延迟峰值和余量保留
+    media_time_us_ = 0;
+    has_transit_ = false;
+    stream_start_us_ = now_us;
+    underrun_start_us_ = 0;
+    waiting_first_audio_ = true;
+    stream_active_.store(true, std::memory_order_relaxed);
+}
+
+void JitterBuffer::EndStream() {
+    stream_active_.store(false, std::memory_order_relaxed);
+}
+
+void JitterBuffer::OnPacketArrival(int64_t now_us, int frame_duration_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame_duration_ms > 0 && frame_duration_ms != frame_duration_ms_) {
+        frame_duration_ms_ = frame_duration_ms;
+        stable_ms_ = 0;
+    }
+
+    int64_t transit_us = now_us - media_time_us_;
+    media_time_us_ += frame_duration_ms_ * 1000;
+
+    if (!has_transit_) {
+        has_transit_ = true;
+        min_transit_us_ = transit_us;
+        last_transit_us_ = transit_us;
+    }
+
+    // RFC 3550: J += (|D| - J) / 16
+    int64_t d = transit_us - last_transit_us_;
+    if (d < 0) {
+        d = -d;
+    }
+    jitter_us_ += (d - jitter_us_) / 16;
+    last_transit_us_ = transit_us;
+
+    // 服务器快于实时发送时 transit 变小, 最小值随之下降, 延迟为 0
+    if (transit_us < min_transit_us_) {
+        min_transit_us_ = transit_us;
+    }
+    int64_t delay_us = transit_us - min_transit_us_;
+
+    // 快速上升, 慢速衰减 (每包 1/64)
+    if (peak_delay_us_ < 0 || delay_us > peak_delay_us_) {
+        peak_delay_us_ = delay_us;
+    } else {
+        peak_delay_us_ -= peak_delay_us_ / 64;
+    }
+
+    UpdateTarget();
+}
+
+void JitterBuffer::OnPlaybackStarted(int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (waiting_first_audio_) {
+        waiting_first_audio_ = false;
+        uint32_t ttfa_ms = (now_us - stream_start_us_) / 1000;
+        statistics_.last_time_to_first_audio_ms = ttfa_ms;
+        statistics_.max_time_to_first_audio_ms = std::max(statistics_.max_time_to_first_audio_ms, ttfa_ms);
+        statistics_.streams++;
+    }
+    if (underrun_start_us_ != 0) {
+        statistics_.rebuffer_ms += (now_us - underrun_start_us_) / 1000;
+        underrun_start_us_ = 0;
+    }
+}
+
+void JitterBuffer::OnUnderrun(int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_.underruns++;
+    underrun_start_us_ = now_us;
+    stable_ms_ = 0;
+    underrun_margin_ms_ = std::min(underrun_margin_ms_ + JITTER_BUFFER_UNDERRUN_STEP_MS, JITTER_BUFFER_MAX_MS);
+    UpdateTarget();
+}
+
+void JitterBuffer::OnFramePlayed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (underrun_margin_ms_ == 0) {
+        return;
+    }
+    stable_ms_ += frame_duration_ms_;
+    if (stable_ms_ >= JITTER_BUFFER_SHRINK_INTERVAL_MS) {
+        // 每次收回一帧
+        stable_ms_ = 0;
+        underrun_margin_ms_ = std::max(underrun_margin_ms_ - frame_duration_ms_, 0);
+        UpdateTarget();
+    }
+}
+
+int JitterBuffer::ToFrames(int64_t duration_us) const {
+    int64_t frame_us = frame_duration_ms_ * 1000;
+    return (duration_us + frame_us - 1) / frame_us;
+}
+
+void JitterBuffer::UpdateTarget() {
+    int target = ToFrames((JITTER_BUFFER_INITIAL_MS + underrun_margin_ms_) * 1000LL);
+    if (peak_delay_us_ >= 0) {
+        target = ToFrames(peak_delay_us_) + ToFrames(underrun_margin_ms_ * 1000LL) + 1;
+    }
+    int min_frames = std::max(ToFrames(JITTER_BUFFER_MIN_MS * 1000LL), 1);
+    int max_frames = std::max(JITTER_BUFFER_MAX_MS / frame_duration_ms_, min_frames);
+    target = std::clamp(target, min_frames, max_frames);
+    target_frames_.store(target, std::memory_order_relaxed);
+    statistics_.target_frames = target;
+    statistics_.target_ms = target * frame_duration_ms_;
+    statistics_.frame_duration_ms = frame_duration_ms_;
+}
+
+JitterBufferStatistics JitterBuffer::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    JitterBufferStatistics statistics = statistics_;
+    statistics.jitter_ms = jitter_us_ / 1000;
+    statistics.peak_delay_ms = peak_delay_us_ > 0 ? peak_delay_us_ / 1000 : 0;
+    return statistics;
+}
+
+void JitterBuffer::ResetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_ = JitterBufferStatistics();
+    UpdateTarget();
+}
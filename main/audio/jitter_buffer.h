@@ -0,0 +1,126 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// 阈值按时长定义, 换算成帧数时使用当前流的帧时长, 所以 20ms 与 60ms 帧的缓冲时长相同
+// 目标深度范围, 上限沿用原先 4G 固定预缓冲的 1800ms (30 帧 * 60ms)
+#define JITTER_BUFFER_MIN_MS 120
+#define JITTER_BUFFER_MAX_MS 1800
+// 还没有任何到达统计时的初始目标
+#define JITTER_BUFFER_INITIAL_MS 300
+// 每次欠载增加的余量, 以及稳定播放多久后收回一步余量
+#define JITTER_BUFFER_UNDERRUN_STEP_MS 120
+#define JITTER_BUFFER_SHRINK_INTERVAL_MS 6000
+// 帧时长未知时 (还没有包到达) 的假定值
+#define JITTER_BUFFER_DEFAULT_FRAME_MS 60
+
+/**
+ * 自适应抖动缓冲统计
+ */
+struct JitterBufferStatistics {
+    int target_frames = 0;                  // 当前目标深度 (帧)
+    int target_ms = 0;                      // 当前目标深度 (时长)
+    int frame_duration_ms = 0;              // 当前流的帧时长
+    uint32_t jitter_ms = 0;                 // RFC 3550 平滑到达抖动
+    uint32_t peak_delay_ms = 0;             // 相对最快到达的延迟峰值 (慢衰减)
+    uint32_t last_time_to_first_audio_ms = 0;
+    uint32_t max_time_to_first_audio_ms = 0;
+    uint32_t streams = 0;                   // 已开始播放的 TTS 流数量
+    uint32_t underruns = 0;                 // 播放中途欠载次数
+    uint32_t rebuffer_ms = 0;               // 欠载等待累计时长
+};
+
+/**
+ * 自适应抖动缓冲 (只负责决定缓冲深度, 数据仍在解码/播放队列中)
+ *
+ * 原理:
+ * - 每个包到达时计算 transit = 到达时间 - 媒体时间 (累计帧时长)
+ * - 延迟 = transit - 本流内最小 transit, 即该包比"最快情况"晚了多少
+ * - 延迟峰值快速上升、缓慢衰减, 目标深度 = 峰值 + 欠载余量 + 1 帧
+ * - 欠载时增加余量, 连续稳定播放后逐步收回, 所以同一个流内也会伸缩
+ * - 统计跨流保留: 同一网络上的下一个流直接使用已学到的深度
+ * - 峰值与余量都以时长保存, 帧时长随会话协商变化 (20/40/60ms) 时目标帧数随之换算
+ *
+ * 所有时间由调用方传入 (微秒), 类本身不依赖 FreeRTOS, 可以在主机上用记录的
+ * 到达时间序列回放.
+ */
+class JitterBuffer {
+public:
+    JitterBuffer();
+
+    /**
+     * 新的 TTS 流开始 (收到 AUDIO_START)
+     */
+    void StartStream(int64_t now_us);
+
+    /**
+     * 流结束 (收到 AUDIO_END), 之后队列排空不再算作欠载
+     */
+    void EndStream();
+
+    bool stream_active() const { return stream_active_.load(std::memory_order_relaxed); }
+
+    /**
+     * 记录一个包到达
+     */
+    void OnPacketArrival(int64_t now_us, int frame_duration_ms);
+
+    /**
+     * 开始 (或欠载后恢复) 输出
+     */
+    void OnPlaybackStarted(int64_t now_us);
+
+    /**
+     * 播放中途队列为空
+     */
+    void OnUnderrun(int64_t now_us);
+
+    /**
+     * 播放了一帧 (用于在稳定后收回余量)
+     */
+    void OnFramePlayed();
+
+    /**
+     * 首次播放前需要缓冲的帧数 (按当前帧时长换算)
+     */
+    int target_frames() const { return target_frames_.load(std::memory_order_relaxed); }
+
+    /**
+     * 欠载后恢复播放需要的帧数
+     */
+    int resume_frames() const { return target_frames(); }
+
+    JitterBufferStatistics GetStatistics() const;
+    void ResetStatistics();
+
+private:
+    void UpdateTarget();
+    int ToFrames(int64_t duration_us) const;
+
+    mutable std::mutex mutex_;
+    std::atomic<int> target_frames_{JITTER_BUFFER_INITIAL_MS / JITTER_BUFFER_DEFAULT_FRAME_MS};
+    std::atomic<bool> stream_active_{false};
+
+    // 到达估计
+    int frame_duration_ms_ = JITTER_BUFFER_DEFAULT_FRAME_MS;
+    int64_t media_time_us_ = 0;
+    int64_t min_transit_us_ = 0;
+    int64_t last_transit_us_ = 0;
+    bool has_transit_ = false;
+    int64_t jitter_us_ = 0;
+    int64_t peak_delay_us_ = -1;    // < 0: 还没有到达统计
+    int underrun_margin_ms_ = 0;
+    int stable_ms_ = 0;             // 上次欠载或收回余量后稳定播放的时长
+
+    // 播放时间
+    int64_t stream_start_us_ = 0;
+    int64_t underrun_start_us_ = 0;
+    bool waiting_first_audio_ = false;
+
+    JitterBufferStatistics statistics_;
+};
+
+#endif // JITTER_BUFFER_H
@@ -0,0 +1,155 @@
+#include "loopback_analysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+int16_t LoopbackChirpSample(size_t index, int sample_rate) {
+    // The same continuous signal at any rate, so the template at the input rate matches what was played
+    const float duration = LOOPBACK_TEST_CHIRP_MS / 1000.0f;
+    const float sweep = (LOOPBACK_TEST_CHIRP_END_HZ - LOOPBACK_TEST_CHIRP_START_HZ) / duration;
+    float t = (float)index / sample_rate;
+    float phase = 2.0f * (float)M_PI * (LOOPBACK_TEST_CHIRP_START_HZ * t + 0.5f * sweep * t * t);
+    // 5 ms raised-cosine edges keep the speaker from clicking
+    const float edge = 0.005f;
+    float gain = 1.0f;
+    if (t < edge) {
+        gain = 0.5f - 0.5f * cosf((float)M_PI * t / edge);
+    } else if (t > duration - edge) {
+        gain = 0.5f - 0.5f * cosf((float)M_PI * (duration - t) / edge);
+    }
+    return (int16_t)(LOOPBACK_TEST_AMPLITUDE * gain * sinf(phase));
+}
+
+int16_t LoopbackSignalSample(size_t index, int sample_rate) {
+    const size_t lead = (size_t)sample_rate * LOOPBACK_TEST_LEAD_MS / 1000;
+    const size_t interval = (size_t)sample_rate * LOOPBACK_TEST_CHIRP_INTERVAL_MS / 1000;
+    const size_t chirp = (size_t)sample_rate * LOOPBACK_TEST_CHIRP_MS / 1000;
+    if (index >= lead && index < lead + chirp) {
+        return LoopbackChirpSample(index - lead, sample_rate);
+    }
+    if (index >= lead + interval && index < lead + interval + chirp) {
+        return LoopbackChirpSample(index - lead - interval, sample_rate);
+    }
+    return 0;
+}
+
+size_t LoopbackSignalSamples(int sample_rate) {
+    return (size_t)sample_rate * (LOOPBACK_TEST_LEAD_MS + LOOPBACK_TEST_CHIRP_INTERVAL_MS + LOOPBACK_TEST_CHIRP_MS +
+                                  LOOPBACK_TEST_MAX_LATENCY_MS) / 1000;
+}
+
+// Finds the chirp template in x[from, to], index is the sub-sample start of the best match
+static bool FindChirp(const int16_t* x, size_t samples, const std::vector<int16_t>& chirp, int64_t from, int64_t to,
+                      double& index, float& correlation) {
+    const int64_t length = chirp.size();
+    from = std::max<int64_t>(from, 0);
+    to = std::min<int64_t>(to, (int64_t)samples - length);
+    if (to <= from) {
+        return false;
+    }
+
+    auto correlate = [x, &chirp, length](int64_t lag) {
+        int64_t sum = 0;
+        for (int64_t i = 0; i < length; i++) {
+            sum += (int32_t)x[lag + i] * chirp[i];
+        }
+        // The speaker or the microphone may invert the polarity
+        return sum < 0 ? -sum : sum;
+    };
+
+    int64_t chirp_energy = 0;
+    int64_t window_energy = 0;
+    for (int64_t i = 0; i < length; i++) {
+        chirp_energy += (int32_t)chirp[i] * chirp[i];
+        window_energy += (int32_t)x[from + i] * x[from + i];
+    }
+
+    int64_t best = -1;
+    int64_t best_lag = from;
+    int64_t best_energy = 0;
+    for (int64_t lag = from; lag <= to; lag++) {
+        if (lag > from) {
+            window_energy += (int32_t)x[lag + length - 1] * x[lag + length - 1] - (int32_t)x[lag - 1] * x[lag - 1];
+        }
+        int64_t value = correlate(lag);
+        if (value > best) {
+            best = value;
+            best_lag = lag;
+            best_energy = window_energy;
+        }
+    }
+
+    // Parabolic interpolation over the neighbours gives the sub-sample position the drift needs
+    double delta = 0;
+    if (best_lag > from && best_lag < to) {
+        double y0 = correlate(best_lag - 1), y1 = best, y2 = correlate(best_lag + 1);
+        double denominator = y0 - 2 * y1 + y2;
+        if (denominator < 0) {
+            delta = std::clamp(0.5 * (y0 - y2) / denominator, -0.5, 0.5);
+        }
+    }
+    index = best_lag + delta;
+    correlation = best_energy > 0 ? (float)(best / sqrt((double)chirp_energy * best_energy)) : 0;
+    return true;
+}
+
+bool AnalyzeLoopbackCapture(const LoopbackCapture& capture, LoopbackTestResult& result) {
+    const int rate = capture.input_sample_rate;
+    result.input_sample_rate = rate;
+    result.output_sample_rate = capture.output_sample_rate;
+    if (capture.mic == nullptr || capture.samples == 0) {
+        result.error = "no input captured";
+        return false;
+    }
+
+    std::vector<int16_t> chirp((size_t)rate * LOOPBACK_TEST_CHIRP_MS / 1000);
+    for (size_t i = 0; i < chirp.size(); i++) {
+        chirp[i] = LoopbackChirpSample(i, rate);
+    }
+
+    const double expected = capture.chirp_index;
+    const int64_t margin = (int64_t)rate * LOOPBACK_TEST_DRIFT_SEARCH_MS / 1000;
+    const int64_t max_lag = (int64_t)rate * LOOPBACK_TEST_MAX_LATENCY_MS / 1000;
+
+    double mic_index;
+    if (!FindChirp(capture.mic, capture.samples, chirp, (int64_t)expected - margin, (int64_t)expected + max_lag,
+                   mic_index, result.correlation)) {
+        result.error = "chirp outside the capture";
+        return false;
+    }
+    if (result.correlation < LOOPBACK_TEST_MIN_CORRELATION) {
+        result.error = "chirp not detected, check the volume";
+        return false;
+    }
+    result.output_buffer_us = capture.output_buffer_us;
+    result.playback_to_capture_us = (int32_t)((mic_index - expected) * 1000000 / rate);
+    result.round_trip_us = result.output_buffer_us + result.playback_to_capture_us;
+
+    // The second chirp left the DAC exactly LOOPBACK_TEST_CHIRP_INTERVAL_MS of output samples later
+    const double interval = (double)((int64_t)capture.output_sample_rate * LOOPBACK_TEST_CHIRP_INTERVAL_MS / 1000) *
+                            rate / capture.output_sample_rate;
+    double second_index;
+    float second_correlation;
+    int64_t second_expected = (int64_t)(mic_index + interval);
+    if (FindChirp(capture.mic, capture.samples, chirp, second_expected - margin, second_expected + margin, second_index,
+                  second_correlation) &&
+        second_correlation >= LOOPBACK_TEST_MIN_CORRELATION) {
+        result.drift_valid = true;
+        result.drift_ppm = (float)(((second_index - mic_index) / interval - 1.0) * 1000000);
+    }
+
+    double reference_index;
+    float reference_correlation;
+    if (capture.reference != nullptr &&
+        FindChirp(capture.reference, capture.samples, chirp, (int64_t)expected - margin, (int64_t)expected + max_lag,
+                  reference_index, reference_correlation) &&
+        reference_correlation >= LOOPBACK_TEST_MIN_CORRELATION) {
+        result.has_reference = true;
+        result.reference_us = (int32_t)((reference_index - expected) * 1000000 / rate);
+        result.acoustic_us = result.playback_to_capture_us - result.reference_us;
+    }
+
+    result.success = true;
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef LOOPBACK_ANALYSIS_H
+#define LOOPBACK_ANALYSIS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 测试信号: 前导静音, 两个相隔 LOOPBACK_TEST_CHIRP_INTERVAL_MS 的线性扫频 (啁啾), 尾部静音
+#define LOOPBACK_TEST_LEAD_MS 200
+#define LOOPBACK_TEST_CHIRP_MS 100
+#define LOOPBACK_TEST_CHIRP_INTERVAL_MS 2000    // 两个啁啾的间隔, 越长时钟漂移的分辨率越高
+#define LOOPBACK_TEST_CHIRP_START_HZ 500
+#define LOOPBACK_TEST_CHIRP_END_HZ 4000         // 低于 16kHz 采样的奈奎斯特频率
+#define LOOPBACK_TEST_AMPLITUDE 16000           // 约 -6 dBFS, 实际音量还取决于当前输出音量
+// 扬声器到麦克风的最长延迟, 也是尾部静音的长度
+#define LOOPBACK_TEST_MAX_LATENCY_MS 300
+// 第二个啁啾的搜索范围, 覆盖 ±2500 ppm 的时钟偏差
+#define LOOPBACK_TEST_DRIFT_SEARCH_MS 5
+// 归一化相关峰低于此值认为没有检测到 (音量太小或麦克风被遮挡)
+#define LOOPBACK_TEST_MIN_CORRELATION 0.2f
+
+struct LoopbackTestResult {
+    bool success = false;
+    const char* error = nullptr;
+    int input_sample_rate = 0;
+    int output_sample_rate = 0;
+    int32_t round_trip_us = 0;          // OutputData() 写入到 InputData() 读到, 管线实际看到的回环延迟
+    int32_t output_buffer_us = 0;       // 其中 TX DMA 环排队的部分 (写入返回时已写入未播放的音频)
+    int32_t playback_to_capture_us = 0; // 其中 TX DMA 发出到 InputData() 读到 (DAC, 扬声器到麦克风, ADC, RX DMA)
+    bool has_reference = false;
+    int32_t reference_us = 0;           // 参考通道 (codec 内部回采) 上的 TX DMA 发出到读到, 不经过空气
+    int32_t acoustic_us = 0;            // playback_to_capture_us - reference_us, 扬声器、空气与麦克风
+    bool drift_valid = false;
+    float drift_ppm = 0;                // 输入相对输出采样时钟的偏差, 正值表示输入时钟偏快
+    float correlation = 0;              // 麦克风上第一个啁啾的归一化相关峰 (0~1)
+};
+
+/**
+ * 一次回环测试的录音, 由 LoopbackTest 从 codec 采集, 与 codec 无关
+ */
+struct LoopbackCapture {
+    int input_sample_rate = 0;
+    int output_sample_rate = 0;
+    const int16_t* mic = nullptr;
+    const int16_t* reference = nullptr;     // 没有参考通道时为 nullptr
+    size_t samples = 0;
+    double chirp_index = 0;                 // 零延迟时第一个啁啾在录音中的位置 (样本, 由播放时钟换算)
+    int32_t output_buffer_us = 0;
+};
+
+/**
+ * 啁啾的第 index 个样本, 任何采样率下都是同一个连续信号
+ */
+int16_t LoopbackChirpSample(size_t index, int sample_rate);
+
+/**
+ * 整个测试信号的第 index 个样本与总长度
+ */
+int16_t LoopbackSignalSample(size_t index, int sample_rate);
+size_t LoopbackSignalSamples(int sample_rate);
+
+/**
+ * 用互相关在录音中找出两个啁啾, 算出延迟与时钟漂移
+ * @return 失败时 result.error 说明原因
+ */
+bool AnalyzeLoopbackCapture(const LoopbackCapture& capture, LoopbackTestResult& result);
+
+#endif // LOOPBACK_ANALYSIS_H
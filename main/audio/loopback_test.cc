@@ -0,0 +1,120 @@
+#include "loopback_test.h"
+
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+bool LoopbackTest::Prepare(AudioCodec* codec) {
+    input_sample_rate_ = codec->input_sample_rate();
+    output_sample_rate_ = codec->output_sample_rate();
+    has_reference_ = codec->input_reference() && codec->input_channels() >= 2;
+
+    // The capture starts with the output and lasts until the tail and the TX DMA ring have been heard
+    size_t capacity = LoopbackSignalSamples(input_sample_rate_) +
+                      (size_t)input_sample_rate_ * (LOOPBACK_TEST_MAX_LATENCY_MS + 200) / 1000;
+    if (mic_.Resize(capacity) == nullptr) {
+        return false;
+    }
+    if (has_reference_ && reference_.Resize(capacity) == nullptr) {
+        return false;
+    }
+    return true;
+}
+
+void LoopbackTest::Play(AudioCodec* codec) {
+    const int rate = output_sample_rate_;
+    const size_t lead = (size_t)rate * LOOPBACK_TEST_LEAD_MS / 1000;
+    const size_t total = LoopbackSignalSamples(rate);
+    const size_t block_samples = (size_t)rate * LOOPBACK_TEST_BLOCK_MS / 1000;
+
+    std::vector<int16_t> block;
+    uint64_t chirp_position = codec->output_written_frames() + lead;
+    output_started_.store(true, std::memory_order_release);
+    for (size_t offset = 0; offset < total; offset += block_samples) {
+        block.resize(std::min(block_samples, total - offset));
+        for (size_t i = 0; i < block.size(); i++) {
+            block[i] = LoopbackSignalSample(offset + i, rate);
+        }
+        codec->OutputData(block);
+    }
+
+    // The tail is still in the DMA ring, so the clock can tell when the first chirp went out
+    int64_t now = esp_timer_get_time();
+    uint64_t position;
+    if (codec->GetPlaybackPosition(now, position) && position >= chirp_position) {
+        playback_clock_valid_ = true;
+        chirp_play_us_ = now - (int64_t)(position - chirp_position) * 1000000 / rate;
+        output_buffer_us_ = (int64_t)(codec->output_written_frames() - position) * 1000000 / rate;
+    }
+    output_done_us_.store(now, std::memory_order_release);
+}
+
+void LoopbackTest::Capture(AudioCodec* codec) {
+    const int channels = codec->input_channels();
+    const size_t block_frames = (size_t)input_sample_rate_ * LOOPBACK_TEST_BLOCK_MS / 1000;
+    const size_t capacity = mic_.size();
+    std::vector<int16_t> block(block_frames * channels);
+
+    int64_t start_us = esp_timer_get_time();
+    while (captured_ < capacity) {
+        if (!codec->InputData(block)) {
+            break;
+        }
+        int64_t now = esp_timer_get_time();
+        if (!output_started_.load(std::memory_order_acquire)) {
+            if (now - start_us > LOOPBACK_TEST_START_TIMEOUT_MS * 1000) {
+                break;
+            }
+            continue;
+        }
+
+        size_t frames = std::min(block_frames, capacity - captured_);
+        if (channels == 1) {
+            memcpy(mic_.data() + captured_, block.data(), frames * sizeof(int16_t));
+        } else {
+            audio_dsp::ExtractChannel(block.data(), mic_.data() + captured_, frames, channels, 0);
+            if (has_reference_) {
+                audio_dsp::ExtractChannel(block.data(), reference_.data() + captured_, frames, channels, 1);
+            }
+        }
+        captured_ += frames;
+        if (frames == block_frames) {
+            input_zero_us_ = std::min(input_zero_us_, now - (int64_t)captured_ * 1000000 / input_sample_rate_);
+        }
+
+        int64_t done_us = output_done_us_.load(std::memory_order_acquire);
+        if (done_us > 0 && now - done_us >= LOOPBACK_TEST_MAX_LATENCY_MS * 1000 + output_buffer_us_) {
+            break;
+        }
+    }
+}
+
+bool LoopbackTest::Analyze(LoopbackTestResult& result) {
+    result.input_sample_rate = input_sample_rate_;
+    result.output_sample_rate = output_sample_rate_;
+    if (!output_started_.load(std::memory_order_acquire)) {
+        result.error = "output did not start";
+        return false;
+    }
+    if (!playback_clock_valid_) {
+        result.error = "playback clock unavailable";
+        return false;
+    }
+    if (input_zero_us_ == INT64_MAX) {
+        result.error = "no input captured";
+        return false;
+    }
+
+    LoopbackCapture capture;
+    capture.input_sample_rate = input_sample_rate_;
+    capture.output_sample_rate = output_sample_rate_;
+    capture.mic = mic_.data();
+    capture.reference = has_reference_ ? reference_.data() : nullptr;
+    capture.samples = captured_;
+    // Input index the first chirp would have at zero latency
+    capture.chirp_index = (double)(chirp_play_us_ - input_zero_us_) * input_sample_rate_ / 1000000;
+    capture.output_buffer_us = output_buffer_us_;
+    return AnalyzeLoopbackCapture(capture, result);
+}
@@ -0,0 +1,53 @@
+#ifndef LOOPBACK_TEST_H
+#define LOOPBACK_TEST_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_codec.h"
+#include "dsp/audio_dsp.h"
+#include "loopback_analysis.h"
+
+#define LOOPBACK_TEST_BLOCK_MS 10
+#define LOOPBACK_TEST_START_TIMEOUT_MS 3000
+#define LOOPBACK_TEST_TIMEOUT_MS 10000
+
+/**
+ * 声学回环自测: 播放已知的啁啾信号, 同时录音, 用互相关找出它在麦克风 (和参考通道) 上的位置
+ *
+ * 直接使用 codec 的原始采样率, 不经过重采样与音频处理器:
+ * - Play(): 由输出任务调用, 写完整个测试信号, 用播放时钟 (AudioCodec::GetPlaybackPosition())
+ *   换算出第一个啁啾开始播放的时间
+ * - Capture(): 由输入任务调用, 从输出开始录到信号结束后 LOOPBACK_TEST_MAX_LATENCY_MS
+ * - Analyze(): 两者都结束后由调用方执行
+ *   互相关分析在 AnalyzeLoopbackCapture() (loopback_analysis.h) 中, 不依赖 codec, 可以在主机上测试
+ * 每次测试使用一个新对象, 录音缓冲 (PSRAM) 随对象释放.
+ *
+ * 输入样本的时间取各读块 "返回时间 - 块内已读时长" 的最小值作为零点: 读操作只会晚返回, 不会早返回.
+ */
+class LoopbackTest {
+public:
+    // 按 codec 采样率分配录音缓冲, 失败返回 false
+    bool Prepare(AudioCodec* codec);
+    void Play(AudioCodec* codec);
+    void Capture(AudioCodec* codec);
+    bool Analyze(LoopbackTestResult& result);
+
+private:
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    AlignedBuffer<int16_t> mic_{MALLOC_CAP_SPIRAM};
+    AlignedBuffer<int16_t> reference_{MALLOC_CAP_SPIRAM};
+    bool has_reference_ = false;
+    size_t captured_ = 0;
+    int64_t input_zero_us_ = INT64_MAX;     // 输入样本 0 被读到的时间
+
+    std::atomic<bool> output_started_ = false;
+    std::atomic<int64_t> output_done_us_ = 0;
+    bool playback_clock_valid_ = false;
+    int64_t chirp_play_us_ = 0;             // 第一个啁啾的第一个样本被 TX DMA 发出的时间
+    int32_t output_buffer_us_ = 0;
+};
+
+#endif // LOOPBACK_TEST_H
@@ -0,0 +1,131 @@
+#include "opus_rate_controller.h"
+
+#include <algorithm>
+
+void OpusRateController::Configure(const OpusRateBounds& bounds, const OpusEncoderSettings& initial) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bounds_ = bounds;
+    settings_ = initial;
+    settings_.bitrate = std::clamp(settings_.bitrate, bounds.min_bitrate, bounds.max_bitrate);
+    settings_.complexity = std::clamp(settings_.complexity, bounds.min_complexity, bounds.max_complexity);
+    settings_.frame_duration_ms = std::clamp(settings_.frame_duration_ms, bounds.min_frame_duration_ms, bounds.max_frame_duration_ms);
+    settings_.dtx = settings_.dtx && bounds.allow_dtx;
+
+    interval_encode_us_ = 0;
+    interval_audio_ms_ = 0;
+    interval_max_queued_ms_ = 0;
+    clear_intervals_ = 0;
+    pending_failures_ = 0;
+    applied_ceiling_ = bitrate_ceiling_.load(std::memory_order_relaxed);
+    statistics_ = OpusRateStatistics();
+    statistics_.settings = Applied();
+    statistics_.bitrate_ceiling = applied_ceiling_;
+}
+
+void OpusRateController::OnFrameEncoded(int encode_us, int frame_duration_ms, int queued_ms) {
+    interval_encode_us_ += encode_us;
+    interval_audio_ms_ += frame_duration_ms;
+    interval_max_queued_ms_ = std::max(interval_max_queued_ms_, queued_ms);
+}
+
+void OpusRateController::OnSendFailure() {
+    pending_failures_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool OpusRateController::Update(OpusEncoderSettings& settings) {
+    int ceiling = bitrate_ceiling_.load(std::memory_order_relaxed);
+    bool decide = interval_audio_ms_ >= OPUS_RATE_CONTROL_INTERVAL_MS;
+    if (!decide && ceiling == applied_ceiling_) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    OpusEncoderSettings previous = Applied();
+    bool decided = decide && Decide();
+    if (ceiling != applied_ceiling_) {
+        applied_ceiling_ = ceiling;
+        statistics_.bitrate_ceiling = ceiling;
+        if (!decided) {
+            statistics_.last_reason = "bitrate ceiling";
+        }
+    }
+
+    OpusEncoderSettings next = Applied();
+    statistics_.settings = next;
+    bool changed = next.bitrate != previous.bitrate || next.complexity != previous.complexity ||
+                   next.dtx != previous.dtx || next.frame_duration_ms != previous.frame_duration_ms;
+    if (!changed) {
+        return false;
+    }
+    settings = next;
+    return true;
+}
+
+OpusEncoderSettings OpusRateController::Applied() const {
+    OpusEncoderSettings applied = settings_;
+    if (applied_ceiling_ > 0) {
+        applied.bitrate = std::min(applied.bitrate, std::max(applied_ceiling_, bounds_.min_bitrate));
+    }
+    return applied;
+}
+
+bool OpusRateController::Decide() {
+    uint32_t failures = pending_failures_.exchange(0, std::memory_order_relaxed);
+    int load_percent = interval_encode_us_ / (interval_audio_ms_ * 10);
+    int max_queued_ms = interval_max_queued_ms_;
+    interval_encode_us_ = 0;
+    interval_audio_ms_ = 0;
+    interval_max_queued_ms_ = 0;
+
+    statistics_.send_failures += failures;
+    statistics_.load_percent = load_percent;
+    statistics_.max_queued_ms = max_queued_ms;
+
+    OpusEncoderSettings next = settings_;
+    const char* reason = nullptr;
+
+    bool congested = failures > 0 || max_queued_ms >= OPUS_RATE_CONGESTED_QUEUE_MS;
+    // 积压不超过一帧即视为链路跟得上
+    bool clear = failures == 0 && max_queued_ms <= settings_.frame_duration_ms;
+    if (congested) {
+        statistics_.congestion_events++;
+        clear_intervals_ = 0;
+        next.bitrate = std::max(bounds_.min_bitrate, settings_.bitrate * 3 / 4);
+        next.dtx = bounds_.allow_dtx;
+        next.frame_duration_ms = bounds_.max_frame_duration_ms;
+        reason = failures > 0 ? "send failure" : "send queue backlog";
+    } else if (clear && ++clear_intervals_ >= OPUS_RATE_UPGRADE_INTERVALS) {
+        clear_intervals_ = 0;
+        next.bitrate = std::min(bounds_.max_bitrate, settings_.bitrate + OPUS_RATE_BITRATE_STEP);
+        if (next.bitrate >= OPUS_RATE_INITIAL_BITRATE) {
+            next.dtx = false;
+            next.frame_duration_ms = bounds_.min_frame_duration_ms;
+        }
+        reason = "link clear";
+    }
+
+    // 复杂度只看 CPU: 编码跟不上帧时长会反过来造成积压
+    if (load_percent > OPUS_RATE_HIGH_LOAD_PERCENT && next.complexity > bounds_.min_complexity) {
+        next.complexity--;
+        reason = "encoder load";
+    } else if (load_percent < OPUS_RATE_LOW_LOAD_PERCENT && !congested && reason != nullptr &&
+               next.complexity < bounds_.max_complexity) {
+        next.complexity++;
+    }
+
+    bool changed = next.bitrate != settings_.bitrate || next.complexity != settings_.complexity ||
+                   next.dtx != settings_.dtx || next.frame_duration_ms != settings_.frame_duration_ms;
+    if (!changed) {
+        return false;
+    }
+
+    settings_ = next;
+    statistics_.adjustments++;
+    statistics_.last_reason = reason;
+    return true;
+}
+
+OpusRateStatistics OpusRateController::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
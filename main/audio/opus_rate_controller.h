@@ -0,0 +1,127 @@
+#ifndef OPUS_RATE_CONTROLLER_H
+#define OPUS_RATE_CONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// 码率范围 (bps), 16kHz 单声道语音 16kbps 已足够 ASR 使用
+#define OPUS_RATE_MIN_BITRATE 8000
+#define OPUS_RATE_MAX_BITRATE 32000
+#define OPUS_RATE_INITIAL_BITRATE 16000
+#define OPUS_RATE_BITRATE_STEP 2000
+// 复杂度上限, 实际取值还受编码耗时限制
+#define OPUS_RATE_MAX_COMPLEXITY 5
+// 每积累这么多音频做一次决策
+#define OPUS_RATE_CONTROL_INTERVAL_MS 1000
+// 发送队列积压超过该时长视为拥塞
+#define OPUS_RATE_CONGESTED_QUEUE_MS 600
+// 连续多少个无积压的决策周期后提升一档
+#define OPUS_RATE_UPGRADE_INTERVALS 5
+// 编码耗时占帧时长的比例 (百分比): 超过上限降复杂度, 低于下限可以升复杂度
+#define OPUS_RATE_HIGH_LOAD_PERCENT 50
+#define OPUS_RATE_LOW_LOAD_PERCENT 20
+
+/**
+ * 编码参数
+ */
+struct OpusEncoderSettings {
+    int bitrate = OPUS_RATE_INITIAL_BITRATE;
+    int complexity = 0;
+    bool dtx = false;
+    int frame_duration_ms = 60;
+};
+
+/**
+ * 可调范围
+ */
+struct OpusRateBounds {
+    int min_bitrate = OPUS_RATE_MIN_BITRATE;
+    int max_bitrate = OPUS_RATE_MAX_BITRATE;
+    int min_complexity = 0;
+    int max_complexity = OPUS_RATE_MAX_COMPLEXITY;
+    int min_frame_duration_ms = 60;     // 链路良好时使用 (延迟低)
+    int max_frame_duration_ms = 60;     // 拥塞时使用 (包数少, 头部开销小)
+    bool allow_dtx = true;              // 拥塞时是否开启 DTX
+};
+
+/**
+ * 码率控制统计
+ */
+struct OpusRateStatistics {
+    OpusEncoderSettings settings;       // 当前参数 (已受码率上限约束)
+    int bitrate_ceiling = 0;            // 当前的临时码率上限, 0 表示不限
+    uint32_t load_percent = 0;          // 上个周期编码耗时占音频时长的比例
+    uint32_t max_queued_ms = 0;         // 上个周期发送队列最大积压
+    uint32_t adjustments = 0;           // 参数变化次数
+    uint32_t congestion_events = 0;     // 判定为拥塞的周期数
+    uint32_t send_failures = 0;         // 协议层发送失败累计
+    const char* last_reason = "initial";
+};
+
+/**
+ * 上行 Opus 编码参数控制 (AIMD)
+ *
+ * 每个决策周期根据以下信号调整参数:
+ * - 发送失败或发送队列积压: 码率乘性下降 (3/4), 开启 DTX, 切换到最长帧长
+ * - 连续若干周期无积压: 码率加性上升, 恢复到初始码率以上时关闭 DTX, 切回最短帧长
+ * - 编码耗时 (CPU): 过高降复杂度, 较低且链路良好时升复杂度
+ *
+ * SetBitrateCeiling() 设置临时码率上限, 不影响 AIMD 自身的状态, 取消后立即回到原码率.
+ *
+ * OnFrameEncoded()/Update() 只由编码任务调用, OnSendFailure()/SetBitrateCeiling() 可由任意任务调用.
+ * 类本身不依赖 FreeRTOS, 时间由调用方传入.
+ */
+class OpusRateController {
+public:
+    void Configure(const OpusRateBounds& bounds, const OpusEncoderSettings& initial);
+
+    /**
+     * 记录一帧编码
+     * @param encode_us 编码耗时
+     * @param frame_duration_ms 帧时长
+     * @param queued_ms 编码完成时发送队列中积压的音频时长
+     */
+    void OnFrameEncoded(int encode_us, int frame_duration_ms, int queued_ms);
+
+    /**
+     * 协议层发送音频失败
+     */
+    void OnSendFailure();
+
+    /**
+     * 临时码率上限, 0 表示不限, 在下一次 Update() 时生效 (不等决策周期)
+     */
+    void SetBitrateCeiling(int bitrate) { bitrate_ceiling_.store(bitrate, std::memory_order_relaxed); }
+
+    /**
+     * 周期到了时做一次决策
+     * @return 参数是否变化, 变化时 settings 为新参数
+     */
+    bool Update(OpusEncoderSettings& settings);
+
+    OpusRateStatistics GetStatistics() const;
+
+private:
+    // 一个决策周期, 返回 settings_ 是否变化, 调用时持有 mutex_
+    bool Decide();
+    // settings_ 加上码率上限后的实际参数
+    OpusEncoderSettings Applied() const;
+
+    mutable std::mutex mutex_;
+    OpusRateBounds bounds_;
+    OpusEncoderSettings settings_;
+    std::atomic<uint32_t> pending_failures_{0};
+    std::atomic<int> bitrate_ceiling_{0};
+    int applied_ceiling_ = 0;
+
+    // 当前周期
+    int64_t interval_encode_us_ = 0;
+    int interval_audio_ms_ = 0;
+    int interval_max_queued_ms_ = 0;
+    int clear_intervals_ = 0;
+
+    OpusRateStatistics statistics_;
+};
+
+#endif // OPUS_RATE_CONTROLLER_H
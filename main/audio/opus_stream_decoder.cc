@@ -0,0 +1,69 @@
+#include "opus_stream_decoder.h"
+
+#include <esp_log.h>
+
+#define TAG "OpusStreamDecoder"
+
+OpusStreamDecoder::OpusStreamDecoder(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), channels_(channels), duration_ms_(duration_ms) {
+    frame_size_ = sample_rate * duration_ms / 1000;
+
+    int error;
+    decoder_ = opus_decoder_create(sample_rate, channels, &error);
+    if (decoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio decoder, error code: %d", error);
+    }
+}
+
+OpusStreamDecoder::~OpusStreamDecoder() {
+    if (decoder_ != nullptr) {
+        opus_decoder_destroy(decoder_);
+    }
+}
+
+bool OpusStreamDecoder::Decode(const std::vector<uint8_t>& opus, std::vector<int16_t>& pcm) {
+    if (opus.empty()) {
+        return false;
+    }
+    return DecodeInternal(opus.data(), opus.size(), pcm, 0);
+}
+
+bool OpusStreamDecoder::Decode(const uint8_t* data, size_t size, std::vector<int16_t>& pcm) {
+    if (data == nullptr || size == 0) {
+        return false;
+    }
+    return DecodeInternal(data, size, pcm, 0);
+}
+
+bool OpusStreamDecoder::Conceal(std::vector<int16_t>& pcm) {
+    return DecodeInternal(nullptr, 0, pcm, 0);
+}
+
+bool OpusStreamDecoder::DecodeFec(const std::vector<uint8_t>& next_opus, std::vector<int16_t>& pcm) {
+    if (next_opus.empty()) {
+        return Conceal(pcm);
+    }
+    return DecodeInternal(next_opus.data(), next_opus.size(), pcm, 1);
+}
+
+void OpusStreamDecoder::ResetState() {
+    if (decoder_ != nullptr) {
+        opus_decoder_ctl(decoder_, OPUS_RESET_STATE);
+    }
+}
+
+bool OpusStreamDecoder::DecodeInternal(const uint8_t* data, size_t size, std::vector<int16_t>& pcm, int decode_fec) {
+    if (decoder_ == nullptr) {
+        return false;
+    }
+
+    pcm.resize(frame_size_ * channels_);
+    int ret = opus_decode(decoder_, data, size, pcm.data(), frame_size_, decode_fec);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "Failed to decode audio, error code: %d", ret);
+        pcm.clear();
+        return false;
+    }
+    pcm.resize(ret * channels_);
+    return true;
+}
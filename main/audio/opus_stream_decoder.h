@@ -0,0 +1,45 @@
+#ifndef OPUS_STREAM_DECODER_H
+#define OPUS_STREAM_DECODER_H
+
+#include <opus.h>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Opus 解码器 (直接使用 libopus)
+ *
+ * 与 OpusDecoderWrapper 用法相同, 另外提供丢包恢复:
+ * - Conceal(): 没有数据时由解码器内部状态外推一帧 (PLC)
+ * - DecodeFec(): 用下一个包里的带内 FEC 恢复它前面丢失的那一帧,
+ *   包内没有 FEC 数据时 libopus 自动退化为 PLC
+ */
+class OpusStreamDecoder {
+public:
+    OpusStreamDecoder(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusStreamDecoder();
+
+    OpusStreamDecoder(const OpusStreamDecoder&) = delete;
+    OpusStreamDecoder& operator=(const OpusStreamDecoder&) = delete;
+
+    bool Decode(const std::vector<uint8_t>& opus, std::vector<int16_t>& pcm);
+    // 直接解码外部内存中的包 (如映射的提示音资源), 不拷贝
+    bool Decode(const uint8_t* data, size_t size, std::vector<int16_t>& pcm);
+    bool Conceal(std::vector<int16_t>& pcm);
+    bool DecodeFec(const std::vector<uint8_t>& next_opus, std::vector<int16_t>& pcm);
+    void ResetState();
+
+    int sample_rate() const { return sample_rate_; }
+    int duration_ms() const { return duration_ms_; }
+
+private:
+    bool DecodeInternal(const uint8_t* data, size_t size, std::vector<int16_t>& pcm, int decode_fec);
+
+    OpusDecoder* decoder_ = nullptr;
+    int sample_rate_;
+    int channels_;
+    int duration_ms_;
+    int frame_size_;
+};
+
+#endif // OPUS_STREAM_DECODER_H
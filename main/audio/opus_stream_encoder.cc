@@ -0,0 +1,129 @@
+#include "opus_stream_encoder.h"
+
+#include <esp_log.h>
+
+#define TAG "OpusStreamEncoder"
+
+// 单帧输出上限, 60ms@16kHz 远小于此
+#define MAX_OPUS_PACKET_SIZE 1000
+// 缓冲中最多跟踪的输入块, 输入块通常 10ms 以上而缓冲不超过 120ms
+#define OPUS_STREAM_ENCODER_MAX_MARKS 16
+
+OpusStreamEncoder::OpusStreamEncoder(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), channels_(channels), duration_ms_(duration_ms) {
+    frame_size_ = sample_rate * duration_ms / 1000;
+
+    int error;
+    encoder_ = opus_encoder_create(sample_rate, channels, OPUS_APPLICATION_VOIP, &error);
+    if (encoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", error);
+        return;
+    }
+    opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(complexity_));
+    opus_encoder_ctl(encoder_, OPUS_SET_DTX(dtx_ ? 1 : 0));
+
+    // 最多缓冲一帧最长帧长 (60ms) 加一次输入
+    buffer_.reserve(sample_rate * channels * 120 / 1000);
+    marks_.reserve(OPUS_STREAM_ENCODER_MAX_MARKS);
+}
+
+OpusStreamEncoder::~OpusStreamEncoder() {
+    if (encoder_ != nullptr) {
+        opus_encoder_destroy(encoder_);
+    }
+}
+
+void OpusStreamEncoder::Write(const int16_t* pcm, size_t samples, uint32_t timestamp_ms) {
+    // 已消耗的数据移到前面, 保持缓冲区容量不变
+    if (read_pos_ > 0) {
+        buffer_.erase(buffer_.begin(), buffer_.begin() + read_pos_);
+        read_pos_ = 0;
+    }
+    buffer_.insert(buffer_.end(), pcm, pcm + samples);
+
+    // 不再被引用的块: 下一个块已经从未编码数据之前开始
+    size_t stale = 0;
+    while (stale + 1 < marks_.size() && marks_[stale + 1].position <= read_position_) {
+        stale++;
+    }
+    if (stale == 0 && marks_.size() >= OPUS_STREAM_ENCODER_MAX_MARKS) {
+        stale = 1;
+    }
+    marks_.erase(marks_.begin(), marks_.begin() + stale);
+    marks_.push_back({write_position_, timestamp_ms});
+    write_position_ += samples / channels_;
+}
+
+uint32_t OpusStreamEncoder::TimestampAt(uint64_t position) const {
+    for (size_t i = marks_.size(); i > 0; i--) {
+        const auto& mark = marks_[i - 1];
+        if (mark.position <= position) {
+            if (mark.timestamp_ms == 0) {
+                return 0;
+            }
+            return mark.timestamp_ms + (uint32_t)((position - mark.position) * 1000 / sample_rate_);
+        }
+    }
+    return 0;
+}
+
+bool OpusStreamEncoder::Read(std::vector<uint8_t>& opus, uint32_t* timestamp_ms) {
+    size_t frame_samples = frame_size_ * channels_;
+    if (encoder_ == nullptr || buffered_samples() < frame_samples) {
+        return false;
+    }
+
+    if (timestamp_ms != nullptr) {
+        *timestamp_ms = TimestampAt(read_position_);
+    }
+    opus.resize(MAX_OPUS_PACKET_SIZE);
+    int ret = opus_encode(encoder_, buffer_.data() + read_pos_, frame_size_, opus.data(), opus.size());
+    read_pos_ += frame_samples;
+    read_position_ += frame_size_;
+    if (ret < 0) {
+        ESP_LOGE(TAG, "Failed to encode audio, error code: %d", ret);
+        opus.clear();
+        return false;
+    }
+    opus.resize(ret);
+    return true;
+}
+
+void OpusStreamEncoder::SetBitrate(int bitrate) {
+    if (encoder_ != nullptr && opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate)) == OPUS_OK) {
+        bitrate_ = bitrate;
+    }
+}
+
+void OpusStreamEncoder::SetComplexity(int complexity) {
+    if (encoder_ != nullptr && opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(complexity)) == OPUS_OK) {
+        complexity_ = complexity;
+    }
+}
+
+void OpusStreamEncoder::SetDtx(bool enable) {
+    if (encoder_ != nullptr && opus_encoder_ctl(encoder_, OPUS_SET_DTX(enable ? 1 : 0)) == OPUS_OK) {
+        dtx_ = enable;
+    }
+}
+
+bool OpusStreamEncoder::SetDuration(int duration_ms) {
+    if (duration_ms != 10 && duration_ms != 20 && duration_ms != 40 && duration_ms != 60) {
+        ESP_LOGE(TAG, "Unsupported frame duration: %d ms", duration_ms);
+        return false;
+    }
+    // 已缓冲的数据保留, 按新帧长切帧
+    duration_ms_ = duration_ms;
+    frame_size_ = sample_rate_ * duration_ms / 1000;
+    return true;
+}
+
+void OpusStreamEncoder::ResetState() {
+    buffer_.clear();
+    read_pos_ = 0;
+    marks_.clear();
+    read_position_ = write_position_;
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_RESET_STATE);
+    }
+}
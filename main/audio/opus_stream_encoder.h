@@ -0,0 +1,78 @@
+#ifndef OPUS_STREAM_ENCODER_H
+#define OPUS_STREAM_ENCODER_H
+
+#include <opus.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Opus 编码器 (直接使用 libopus)
+ *
+ * 与 OpusEncoderWrapper 的区别:
+ * - 运行中可以调整码率、复杂度、DTX 和帧长, 新参数从下一帧开始生效
+ * - 输入 PCM 先进入内部缓冲, 按当前帧长切帧, 所以输入块大小与帧长无关
+ *   (例如 AudioProcessor 每次输出 60ms, 帧长为 20ms 时一次输入产生三帧)
+ * - 编码结果写入调用方的 vector, 复用其容量, 不分配内存
+ * - 每次输入可带一个时间戳 (第一个样本的, ms), 输出帧的时间戳按其第一个样本所在的输入块加上块内偏移得出
+ */
+class OpusStreamEncoder {
+public:
+    OpusStreamEncoder(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusStreamEncoder();
+
+    OpusStreamEncoder(const OpusStreamEncoder&) = delete;
+    OpusStreamEncoder& operator=(const OpusStreamEncoder&) = delete;
+
+    /**
+     * 追加 PCM 到输入缓冲
+     * @param timestamp_ms 第一个样本的时间戳, 0 表示没有
+     */
+    void Write(const int16_t* pcm, size_t samples, uint32_t timestamp_ms = 0);
+
+    /**
+     * 缓冲中够一帧时编码一帧
+     * @param timestamp_ms 输出这一帧第一个样本的时间戳, 所在输入块没有时间戳时为 0
+     * @return 是否输出了一帧 (false = 数据不足一帧或编码失败)
+     */
+    bool Read(std::vector<uint8_t>& opus, uint32_t* timestamp_ms = nullptr);
+
+    void SetBitrate(int bitrate);       // bps, OPUS_AUTO 为 libopus 自动码率
+    void SetComplexity(int complexity); // 0-10
+    void SetDtx(bool enable);
+    bool SetDuration(int duration_ms);  // 10/20/40/60
+    void ResetState();
+
+    int sample_rate() const { return sample_rate_; }
+    int duration_ms() const { return duration_ms_; }
+    int bitrate() const { return bitrate_; }
+    int complexity() const { return complexity_; }
+    bool dtx() const { return dtx_; }
+    size_t buffered_samples() const { return buffer_.size() - read_pos_; }
+
+private:
+    OpusEncoder* encoder_ = nullptr;
+    int sample_rate_;
+    int channels_;
+    int duration_ms_;
+    int frame_size_;
+    int bitrate_ = OPUS_AUTO;
+    int complexity_ = 0;
+    bool dtx_ = false;
+
+    std::vector<int16_t> buffer_;
+    size_t read_pos_ = 0;
+
+    // 输入块的起始位置 (从创建起的样本帧数) 与时间戳, 按位置递增; 只保留覆盖未编码数据的块
+    struct TimestampMark {
+        uint64_t position;
+        uint32_t timestamp_ms;
+    };
+    std::vector<TimestampMark> marks_;
+    uint64_t write_position_ = 0;
+    uint64_t read_position_ = 0;
+    uint32_t TimestampAt(uint64_t position) const;
+};
+
+#endif // OPUS_STREAM_ENCODER_H
@@ -0,0 +1,125 @@
+#include "playback_buffering.h"
+#include "time_stretcher.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cmath>
+
+#define TAG "PlaybackBuffering"
+
+int PlaybackBuffering::target_frames() const {
+    return fixed_frames_ > 0 ? fixed_frames_ : jitter_buffer_.target_frames();
+}
+
+int PlaybackBuffering::resume_frames() const {
+    return fixed_frames_ > 0 ? fixed_frames_ : jitter_buffer_.resume_frames();
+}
+
+void PlaybackBuffering::StartStream(int64_t now_us) {
+    jitter_buffer_.StartStream(now_us);
+    ESP_LOGI(TAG, "Starting prebuffer, waiting for %d frames (%d ms)", target_frames(),
+             jitter_buffer_.GetStatistics().target_ms);
+    state_ = AudioState::BUFFERING;
+}
+
+bool PlaybackBuffering::EndStream(int64_t now_us) {
+    jitter_buffer_.EndStream();
+    AudioState state = state_.load();
+    if (state != AudioState::BUFFERING && state != AudioState::REBUFFERING) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Audio end received, stop prebuffering (may have insufficient data)");
+    if (state_.compare_exchange_strong(state, AudioState::PLAYING)) {
+        jitter_buffer_.OnPlaybackStarted(now_us);
+    }
+    return true;
+}
+
+void PlaybackBuffering::Reset() {
+    // Entering Speaking right after tts start must keep the new stream buffering
+    state_ = jitter_buffer_.stream_active() ? AudioState::BUFFERING : AudioState::IDLE;
+}
+
+void PlaybackBuffering::OnPacketArrival(int64_t now_us, int frame_duration_ms) {
+    if (jitter_buffer_.stream_active()) {
+        jitter_buffer_.OnPacketArrival(now_us, frame_duration_ms);
+    }
+}
+
+bool PlaybackBuffering::IsOutputReady(int64_t now_us, int buffered_frames, bool frame_ready) {
+    AudioState state = state_.load();
+    if (state == AudioState::BUFFERING) {
+        if (buffered_frames < target_frames()) {
+            return false;
+        }
+        if (state_.compare_exchange_strong(state, AudioState::PLAYING)) {
+            jitter_buffer_.OnPlaybackStarted(now_us);
+            auto stats = jitter_buffer_.GetStatistics();
+            ESP_LOGI(TAG, "Buffering complete: %d frames (target %d, jitter %lu ms), TTFA %lu ms",
+                     buffered_frames, stats.target_frames, (unsigned long)stats.jitter_ms,
+                     (unsigned long)stats.last_time_to_first_audio_ms);
+        }
+    } else if (state == AudioState::REBUFFERING) {
+        if (buffered_frames < resume_frames()) {
+            return false;
+        }
+        if (state_.compare_exchange_strong(state, AudioState::PLAYING)) {
+            jitter_buffer_.OnPlaybackStarted(now_us);
+            ESP_LOGI(TAG, "Rebuffering complete: %d frames, resuming playback", buffered_frames);
+        }
+    }
+
+    if (frame_ready) {
+        return true;
+    }
+    // Check for underrun, otherwise the decoder has yet to fill the playback queue
+    if (buffered_frames == 0) {
+        state = state_.load();
+        if (state == AudioState::PLAYING) {
+            if (!jitter_buffer_.stream_active()) {
+                // The stream has ended and drained, this is not an underrun
+                state_.compare_exchange_strong(state, AudioState::IDLE);
+            } else if (state_.compare_exchange_strong(state, AudioState::REBUFFERING)) {
+                jitter_buffer_.OnUnderrun(now_us);
+                ESP_LOGW(TAG, "Buffer underrun, rebuffering to %d frames", resume_frames());
+            }
+        }
+    }
+    return false;
+}
+
+void PlaybackBuffering::OnFramePlayed() {
+    if (jitter_buffer_.stream_active()) {
+        jitter_buffer_.OnFramePlayed();
+    }
+}
+
+float PlaybackBuffering::UpdateStretchRatio(int buffered_frames, int frame_duration_ms) {
+    if (fixed_frames_ > 0) {
+        return 1.0f;
+    }
+    // Play slower when the buffer runs low and faster when it is overfull, instead of stopping to rebuffer
+    float target = 1.0f;
+    if (state_.load() == AudioState::PLAYING && jitter_buffer_.stream_active()) {
+        int low = jitter_buffer_.target_frames();
+        int high_water = TIME_STRETCH_HIGH_WATER_MS / frame_duration_ms;
+        int high = low + high_water;
+        float range = TIME_STRETCH_MAX_PERCENT / 100.0f;
+        if (buffered_frames < low) {
+            target = 1.0f + range * (low - buffered_frames) / low;
+        } else if (buffered_frames > high) {
+            target = 1.0f - range * std::min(1.0f, float(buffered_frames - high) / high_water);
+        }
+    }
+
+    // Glide at most 1% per frame so the tempo change is not audible
+    float previous = stretch_ratio_;
+    stretch_ratio_ += std::clamp(target - stretch_ratio_, -0.01f, 0.01f);
+    if (target == 1.0f && fabsf(stretch_ratio_ - 1.0f) < 0.01f) {
+        stretch_ratio_ = 1.0f;
+    }
+    if ((previous == 1.0f) != (stretch_ratio_ == 1.0f)) {
+        ESP_LOGI(TAG, "Time stretch %s (buffered %d frames)", stretch_ratio_ == 1.0f ? "off" : "on", buffered_frames);
+    }
+    return stretch_ratio_;
+}
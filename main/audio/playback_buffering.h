@@ -0,0 +1,94 @@
+#ifndef PLAYBACK_BUFFERING_H
+#define PLAYBACK_BUFFERING_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "audio_limits.h"
+#include "jitter_buffer.h"
+
+// Buffered audio above the jitter target before playback speeds up, the speed-up ramps over the same span.
+// Kept high because TTS servers usually send faster than real time, a deep queue alone is not excess latency.
+#define TIME_STRETCH_HIGH_WATER_MS (MAX_DECODE_QUEUE_DURATION_MS / 4)
+
+enum class AudioState {
+    IDLE,           // No audio session
+    BUFFERING,      // Initial buffering
+    PLAYING,        // Playing audio
+    REBUFFERING     // Buffer underrun, waiting for data
+};
+
+/**
+ * 下行播放的缓冲状态机与变速比例
+ *
+ * - StartStream() 进入 BUFFERING, 缓冲到 JitterBuffer 的目标深度后进入 PLAYING
+ * - 播放中队列排空而流还没结束时进入 REBUFFERING, 缓冲到恢复深度后继续播放
+ * - 流结束后不再等待缓冲, 排空后回到 IDLE
+ * - 播放中按缓冲深度给出 TimeStretcher 的比例: 低于目标深度时放慢,
+ *   超出目标 TIME_STRETCH_HIGH_WATER_MS 以上时加快
+ *
+ * 缓冲帧数 (解码队列 + 播放队列) 与时间都由调用方传入, 类本身不依赖 FreeRTOS,
+ * AudioService 与主机上的 trace 回放使用同一份逻辑.
+ * IsOutputReady()/OnFramePlayed() 只由输出任务调用, UpdateStretchRatio()/ResetStretchRatio() 只由解码任务调用,
+ * 其余方法由主任务与网络任务调用, 状态是原子量.
+ */
+class PlaybackBuffering {
+public:
+    /**
+     * 新的 TTS 流开始 (收到 AUDIO_START)
+     */
+    void StartStream(int64_t now_us);
+
+    /**
+     * 流结束 (收到 AUDIO_END), 还在等待缓冲时直接播放剩余数据
+     * @return 是否因此开始了播放 (调用方需要唤醒输出任务)
+     */
+    bool EndStream(int64_t now_us);
+
+    /**
+     * 排队的音频全部被丢弃 (打断或重置解码器), 流还没结束时重新缓冲
+     */
+    void Reset();
+
+    void OnPacketArrival(int64_t now_us, int frame_duration_ms);
+
+    /**
+     * 输出任务取帧之前调用, 推进状态机
+     * @param buffered_frames 解码队列与播放队列中的帧数
+     * @param frame_ready 播放队列中是否有帧可取
+     * @return 是否可以取一帧播放
+     */
+    bool IsOutputReady(int64_t now_us, int buffered_frames, bool frame_ready);
+
+    /**
+     * 播放了一帧下行语音
+     */
+    void OnFramePlayed();
+
+    /**
+     * 下一帧的变速比例, 每帧最多变化 1%, 变化不可闻
+     * @param frame_duration_ms 最近到达的包的帧时长, 用来把高水位换算成帧数
+     */
+    float UpdateStretchRatio(int buffered_frames, int frame_duration_ms);
+    void ResetStretchRatio() { stretch_ratio_ = 1.0f; }
+
+    /**
+     * 固定缓冲深度并关闭变速 (引入 JitterBuffer 之前的行为), 0 恢复自适应. 只用于回放对比
+     */
+    void SetFixedTarget(int frames) { fixed_frames_ = frames; }
+
+    AudioState state() const { return state_.load(); }
+    bool stream_active() const { return jitter_buffer_.stream_active(); }
+    JitterBufferStatistics GetStatistics() const { return jitter_buffer_.GetStatistics(); }
+
+private:
+    int target_frames() const;
+    int resume_frames() const;
+
+    std::atomic<AudioState> state_{AudioState::IDLE};
+    JitterBuffer jitter_buffer_;
+    float stretch_ratio_ = 1.0f;
+    int fixed_frames_ = 0;
+};
+
+#endif // PLAYBACK_BUFFERING_H
@@ -50,6 +50,9 @@ void PlaybackController::OnAudioData(int duration_ms) {
         return;
     }
 
+    if (duration_ms > 0) {
+        frame_duration_ms_ = duration_ms;
+    }
     buffered_ms_ += duration_ms;
 
     if (state_ == BUFFERING) {
@@ -114,7 +117,7 @@ void PlaybackController::OnPlaybackTick() {
     }
 
     int total_frames = queued + buffered;
-    int estimated_ms = total_frames * FRAME_DURATION_MS;
+    int estimated_ms = total_frames * frame_duration_ms_.load();
 
     // 低水位警告
     if (state_ == PLAYING && !audio_end_received_ && estimated_ms < LOW_WATER_MS) {
@@ -160,6 +163,10 @@ int PlaybackController::GetBufferedMs() const {
     return buffered_ms_;
 }
 
+int PlaybackController::GetFrameDurationMs() const {
+    return frame_duration_ms_;
+}
+
 bool PlaybackController::CanStartPlayback() const {
     return state_ == PLAYING || state_ == DRAINING;
 }
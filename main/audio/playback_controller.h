@@ -73,7 +73,7 @@ public:
 
     /**
      * 收到音频数据
-     * @param duration_ms 本帧音频时长
+     * @param duration_ms 本帧音频时长, 同时作为之后帧数与时长换算的帧时长 (随会话协商为 20/40/60ms)
      */
     void OnAudioData(int duration_ms);
 
@@ -103,6 +103,11 @@ public:
      */
     int GetBufferedMs() const;
 
+    /**
+     * 获取当前帧时长 (ms), 还没有收到数据时为默认值
+     */
+    int GetFrameDurationMs() const;
+
     /**
      * 检查是否可以开始播放
      */
@@ -124,12 +129,13 @@ private:
     static const int LOW_WATER_MS = 100;       // 低水位警告 100ms
     static const int COMPLETE_DELAY_MS = 200;  // 播放完成后延迟 200ms
 
-    // 每帧 Opus 音频时长 (默认 60ms)
-    static const int FRAME_DURATION_MS = 60;
+    // 收到第一帧之前假定的 Opus 帧时长
+    static const int DEFAULT_FRAME_DURATION_MS = 60;
 
     State state_ = IDLE;
     Callbacks callbacks_;
     std::atomic<int> buffered_ms_{0};
+    std::atomic<int> frame_duration_ms_{DEFAULT_FRAME_DURATION_MS};
     std::atomic<bool> audio_end_received_{false};
     bool low_water_warned_ = false;
 
@@ -0,0 +1,38 @@
+#include "playback_timeline.h"
+
+void PlaybackTimeline::Configure(int sample_rate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sample_rate_ = sample_rate;
+}
+
+void PlaybackTimeline::OnFrameWritten(uint64_t position, size_t samples, uint32_t timestamp_ms, float scale) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[head_] = { position, static_cast<uint32_t>(samples), timestamp_ms, scale };
+    head_ = (head_ + 1) % PLAYBACK_TIMELINE_ENTRIES;
+    if (count_ < PLAYBACK_TIMELINE_ENTRIES) {
+        count_++;
+    }
+}
+
+uint32_t PlaybackTimeline::TimestampAt(uint64_t position) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Newest first, the position being played is usually a few frames back
+    for (size_t i = 1; i <= count_; i++) {
+        const Entry& entry = entries_[(head_ + PLAYBACK_TIMELINE_ENTRIES - i) % PLAYBACK_TIMELINE_ENTRIES];
+        if (position >= entry.position && position < entry.position + entry.samples) {
+            statistics_.mapped++;
+            return entry.timestamp_ms + static_cast<uint32_t>((position - entry.position) * 1000 / (sample_rate_ * entry.scale));
+        }
+        if (position > entry.position) {
+            // Falls in a gap between speech frames (prompt-only output)
+            break;
+        }
+    }
+    statistics_.unmapped++;
+    return 0;
+}
+
+PlaybackTimelineStatistics PlaybackTimeline::GetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
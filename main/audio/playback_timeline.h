@@ -0,0 +1,59 @@
+#ifndef PLAYBACK_TIMELINE_H
+#define PLAYBACK_TIMELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// 记住最近写入 codec 的多少帧, 需要覆盖 DMA 环与 AFE 的延迟 (60ms 帧约 2 秒)
+#define PLAYBACK_TIMELINE_ENTRIES 32
+
+struct PlaybackTimelineStatistics {
+    uint32_t mapped = 0;        // 上行帧找到了正在播放的下行位置
+    uint32_t unmapped = 0;      // 采集时没有下行音频在播放 (或位置太旧)
+};
+
+/**
+ * 下行播放时间线: codec 样本位置 -> 服务器下发的时间戳 (ms)
+ *
+ * 服务器端 AEC 需要知道每个上行麦克风帧采集时扬声器正在播放哪段下行音频.
+ * 输出任务每写入一帧下行语音就记录它在 codec 中的起始位置 (AudioCodec::output_written_frames());
+ * 上行帧按采集时间从 AudioCodec::GetPlaybackPosition() 得到正在播放的位置, 再在这里换算成下行时间戳,
+ * 精确到帧内的偏移.
+ */
+class PlaybackTimeline {
+public:
+    void Configure(int sample_rate);
+
+    /**
+     * 记录一帧下行语音, 由输出任务在 OutputData() 之前调用
+     * @param position 这一帧第一个样本的位置
+     * @param timestamp_ms 第一个样本的下行时间戳
+     * @param scale 变速后的输出/输入长度比 (TimeStretcher::output_scale()), 帧内偏移按它换算回时间戳
+     */
+    void OnFrameWritten(uint64_t position, size_t samples, uint32_t timestamp_ms, float scale = 1.0f);
+
+    /**
+     * @return position 处样本的下行时间戳, 不在记录中时返回 0
+     */
+    uint32_t TimestampAt(uint64_t position);
+
+    PlaybackTimelineStatistics GetStatistics();
+
+private:
+    struct Entry {
+        uint64_t position;
+        uint32_t samples;
+        uint32_t timestamp_ms;
+        float scale;
+    };
+
+    std::mutex mutex_;
+    int sample_rate_ = 16000;
+    Entry entries_[PLAYBACK_TIMELINE_ENTRIES] = {};
+    size_t head_ = 0;       // 下一个写入的槽位
+    size_t count_ = 0;
+    PlaybackTimelineStatistics statistics_;
+};
+
+#endif // PLAYBACK_TIMELINE_H
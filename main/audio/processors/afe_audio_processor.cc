@@ -70,6 +70,10 @@ void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms) {
     }, "audio_communication", 4096, this, 3, NULL);
 }
 
+void AfeAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    pending_frame_samples_ = frame_duration_ms * 16000 / 1000;
+}
+
 AfeAudioProcessor::~AfeAudioProcessor() {
     if (afe_data_ != nullptr) {
         afe_iface_->destroy(afe_data_);
@@ -127,6 +131,13 @@ void AfeAudioProcessor::AudioProcessorTask() {
         if ((xEventGroupGetBits(event_group_) & PROCESSOR_RUNNING) == 0) {
             continue;
         }
+        int pending_frame_samples = pending_frame_samples_.exchange(0);
+        if (pending_frame_samples > 0 && pending_frame_samples != frame_samples_) {
+            ESP_LOGI(TAG, "Output frame size: %d -> %d samples", frame_samples_, pending_frame_samples);
+            frame_samples_ = pending_frame_samples;
+            output_buffer_.clear();
+            output_buffer_.reserve(frame_samples_);
+        }
         if (res == nullptr || res->ret_value == ESP_FAIL) {
             if (res != nullptr) {
                 ESP_LOGI(TAG, "Error code: %d", res->ret_value);
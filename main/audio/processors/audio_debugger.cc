@@ -1,68 +1,231 @@
 #include "audio_debugger.h"
 #include "sdkconfig.h"
 
-#if CONFIG_USE_AUDIO_DEBUGGER
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <esp_netif.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
+#include <algorithm>
 #include <cstring>
 #include <string>
-#endif
 
 #define TAG "AudioDebugger"
 
+static_assert((AUDIO_DEBUG_RING_SIZE & (AUDIO_DEBUG_RING_SIZE - 1)) == 0, "AUDIO_DEBUG_RING_SIZE must be a power of two");
+
+// 环中每帧的记录头, 后面紧跟 PCM; 记录按 4 字节对齐
+struct RingRecord {
+    uint32_t bytes;
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t reserved;
+    int64_t timestamp_us;
+};
+
+// 环尾放不下整条记录时写入的填充标记, 读端跳到环头
+static constexpr uint32_t kPadRecord = 0xFFFFFFFF;
+
+static inline uint32_t RecordSize(size_t bytes) {
+    return (sizeof(RingRecord) + bytes + 3) & ~3u;
+}
 
 AudioDebugger::AudioDebugger() {
 #if CONFIG_USE_AUDIO_DEBUGGER
-    udp_sockfd_ = socket(AF_INET, SOCK_DGRAM, 0);
-    if (udp_sockfd_ >= 0) {
-        // 解析配置的服务器地址 "IP:PORT"
-        std::string server_addr = CONFIG_AUDIO_DEBUG_UDP_SERVER;
-        size_t colon_pos = server_addr.find(':');
-        
-        if (colon_pos != std::string::npos) {
-            std::string ip = server_addr.substr(0, colon_pos);
-            int port = std::stoi(server_addr.substr(colon_pos + 1));
-            
-            memset(&udp_server_addr_, 0, sizeof(udp_server_addr_));
-            udp_server_addr_.sin_family = AF_INET;
-            udp_server_addr_.sin_port = htons(port);
-            inet_pton(AF_INET, ip.c_str(), &udp_server_addr_.sin_addr);
-            
-            ESP_LOGI(TAG, "Initialized server address: %s", CONFIG_AUDIO_DEBUG_UDP_SERVER);
-        } else {
-            ESP_LOGW(TAG, "Invalid server address: %s, should be IP:PORT", CONFIG_AUDIO_DEBUG_UDP_SERVER);
-            close(udp_sockfd_);
-            udp_sockfd_ = -1;
+    // 解析配置的服务器地址 "IP:PORT"; socket 在网络启动之后由发送任务创建
+    std::string server_addr = CONFIG_AUDIO_DEBUG_UDP_SERVER;
+    size_t colon_pos = server_addr.find(':');
+    if (colon_pos == std::string::npos) {
+        ESP_LOGW(TAG, "Invalid server address: %s, should be IP:PORT", CONFIG_AUDIO_DEBUG_UDP_SERVER);
+        return;
+    }
+    std::string ip = server_addr.substr(0, colon_pos);
+    int port = std::stoi(server_addr.substr(colon_pos + 1));
+
+    memset(&udp_server_addr_, 0, sizeof(udp_server_addr_));
+    udp_server_addr_.sin_family = AF_INET;
+    udp_server_addr_.sin_port = htons(port);
+    inet_pton(AF_INET, ip.c_str(), &udp_server_addr_.sin_addr);
+    ESP_LOGI(TAG, "Initialized server address: %s", CONFIG_AUDIO_DEBUG_UDP_SERVER);
+
+    for (auto& ring : rings_) {
+        ring.buffer = (uint8_t*)heap_caps_malloc(AUDIO_DEBUG_RING_SIZE, MALLOC_CAP_SPIRAM);
+        if (ring.buffer == nullptr) {
+            ESP_LOGW(TAG, "Failed to allocate %d bytes ring buffer", AUDIO_DEBUG_RING_SIZE);
         }
-    } else {
-        ESP_LOGW(TAG, "Failed to create UDP socket: %d", errno);
     }
+
+    xTaskCreate([](void* arg) {
+        auto this_ = (AudioDebugger*)arg;
+        this_->SendTask();
+    }, "audio_debugger", AUDIO_DEBUG_TASK_STACK_SIZE, this, AUDIO_DEBUG_TASK_PRIORITY, &send_task_);
 #endif
 }
 
 AudioDebugger::~AudioDebugger() {
-#if CONFIG_USE_AUDIO_DEBUGGER
+    if (send_task_ != nullptr) {
+        vTaskDelete(send_task_);
+    }
+    for (auto& ring : rings_) {
+        if (ring.buffer != nullptr) {
+            heap_caps_free(ring.buffer);
+        }
+    }
     if (udp_sockfd_ >= 0) {
         close(udp_sockfd_);
         ESP_LOGI(TAG, "Closed UDP socket");
     }
-#endif
 }
 
-void AudioDebugger::Feed(const std::vector<int16_t>& data) {
-#if CONFIG_USE_AUDIO_DEBUGGER
-    if (udp_sockfd_ >= 0) {
-        ssize_t sent = sendto(udp_sockfd_, data.data(), data.size() * sizeof(int16_t), 0,
-                             (struct sockaddr*)&udp_server_addr_, sizeof(udp_server_addr_));
-        if (sent < 0) {
-            ESP_LOGW(TAG, "Failed to send audio data to %s: %d", CONFIG_AUDIO_DEBUG_UDP_SERVER, errno);
-        } else {
-            ESP_LOGD(TAG, "Sent %d bytes audio data to %s", sent, CONFIG_AUDIO_DEBUG_UDP_SERVER);
+void AudioDebugger::Feed(AudioDebugTap tap, const int16_t* data, size_t samples, int sample_rate, int channels) {
+    int16_t* dest = Reserve(tap, samples, sample_rate, channels);
+    if (dest != nullptr) {
+        memcpy(dest, data, samples * sizeof(int16_t));
+        Commit(tap, samples);
+    }
+}
+
+void AudioDebugger::FeedChannel(AudioDebugTap tap, const int16_t* interleaved, size_t frames, int channels,
+                                int channel, int sample_rate) {
+    int16_t* dest = Reserve(tap, frames, sample_rate, 1);
+    if (dest != nullptr) {
+        for (size_t i = 0; i < frames; i++) {
+            dest[i] = interleaved[i * channels + channel];
         }
+        Commit(tap, frames);
     }
-#endif
 }
 
- 
\ No newline at end of file
+int16_t* AudioDebugger::Reserve(AudioDebugTap tap, size_t samples, int sample_rate, int channels) {
+    auto& ring = rings_[tap];
+    if (ring.buffer == nullptr || samples == 0 || !ready_.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+
+    size_t bytes = samples * sizeof(int16_t);
+    uint32_t need = RecordSize(bytes);
+    uint32_t write = ring.write.load(std::memory_order_relaxed);
+    uint32_t read = ring.read.load(std::memory_order_acquire);
+    uint32_t offset = write & (AUDIO_DEBUG_RING_SIZE - 1);
+    uint32_t contiguous = AUDIO_DEBUG_RING_SIZE - offset;
+    uint32_t total = contiguous < need ? contiguous + need : need;
+    if (need > AUDIO_DEBUG_RING_SIZE / 2 || AUDIO_DEBUG_RING_SIZE - (write - read) < total) {
+        ring.dropped_frames.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    if (contiguous < need) {
+        memcpy(ring.buffer + offset, &kPadRecord, sizeof(kPadRecord));
+        offset = 0;
+    }
+    RingRecord record = {};
+    record.bytes = bytes;
+    record.sample_rate = sample_rate;
+    record.channels = channels;
+    record.timestamp_us = esp_timer_get_time();
+    memcpy(ring.buffer + offset, &record, sizeof(record));
+    return (int16_t*)(ring.buffer + offset + sizeof(RingRecord));
+}
+
+void AudioDebugger::Commit(AudioDebugTap tap, size_t samples) {
+    auto& ring = rings_[tap];
+    uint32_t need = RecordSize(samples * sizeof(int16_t));
+    uint32_t write = ring.write.load(std::memory_order_relaxed);
+    uint32_t contiguous = AUDIO_DEBUG_RING_SIZE - (write & (AUDIO_DEBUG_RING_SIZE - 1));
+    if (contiguous < need) {
+        write += contiguous;
+    }
+    ring.frames.fetch_add(1, std::memory_order_relaxed);
+    ring.write.store(write + need, std::memory_order_release);
+}
+
+bool AudioDebugger::OpenSocket() {
+    // lwIP 在网络启动 (Board::StartNetwork) 之前还未初始化, 那时调用 socket() 会断言失败
+    esp_netif_t* netif = esp_netif_get_default_netif();
+    if (netif == nullptr || !esp_netif_is_netif_up(netif)) {
+        return false;
+    }
+    udp_sockfd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_sockfd_ < 0) {
+        ESP_LOGW(TAG, "Failed to create UDP socket: %d", errno);
+        return false;
+    }
+    ESP_LOGI(TAG, "Sending to %s", CONFIG_AUDIO_DEBUG_UDP_SERVER);
+    return true;
+}
+
+void AudioDebugger::SendTask() {
+    while (!OpenSocket()) {
+        vTaskDelay(pdMS_TO_TICKS(AUDIO_DEBUG_NETWORK_POLL_MS));
+    }
+    ready_.store(true, std::memory_order_release);
+
+    while (true) {
+        for (int i = 0; i < kAudioDebugTapCount; i++) {
+            Drain((AudioDebugTap)i);
+        }
+        vTaskDelay(pdMS_TO_TICKS(AUDIO_DEBUG_SEND_INTERVAL_MS));
+    }
+}
+
+void AudioDebugger::Drain(AudioDebugTap tap) {
+    auto& ring = rings_[tap];
+    if (ring.buffer == nullptr) {
+        return;
+    }
+
+    uint32_t read = ring.read.load(std::memory_order_relaxed);
+    uint32_t write = ring.write.load(std::memory_order_acquire);
+    while (read != write) {
+        uint32_t offset = read & (AUDIO_DEBUG_RING_SIZE - 1);
+        RingRecord record;
+        memcpy(&record.bytes, ring.buffer + offset, sizeof(record.bytes));
+        if (record.bytes == kPadRecord) {
+            read += AUDIO_DEBUG_RING_SIZE - offset;
+            continue;
+        }
+        memcpy(&record, ring.buffer + offset, sizeof(record));
+
+        // 大帧拆成多个 UDP 包, 每包按整帧 (所有声道) 切分
+        const uint8_t* pcm = ring.buffer + offset + sizeof(RingRecord);
+        size_t frame_bytes = record.channels * sizeof(int16_t);
+        size_t max_chunk = AUDIO_DEBUG_MAX_PAYLOAD / frame_bytes * frame_bytes;
+        for (size_t sent = 0; sent < record.bytes; ) {
+            size_t chunk = std::min<size_t>(max_chunk, record.bytes - sent);
+            AudioDebugPacketHeader header = {};
+            header.magic = AUDIO_DEBUG_MAGIC;
+            header.version = AUDIO_DEBUG_VERSION;
+            header.tap = tap;
+            header.channels = record.channels;
+            header.sample_rate = record.sample_rate;
+            header.sequence = ring.sequence++;
+            header.timestamp_us = record.timestamp_us + (int64_t)(sent / frame_bytes) * 1000000 / record.sample_rate;
+            memcpy(packet_, &header, sizeof(header));
+            memcpy(packet_ + sizeof(header), pcm + sent, chunk);
+            if (sendto(udp_sockfd_, packet_, sizeof(header) + chunk, 0,
+                       (struct sockaddr*)&udp_server_addr_, sizeof(udp_server_addr_)) < 0) {
+                send_failures_.fetch_add(1, std::memory_order_relaxed);
+                ESP_LOGD(TAG, "Failed to send audio data: %d", errno);
+            } else {
+                sent_packets_.fetch_add(1, std::memory_order_relaxed);
+            }
+            sent += chunk;
+        }
+
+        read += RecordSize(record.bytes);
+        ring.read.store(read, std::memory_order_release);
+    }
+}
+
+AudioDebugStatistics AudioDebugger::GetStatistics() const {
+    AudioDebugStatistics stats;
+    for (int i = 0; i < kAudioDebugTapCount; i++) {
+        stats.frames[i] = rings_[i].frames.load(std::memory_order_relaxed);
+        stats.dropped_frames[i] = rings_[i].dropped_frames.load(std::memory_order_relaxed);
+    }
+    stats.sent_packets = sent_packets_.load(std::memory_order_relaxed);
+    stats.send_failures = send_failures_.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -2,29 +2,121 @@
  * @file audio_debugger.h
  * @brief PSM-ESP32-MED-001: MED-D001 音频调试器
  * @trace PIM-MED-001 媒体域需求规格 - 调试支持组件
- * @version 1.0.0
+ * @version 1.1.0
  * @date 2025-12-27
  */
 
 #ifndef AUDIO_DEBUGGER_H
 #define AUDIO_DEBUGGER_H
 
-#include <vector>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
 
+// 每个抓取点一个环形缓冲 (PSRAM), 必须是 2 的幂; 16kHz 单声道约 1 秒
+#define AUDIO_DEBUG_RING_SIZE (32 * 1024)
+// 发送任务: 优先级低于所有音频任务, 定时轮询, 音频路径不做任何唤醒
+#define AUDIO_DEBUG_TASK_STACK_SIZE 4096
+#define AUDIO_DEBUG_TASK_PRIORITY 1
+#define AUDIO_DEBUG_SEND_INTERVAL_MS 20
+// 网络启动前发送任务按此间隔检查, 期间 Feed() 直接返回
+#define AUDIO_DEBUG_NETWORK_POLL_MS 1000
+// 每个 UDP 包的最大 PCM 字节数, 避免 IP 分片
+#define AUDIO_DEBUG_MAX_PAYLOAD 1400
+
+#define AUDIO_DEBUG_MAGIC 0x47424441    // "ADBG"
+#define AUDIO_DEBUG_VERSION 1
+
+/**
+ * 抓取点, 编号即 UDP 包头中的 tap 字段 (与 scripts/audio_debug_server.py 保持一致)
+ */
+enum AudioDebugTap {
+    kAudioDebugTapMic = 0,          // 麦克风原始输入 (重采样到 16kHz 之后)
+    kAudioDebugTapReference,        // AEC 参考信号
+    kAudioDebugTapProcessed,        // 音频处理器 (AFE) 输出, 即送去编码的 PCM
+    kAudioDebugTapDecoded,          // Opus 解码后的 TTS (解码器采样率)
+    kAudioDebugTapOutput,           // 混音后写入 codec 的 PCM
+    kAudioDebugTapCount,
+};
+
+/**
+ * UDP 包头, 小端, 后面紧跟 int16 PCM (多声道交织)
+ */
+struct __attribute__((packed)) AudioDebugPacketHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t tap;
+    uint8_t channels;
+    uint8_t reserved;
+    uint32_t sample_rate;
+    uint32_t sequence;          // 每个抓取点独立递增, 跳号表示网络丢包
+    int64_t timestamp_us;       // Feed() 时的 esp_timer 时间 (拆包时按采样数顺延), 间断表示环满丢帧
+};
+
+struct AudioDebugStatistics {
+    uint32_t frames[kAudioDebugTapCount] = {};
+    uint32_t dropped_frames[kAudioDebugTapCount] = {};     // 环满丢弃
+    uint32_t sent_packets = 0;
+    uint32_t send_failures = 0;
+};
+
+/**
+ * 音频调试器: 把多个抓取点的 PCM 通过 UDP 发给 scripts/audio_debug_server.py
+ *
+ * Feed() 在音频路径中调用, 只把帧拷贝进该抓取点的无锁环形缓冲, 从不阻塞;
+ * 环满时丢弃整帧并计数. 后台任务定时取出并发送, 网络慢不会影响音频任务的时序.
+ * 每个抓取点只能由一个任务写入 (单生产者), 发送任务是唯一的消费者.
+ * 可以在网络启动前构造: 发送任务等网络就绪后才创建 socket, 在此之前 Feed() 不做任何事.
+ */
 class AudioDebugger {
 public:
     AudioDebugger();
     ~AudioDebugger();
 
-    void Feed(const std::vector<int16_t>& data);
+    /**
+     * 写入一帧 PCM
+     * @param samples 采样总数 (多声道时为帧数 * 声道数)
+     */
+    void Feed(AudioDebugTap tap, const int16_t* data, size_t samples, int sample_rate, int channels = 1);
+
+    /**
+     * 从交织的多声道 PCM 中取出一个声道写入
+     */
+    void FeedChannel(AudioDebugTap tap, const int16_t* interleaved, size_t frames, int channels, int channel,
+                     int sample_rate);
+
+    AudioDebugStatistics GetStatistics() const;
 
 private:
+    struct Ring {
+        uint8_t* buffer = nullptr;
+        std::atomic<uint32_t> write{0};     // 只由生产者推进
+        std::atomic<uint32_t> read{0};      // 只由发送任务推进
+        uint32_t sequence = 0;
+        std::atomic<uint32_t> frames{0};
+        std::atomic<uint32_t> dropped_frames{0};
+    };
+
+    int16_t* Reserve(AudioDebugTap tap, size_t samples, int sample_rate, int channels);
+    void Commit(AudioDebugTap tap, size_t samples);
+    bool OpenSocket();
+    void SendTask();
+    void Drain(AudioDebugTap tap);
+
     int udp_sockfd_ = -1;
+    std::atomic<bool> ready_{false};    // 发送任务创建 socket 之后置位
     struct sockaddr_in udp_server_addr_;
+    Ring rings_[kAudioDebugTapCount];
+    TaskHandle_t send_task_ = nullptr;
+    uint8_t packet_[sizeof(AudioDebugPacketHeader) + AUDIO_DEBUG_MAX_PAYLOAD];
+    std::atomic<uint32_t> sent_packets_{0};
+    std::atomic<uint32_t> send_failures_{0};
 };
 
-#endif 
\ No newline at end of file
+#endif
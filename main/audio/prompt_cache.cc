@@ -0,0 +1,136 @@
+#include "prompt_cache.h"
+#include "prompt_player.h"
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+
+#include <algorithm>
+#include <cstring>
+
+#define TAG "PromptCache"
+
+PromptPcm::PromptPcm(size_t capacity) {
+    samples_ = static_cast<int16_t*>(heap_caps_malloc(capacity * sizeof(int16_t), MALLOC_CAP_SPIRAM));
+    capacity_ = samples_ != nullptr ? capacity : 0;
+}
+
+PromptPcm::~PromptPcm() {
+    if (samples_ != nullptr) {
+        heap_caps_free(samples_);
+    }
+}
+
+bool PromptPcm::Append(const int16_t* samples, size_t count) {
+    if (size_ + count > capacity_) {
+        return false;
+    }
+    memcpy(samples_ + size_, samples, count * sizeof(int16_t));
+    size_ += count;
+    return true;
+}
+
+void PromptCache::Configure(int sample_rate, size_t budget_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) == 0) {
+        budget_bytes = 0;
+    }
+    if (sample_rate != sample_rate_) {
+        entries_.clear();
+        bytes_ = 0;
+    }
+    sample_rate_ = sample_rate;
+    budget_bytes_ = budget_bytes;
+    statistics_.budget_bytes = budget_bytes;
+}
+
+size_t PromptCache::Find(std::string_view sound) const {
+    for (size_t i = 0; i < entries_.size(); i++) {
+        if (entries_[i].data == sound.data() && entries_[i].size == sound.size()) {
+            return i;
+        }
+    }
+    return entries_.size();
+}
+
+PromptPcmPtr PromptCache::Lookup(std::string_view sound) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t index = Find(sound);
+    if (index == entries_.size()) {
+        statistics_.misses++;
+        return nullptr;
+    }
+    statistics_.hits++;
+    entries_[index].last_used = ++use_counter_;
+    return entries_[index].pcm;
+}
+
+bool PromptCache::Contains(std::string_view sound) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return Find(sound) != entries_.size();
+}
+
+std::shared_ptr<PromptPcm> PromptCache::CreateEntry(std::string_view sound) const {
+    int sample_rate;
+    size_t budget_bytes;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sample_rate = sample_rate_;
+        budget_bytes = budget_bytes_;
+    }
+    if (budget_bytes == 0 || sample_rate == 0) {
+        return nullptr;
+    }
+
+    size_t duration_ms = PromptPlayer::CountFrames(sound) * PROMPT_FRAME_DURATION_MS;
+    if (duration_ms == 0 || duration_ms > PROMPT_CACHE_MAX_PROMPT_MS) {
+        return nullptr;
+    }
+    // 重采样器每帧的输出可能比按比例计算的多出几个样本, 预留一块余量
+    size_t capacity = (duration_ms + PROMPT_CACHE_CHUNK_MS) * sample_rate / 1000;
+    if (capacity * sizeof(int16_t) > budget_bytes) {
+        return nullptr;
+    }
+    auto pcm = std::make_shared<PromptPcm>(capacity);
+    if (!pcm->valid()) {
+        ESP_LOGW(TAG, "Failed to allocate %u bytes for prompt", capacity * sizeof(int16_t));
+        return nullptr;
+    }
+    return pcm;
+}
+
+void PromptCache::Insert(std::string_view sound, std::shared_ptr<PromptPcm> pcm) {
+    if (pcm == nullptr || pcm->size() == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (Find(sound) != entries_.size() || pcm->bytes() > budget_bytes_) {
+        return;
+    }
+
+    // 淘汰最久未使用的条目直到放得下
+    while (bytes_ + pcm->bytes() > budget_bytes_ && !entries_.empty()) {
+        auto oldest = std::min_element(entries_.begin(), entries_.end(),
+            [](const Entry& a, const Entry& b) { return a.last_used < b.last_used; });
+        bytes_ -= oldest->pcm->bytes();
+        entries_.erase(oldest);
+        statistics_.evictions++;
+    }
+
+    bytes_ += pcm->bytes();
+    entries_.push_back(Entry{sound.data(), sound.size(), std::move(pcm), ++use_counter_});
+    statistics_.insertions++;
+}
+
+void PromptCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    bytes_ = 0;
+}
+
+PromptCacheStatistics PromptCache::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PromptCacheStatistics statistics = statistics_;
+    statistics.entries = entries_.size();
+    statistics.bytes = bytes_;
+    return statistics;
+}
@@ -0,0 +1,118 @@
+#ifndef PROMPT_CACHE_H
+#define PROMPT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// PSRAM 预算 (字节), 没有 PSRAM 的芯片不缓存
+#define PROMPT_CACHE_BUDGET_BYTES (384 * 1024)
+// 只缓存短提示音, 长提示音仍然流式解码
+#define PROMPT_CACHE_MAX_PROMPT_MS 3000
+// 命中时每个播放任务的时长, 与一个 DMA 周期相当, 第一块写入后即开始出声
+#define PROMPT_CACHE_CHUNK_MS 20
+
+/**
+ * 解码后的提示音 PCM (单声道, 输出采样率), 存放在 PSRAM
+ */
+class PromptPcm {
+public:
+    explicit PromptPcm(size_t capacity);
+    ~PromptPcm();
+
+    PromptPcm(const PromptPcm&) = delete;
+    PromptPcm& operator=(const PromptPcm&) = delete;
+
+    bool valid() const { return samples_ != nullptr; }
+    const int16_t* samples() const { return samples_; }
+    size_t size() const { return size_; }
+    size_t bytes() const { return capacity_ * sizeof(int16_t); }
+
+    /**
+     * 追加样本, 超出容量返回 false
+     */
+    bool Append(const int16_t* samples, size_t count);
+
+private:
+    int16_t* samples_ = nullptr;
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+};
+
+using PromptPcmPtr = std::shared_ptr<const PromptPcm>;
+
+struct PromptCacheStatistics {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t insertions = 0;
+    uint32_t evictions = 0;
+    uint32_t entries = 0;
+    size_t bytes = 0;
+    size_t budget_bytes = 0;
+};
+
+/**
+ * 提示音 PCM 缓存 (LRU)
+ *
+ * - 以资源地址和长度为键 (嵌入的 p3 资源地址固定)
+ * - 缓存的是输出采样率的 PCM, 命中时跳过 Opus 解码和重采样, 直接按块送入播放队列
+ * - 总大小超过预算时淘汰最久未使用的条目; 条目以 shared_ptr 持有,
+ *   正在播放的条目被淘汰时等播放结束才释放
+ * - 输出采样率变化时 (Configure) 清空
+ *
+ * 可以被多个任务同时调用.
+ */
+class PromptCache {
+public:
+    /**
+     * @param sample_rate 输出采样率
+     * @param budget_bytes 预算, 0 表示不缓存
+     */
+    void Configure(int sample_rate, size_t budget_bytes);
+
+    int sample_rate() const { std::lock_guard<std::mutex> lock(mutex_); return sample_rate_; }
+
+    /**
+     * 查找并更新使用顺序, 计入命中/未命中
+     */
+    PromptPcmPtr Lookup(std::string_view sound);
+
+    bool Contains(std::string_view sound) const;
+
+    /**
+     * 为一个提示音分配待填充的 PCM, 不可缓存 (过长、超预算或没有 PSRAM) 时返回 nullptr
+     */
+    std::shared_ptr<PromptPcm> CreateEntry(std::string_view sound) const;
+
+    /**
+     * 加入缓存, 必要时淘汰旧条目
+     */
+    void Insert(std::string_view sound, std::shared_ptr<PromptPcm> pcm);
+
+    void Clear();
+
+    PromptCacheStatistics GetStatistics() const;
+
+private:
+    struct Entry {
+        const char* data;
+        size_t size;
+        PromptPcmPtr pcm;
+        uint32_t last_used;
+    };
+
+    size_t Find(std::string_view sound) const;
+
+    mutable std::mutex mutex_;
+    int sample_rate_ = 0;
+    size_t budget_bytes_ = 0;
+    size_t bytes_ = 0;
+    uint32_t use_counter_ = 0;
+    std::vector<Entry> entries_;
+    PromptCacheStatistics statistics_;
+};
+
+#endif // PROMPT_CACHE_H
@@ -0,0 +1,191 @@
+#include "prompt_player.h"
+
+#include <esp_log.h>
+
+#include <vector>
+
+#define TAG "PromptPlayer"
+
+// BinaryProtocol3 帧头: type(1) reserved(1) payload_size(2, 网络字节序)
+static constexpr size_t kFrameHeaderSize = 4;
+
+// 返回 offset 处完整帧的负载长度, 不完整时返回 0
+static size_t FramePayloadSize(std::string_view sound, size_t offset) {
+    if (offset + kFrameHeaderSize > sound.size()) {
+        return 0;
+    }
+    auto header = reinterpret_cast<const uint8_t*>(sound.data() + offset);
+    size_t payload_size = (header[2] << 8) | header[3];
+    if (payload_size == 0 || offset + kFrameHeaderSize + payload_size > sound.size()) {
+        return 0;
+    }
+    return payload_size;
+}
+
+uint32_t PromptPlayer::Enqueue(std::string_view sound, Callback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (FramePayloadSize(sound, 0) == 0 || requests_.size() >= PROMPT_QUEUE_SIZE) {
+        ESP_LOGW(TAG, "Rejecting prompt (%u bytes, %u queued)", sound.size(), requests_.size());
+        statistics_.rejected++;
+        return 0;
+    }
+
+    uint32_t id = next_id_++;
+    if (next_id_ == 0) {
+        next_id_ = 1;
+    }
+    requests_.push_back(Request{id, sound, 0, false, std::move(callback)});
+    statistics_.queued++;
+    unread_.fetch_add(1, std::memory_order_release);
+    return id;
+}
+
+bool PromptPlayer::Cancel(uint32_t id) {
+    Callback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = requests_.begin();
+        while (it != requests_.end() && it->id != id) {
+            ++it;
+        }
+        if (it == requests_.end()) {
+            return false;
+        }
+        if (!it->read_done) {
+            unread_.fetch_sub(1, std::memory_order_release);
+        }
+        callback = std::move(it->callback);
+        requests_.erase(it);
+        statistics_.cancelled++;
+    }
+    if (callback) {
+        callback(false);
+    }
+    return true;
+}
+
+void PromptPlayer::CancelAll() {
+    std::vector<Callback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (requests_.empty()) {
+            return;
+        }
+        for (auto& request : requests_) {
+            if (request.callback) {
+                callbacks.push_back(std::move(request.callback));
+            }
+        }
+        statistics_.cancelled += requests_.size();
+        requests_.clear();
+        unread_.store(0, std::memory_order_release);
+    }
+    for (auto& callback : callbacks) {
+        callback(false);
+    }
+}
+
+bool PromptPlayer::IsIdle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_.empty();
+}
+
+bool PromptPlayer::NextFrame(PromptFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& request : requests_) {
+        if (request.read_done) {
+            continue;
+        }
+        // Enqueue() 与上一次读取都保证了当前位置是一个完整帧
+        size_t payload_size = FramePayloadSize(request.sound, request.offset);
+        frame.id = request.id;
+        frame.sound = request.sound;
+        frame.first = request.offset == 0;
+        frame.data = reinterpret_cast<const uint8_t*>(request.sound.data() + request.offset + kFrameHeaderSize);
+        frame.size = payload_size;
+        request.offset += kFrameHeaderSize + payload_size;
+        // 末尾不完整的帧直接忽略, 所以最后一帧总能被标记出来
+        frame.last = FramePayloadSize(request.sound, request.offset) == 0;
+        if (frame.last) {
+            FinishRead(request);
+        }
+        statistics_.frames++;
+        return true;
+    }
+    return false;
+}
+
+void PromptPlayer::SkipRest(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& request : requests_) {
+        if (request.id == id && !request.read_done) {
+            FinishRead(request);
+            return;
+        }
+    }
+}
+
+void PromptPlayer::FinishRead(Request& request) {
+    request.read_done = true;
+    unread_.fetch_sub(1, std::memory_order_release);
+}
+
+bool PromptPlayer::IsActive(uint32_t id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& request : requests_) {
+        if (request.id == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PromptPlayer::OnFramePlayed(uint32_t id, bool last) {
+    if (!last) {
+        return;
+    }
+    Callback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = requests_.begin();
+        while (it != requests_.end() && it->id != id) {
+            ++it;
+        }
+        if (it == requests_.end()) {
+            // 已被取消
+            return;
+        }
+        callback = std::move(it->callback);
+        requests_.erase(it);
+        statistics_.completed++;
+    }
+    if (callback) {
+        callback(true);
+    }
+}
+
+size_t PromptPlayer::CountFrames(std::string_view sound) {
+    size_t frames = 0;
+    size_t offset = 0;
+    const uint8_t* data;
+    size_t size;
+    while (ReadFrame(sound, offset, data, size)) {
+        frames++;
+    }
+    return frames;
+}
+
+bool PromptPlayer::ReadFrame(std::string_view sound, size_t& offset, const uint8_t*& data, size_t& size) {
+    size = FramePayloadSize(sound, offset);
+    if (size == 0) {
+        return false;
+    }
+    data = reinterpret_cast<const uint8_t*>(sound.data() + offset + kFrameHeaderSize);
+    offset += kFrameHeaderSize + size;
+    return true;
+}
+
+PromptStatistics PromptPlayer::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
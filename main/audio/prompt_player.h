@@ -0,0 +1,131 @@
+#ifndef PROMPT_PLAYER_H
+#define PROMPT_PLAYER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string_view>
+
+// 排队中 (含正在播放) 的提示音上限, 超出时 Enqueue() 失败
+#define PROMPT_QUEUE_SIZE 16
+// p3 资源的编码参数
+#define PROMPT_SAMPLE_RATE 16000
+#define PROMPT_FRAME_DURATION_MS 60
+
+/**
+ * 提示音中的一帧, data 直接指向映射的资源, 不拷贝
+ */
+struct PromptFrame {
+    uint32_t id = 0;
+    std::string_view sound;     // 整个资源, 用于查找 PCM 缓存
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    bool first = false;     // 该提示音的第一帧
+    bool last = false;      // 该提示音的最后一帧
+};
+
+struct PromptStatistics {
+    uint32_t queued = 0;
+    uint32_t completed = 0;
+    uint32_t cancelled = 0;
+    uint32_t rejected = 0;      // 队列已满或资源为空
+    uint32_t frames = 0;        // 已读出的帧数
+};
+
+/**
+ * p3 提示音流式播放队列
+ *
+ * p3 资源 (BinaryProtocol3 帧序列) 嵌入在固件中, 通过 flash 映射直接访问.
+ * 播放时不再把每帧拷贝进 AudioStreamPacket, 而是由解码任务按帧读取映射地址直接解码:
+ * - Enqueue(): 任意任务调用, 立即返回提示音 id, 不等待播放
+ * - NextFrame(): 解码任务逐帧读取, 按入队顺序
+ * - OnFramePlayed(): 播放任务输出一帧后调用, 最后一帧播放完时触发完成回调
+ * - Cancel()/CancelAll(): 从队列中移除, 已解码但未播放的帧由播放任务通过 IsActive() 丢弃
+ *
+ * 回调参数表示是否完整播放. 完成回调在播放任务中执行, 取消回调在调用 Cancel 的任务中执行,
+ * 回调内不要阻塞, 也不要再调用本类的接口.
+ *
+ * 资源必须在播放期间保持有效 (嵌入的 Lang::Sounds 始终有效).
+ */
+class PromptPlayer {
+public:
+    using Callback = std::function<void(bool completed)>;
+
+    /**
+     * 加入播放队列
+     * @return 提示音 id, 失败时为 0
+     */
+    uint32_t Enqueue(std::string_view sound, Callback callback = nullptr);
+
+    /**
+     * 取消一个提示音 (排队中或播放中)
+     * @return id 是否存在
+     */
+    bool Cancel(uint32_t id);
+    void CancelAll();
+
+    /**
+     * 是否还有帧未读出, 解码任务据此决定是否等待
+     */
+    bool HasFrames() const { return unread_.load(std::memory_order_acquire) > 0; }
+
+    /**
+     * 没有排队或尚未播放完的提示音
+     */
+    bool IsIdle() const;
+
+    /**
+     * 读取下一帧 (解码任务)
+     * @return 没有可读的帧时返回 false
+     */
+    bool NextFrame(PromptFrame& frame);
+
+    /**
+     * 不再读取该提示音剩余的帧 (解码任务改用缓存的 PCM 播放时调用)
+     */
+    void SkipRest(uint32_t id);
+
+    /**
+     * 提示音是否仍在队列中 (未被取消), 播放任务用来丢弃已取消提示音的帧
+     */
+    bool IsActive(uint32_t id) const;
+
+    /**
+     * 一帧已输出 (播放任务); 最后一帧解码失败时由解码任务调用
+     */
+    void OnFramePlayed(uint32_t id, bool last);
+
+    PromptStatistics GetStatistics() const;
+
+    /**
+     * 资源中完整帧的数量 (每帧 PROMPT_FRAME_DURATION_MS)
+     */
+    static size_t CountFrames(std::string_view sound);
+
+    /**
+     * 从 offset 处读一帧并前移 offset, 没有完整帧时返回 false
+     */
+    static bool ReadFrame(std::string_view sound, size_t& offset, const uint8_t*& data, size_t& size);
+
+private:
+    struct Request {
+        uint32_t id;
+        std::string_view sound;
+        size_t offset;
+        bool read_done;
+        Callback callback;
+    };
+
+    void FinishRead(Request& request);
+
+    mutable std::mutex mutex_;
+    std::deque<Request> requests_;
+    std::atomic<uint32_t> unread_{0};   // read_done 为 false 的请求数
+    uint32_t next_id_ = 1;
+    PromptStatistics statistics_;
+};
+
+#endif // PROMPT_PLAYER_H
@@ -0,0 +1,145 @@
+#include "time_stretcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+void TimeStretcher::Configure(int sample_rate) {
+    hop_ = sample_rate * TIME_STRETCH_HOP_MS / 1000;
+    tolerance_ = sample_rate * TIME_STRETCH_TOLERANCE_MS / 1000;
+
+    fade_in_.resize(hop_);
+    for (int i = 0; i < hop_; i++) {
+        float w = 0.5f - 0.5f * cosf(M_PI * (i + 0.5f) / hop_);
+        fade_in_[i] = static_cast<int16_t>(w * 32767.0f);
+    }
+    overlap_.reserve(hop_);
+    // 保留的搜索区间 (Trim() 之后最多约 8 个步长加两倍搜索范围) 加一帧输入
+    size_t capacity = hop_ * 8 + tolerance_ * 2 + sample_rate * TIME_STRETCH_MAX_FRAME_MS / 1000;
+    input_.reserve(capacity);
+    // Flush() 输出上一段的尾部和全部剩余输入
+    output_.reserve(capacity + hop_);
+    Reset();
+}
+
+void TimeStretcher::Reset() {
+    active_ = false;
+    input_.clear();
+    overlap_.clear();
+    nominal_ = 0;
+    last_segment_ = 0;
+    output_offset_ = 0;
+    output_scale_ = 1.0f;
+}
+
+void TimeStretcher::Process(std::vector<int16_t>& pcm, float ratio) {
+    if (hop_ == 0) {
+        return;
+    }
+    float max_ratio = 1.0f + TIME_STRETCH_MAX_PERCENT / 100.0f;
+    float min_ratio = 1.0f - TIME_STRETCH_MAX_PERCENT / 100.0f;
+    ratio = std::clamp(ratio, min_ratio, max_ratio);
+
+    if (ratio == 1.0f) {
+        if (active_) {
+            // 输出缓存的数据和本帧, 之后直通. 输出从上一段的尾部开始, 与输入一一对应
+            int frame_start = input_.size();
+            int offset = last_segment_ + hop_ - frame_start;
+            input_.insert(input_.end(), pcm.begin(), pcm.end());
+            output_.clear();
+            Flush(output_);
+            output_offset_ = offset;
+            // 拷贝而不交换, 两边的缓冲区各自保留容量
+            pcm.assign(output_.begin(), output_.end());
+        } else {
+            output_offset_ = 0;
+            output_scale_ = 1.0f;
+        }
+        return;
+    }
+
+    int frame_start = 0;
+    if (!active_) {
+        // 进入伸缩: 本帧开头作为第一段的尾部, 名义位置从 -hop_ 起算
+        active_ = true;
+        input_.assign(pcm.begin(), pcm.end());
+        overlap_.assign(input_.begin(), input_.begin() + std::min<size_t>(hop_, input_.size()));
+        last_segment_ = -hop_;
+        nominal_ = -hop_;
+    } else {
+        frame_start = input_.size();
+        input_.insert(input_.end(), pcm.begin(), pcm.end());
+    }
+    // 下一个输出样本从上一段的尾部淡出开始, 每个合成步长覆盖 hop_ / ratio 个输入样本
+    output_offset_ = last_segment_ + hop_ - frame_start;
+    output_scale_ = ratio;
+
+    double analysis_hop = hop_ / ratio;
+    output_.clear();
+    while (true) {
+        int nominal = static_cast<int>(nominal_ + analysis_hop);
+        if (nominal + tolerance_ + 2 * hop_ > static_cast<int>(input_.size())) {
+            break;
+        }
+        int segment = FindBestOffset(nominal);
+
+        // 交叉淡化: 上一段尾部淡出, 新一段开头淡入
+        const int16_t* head = input_.data() + segment;
+        for (int i = 0; i < hop_; i++) {
+            int32_t w = fade_in_[i];
+            int32_t sample = (overlap_[i] * (32767 - w) + head[i] * w) >> 15;
+            output_.push_back(static_cast<int16_t>(sample));
+        }
+        overlap_.assign(input_.begin() + segment + hop_, input_.begin() + segment + 2 * hop_);
+
+        last_segment_ = segment;
+        nominal_ += analysis_hop;
+    }
+    Trim();
+    pcm.assign(output_.begin(), output_.end());
+}
+
+int TimeStretcher::FindBestOffset(int nominal) const {
+    int begin = std::max(nominal - tolerance_, 0);
+    int end = nominal + tolerance_;
+    const int16_t* target = overlap_.data();
+
+    // 归一化互相关, 隔点计算以减半运算量
+    int best = std::max(nominal, 0);
+    float best_score = -1e30f;
+    for (int candidate = begin; candidate <= end; candidate++) {
+        const int16_t* x = input_.data() + candidate;
+        int64_t correlation = 0;
+        int64_t energy = 1;
+        for (int i = 0; i < hop_; i += 2) {
+            correlation += static_cast<int32_t>(x[i]) * target[i];
+            energy += static_cast<int32_t>(x[i]) * x[i];
+        }
+        float score = static_cast<float>(correlation) / sqrtf(static_cast<float>(energy));
+        if (score > best_score) {
+            best_score = score;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+void TimeStretcher::Flush(std::vector<int16_t>& output) {
+    // 比例为 1 时上一段之后的数据本来就是连续的, 原样输出即可
+    output.insert(output.end(), overlap_.begin(), overlap_.end());
+    size_t rest = std::max(last_segment_ + 2 * hop_, 0);
+    if (rest < input_.size()) {
+        output.insert(output.end(), input_.begin() + rest, input_.end());
+    }
+    Reset();
+}
+
+void TimeStretcher::Trim() {
+    // 丢弃之后不会再被搜索到的数据
+    int keep_from = std::min(static_cast<int>(nominal_) - tolerance_, last_segment_ + 2 * hop_);
+    if (keep_from <= hop_ * 4) {
+        return;
+    }
+    input_.erase(input_.begin(), input_.begin() + keep_from);
+    nominal_ -= keep_from;
+    last_segment_ -= keep_from;
+}
@@ -0,0 +1,70 @@
+#ifndef TIME_STRETCHER_H
+#define TIME_STRETCHER_H
+
+#include <cstdint>
+#include <vector>
+
+// 变速范围 (百分比), 超出后可闻度明显上升
+#define TIME_STRETCH_MAX_PERCENT 8
+// WSOLA 参数
+#define TIME_STRETCH_HOP_MS 10          // 合成步长 (窗长为两倍)
+#define TIME_STRETCH_TOLERANCE_MS 5     // 分析位置搜索范围 ±
+// 输入帧的最长时长, 按它预留内部缓冲
+#define TIME_STRETCH_MAX_FRAME_MS 60
+
+/**
+ * WSOLA 时间伸缩 (不变调)
+ *
+ * 每个合成步长从输入中挑选一段与上一段尾部最相似的数据, 交叉淡化拼接:
+ * - ratio > 1: 输出比输入长, 播放变慢 (缓冲偏低时用来争取时间)
+ * - ratio < 1: 输出比输入短, 播放变快 (缓冲过深时收回延迟)
+ * - ratio == 1: 把内部缓存的数据原样输出后回到直通, 不引入额外延迟
+ *
+ * 只处理单声道 int16 PCM, 只能被一个任务调用.
+ * 内部缓冲在 Configure() 中按最坏情况预留, 处理时不分配内存 (输出超过 pcm 的容量时除外).
+ */
+class TimeStretcher {
+public:
+    void Configure(int sample_rate);
+    void Reset();
+
+    /**
+     * 处理一帧 PCM
+     * @param pcm 输入, 返回时替换为输出 (长度约为输入 * ratio)
+     * @param ratio 输出/输入长度比, 限制在 ±TIME_STRETCH_MAX_PERCENT 内
+     */
+    void Process(std::vector<int16_t>& pcm, float ratio);
+
+    bool active() const { return active_; }
+
+    /**
+     * 上一次 Process() 输出的第一个样本对应的输入位置, 相对那一帧输入的开头 (样本).
+     * 伸缩时输出滞后于输入 (保留的前瞻数据), 所以通常为负; 直通时为 0
+     */
+    int output_offset() const { return output_offset_; }
+
+    /**
+     * 上一次输出的长度与它覆盖的输入长度之比, 直通时为 1
+     */
+    float output_scale() const { return output_scale_; }
+
+private:
+    int FindBestOffset(int nominal) const;
+    void Flush(std::vector<int16_t>& output);
+    void Trim();
+
+    int hop_ = 0;           // 合成步长 Hs (样本)
+    int tolerance_ = 0;     // 搜索范围 (样本)
+    std::vector<int16_t> fade_in_;   // Q15 升余弦淡入窗
+
+    bool active_ = false;
+    std::vector<int16_t> input_;     // 未消耗的输入
+    std::vector<int16_t> overlap_;   // 上一段的后半部分, 等待与下一段交叉淡化
+    std::vector<int16_t> output_;
+    double nominal_ = 0;    // 下一段的名义分析位置
+    int last_segment_ = 0;  // 上一段在 input_ 中的起点
+    int output_offset_ = 0;
+    float output_scale_ = 1.0f;
+};
+
+#endif // TIME_STRETCHER_H
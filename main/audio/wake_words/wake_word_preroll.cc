@@ -0,0 +1,131 @@
+#include "wake_word_preroll.h"
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+
+#include <cassert>
+
+#define TAG "WakeWordPreroll"
+
+// 编码任务落后太多时 (不应发生) 丢弃积压的 PCM, 而不是无限增长
+static constexpr size_t kMaxPendingSamples = WAKE_WORD_PREROLL_MS * WAKE_WORD_PREROLL_SAMPLE_RATE / 1000;
+
+WakeWordPreroll::WakeWordPreroll() {
+}
+
+WakeWordPreroll::~WakeWordPreroll() {
+    if (encode_task_ != nullptr) {
+        vTaskDelete(encode_task_);
+    }
+    if (encode_task_stack_ != nullptr) {
+        heap_caps_free(encode_task_stack_);
+    }
+    if (encode_task_buffer_ != nullptr) {
+        heap_caps_free(encode_task_buffer_);
+    }
+}
+
+void WakeWordPreroll::Feed(const int16_t* pcm, size_t samples) {
+    if (encode_task_ == nullptr) {
+        encoder_ = std::make_unique<OpusStreamEncoder>(WAKE_WORD_PREROLL_SAMPLE_RATE, 1, WAKE_WORD_PREROLL_FRAME_MS);
+        encoder_->SetComplexity(0); // 0 is the fastest
+
+        encode_task_stack_ = (StackType_t*)heap_caps_malloc(WAKE_WORD_PREROLL_TASK_STACK_SIZE, MALLOC_CAP_SPIRAM);
+        assert(encode_task_stack_ != nullptr);
+        encode_task_buffer_ = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+        assert(encode_task_buffer_ != nullptr);
+        encode_task_ = xTaskCreateStatic([](void* arg) {
+            auto this_ = (WakeWordPreroll*)arg;
+            this_->EncodeTask();
+        }, "encode_wake_word", WAKE_WORD_PREROLL_TASK_STACK_SIZE, this, WAKE_WORD_PREROLL_TASK_PRIORITY,
+           encode_task_stack_, encode_task_buffer_);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.size() + samples > kMaxPendingSamples) {
+        ESP_LOGW(TAG, "Encoder behind, dropping %u samples", pending_.size());
+        pending_.clear();
+    }
+    pending_.insert(pending_.end(), pcm, pcm + samples);
+    work_cv_.notify_one();
+}
+
+void WakeWordPreroll::Seal() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sealed_.clear();
+    for (size_t i = 0; i < ring_count_; i++) {
+        sealed_.push_back(std::move(ring_[(ring_head_ + i) % WAKE_WORD_PREROLL_PACKETS]));
+    }
+    ESP_LOGI(TAG, "Sealed %u pre-roll packets, %u samples still to encode", ring_count_, pending_.size());
+    ring_head_ = 0;
+    ring_count_ = 0;
+
+    if (encode_task_ == nullptr) {
+        // Nothing was ever fed
+        sealed_.emplace_back();
+    } else {
+        sealing_ = true;
+        seal_requested_ = true;
+        work_cv_.notify_one();
+    }
+    output_cv_.notify_all();
+}
+
+bool WakeWordPreroll::Pop(std::vector<uint8_t>& opus) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    output_cv_.wait(lock, [this]() {
+        return !sealed_.empty() || !sealing_;
+    });
+    if (sealed_.empty()) {
+        return false;
+    }
+    opus.swap(sealed_.front());
+    sealed_.pop_front();
+    return !opus.empty();
+}
+
+void WakeWordPreroll::EncodeTask() {
+    std::vector<int16_t> pcm;
+    std::vector<uint8_t> packet;
+    while (true) {
+        bool seal;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this]() {
+                return !pending_.empty() || seal_requested_;
+            });
+            // The emptied buffer goes back, so neither side reallocates
+            pcm.swap(pending_);
+            seal = seal_requested_;
+            seal_requested_ = false;
+        }
+
+        encoder_->Write(pcm.data(), pcm.size());
+        pcm.clear();
+        while (encoder_->Read(packet)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (sealing_) {
+                // PCM fed before Seal(), it belongs to the sealed pre-roll
+                sealed_.push_back(packet);
+                output_cv_.notify_all();
+                continue;
+            }
+            if (ring_count_ == WAKE_WORD_PREROLL_PACKETS) {
+                ring_head_ = (ring_head_ + 1) % WAKE_WORD_PREROLL_PACKETS;
+                ring_count_--;
+            }
+            auto& slot = ring_[(ring_head_ + ring_count_) % WAKE_WORD_PREROLL_PACKETS];
+            slot.assign(packet.begin(), packet.end());
+            ring_count_++;
+        }
+
+        if (seal) {
+            // Less than a frame is left over, the next pre-roll starts from a fresh encoder state
+            encoder_->ResetState();
+            std::lock_guard<std::mutex> lock(mutex_);
+            sealed_.emplace_back();
+            sealing_ = false;
+            output_cv_.notify_all();
+        }
+    }
+}
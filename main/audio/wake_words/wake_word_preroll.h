@@ -0,0 +1,80 @@
+#ifndef WAKE_WORD_PREROLL_H
+#define WAKE_WORD_PREROLL_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "opus_stream_encoder.h"
+
+// 保留唤醒词之前多长的音频 (用于声纹等识别)
+#define WAKE_WORD_PREROLL_MS 2000
+#define WAKE_WORD_PREROLL_SAMPLE_RATE 16000
+#define WAKE_WORD_PREROLL_FRAME_MS 60
+#define WAKE_WORD_PREROLL_PACKETS (WAKE_WORD_PREROLL_MS / WAKE_WORD_PREROLL_FRAME_MS)
+// 编码任务: 栈放在 PSRAM, 优先级低于检测与音频任务
+#define WAKE_WORD_PREROLL_TASK_STACK_SIZE (4096 * 7)
+#define WAKE_WORD_PREROLL_TASK_PRIORITY 2
+
+/**
+ * 唤醒词 pre-roll: 持续编码最近 WAKE_WORD_PREROLL_MS 的音频
+ *
+ * 以前检测到唤醒词后才把缓存的 2 秒 PCM 一次性编码, 第一个上行包要等整段编码完.
+ * 现在检测期间每个 PCM 块都交给后台任务增量编码, 环形缓冲中始终是现成的 Opus 包:
+ * - Feed(): 检测任务调用, 只拷贝 PCM, 不编码
+ * - Seal(): 检测到唤醒词后调用, 环中的包立即可读, 尚未编码的尾部 (不到一个块) 随后补上
+ * - Pop(): 按顺序读出, 最后一个包之后返回 false
+ *
+ * 编码器在检测期间一直运行 (复杂度 0), 代价是空闲时持续的少量 CPU 占用.
+ */
+class WakeWordPreroll {
+public:
+    WakeWordPreroll();
+    ~WakeWordPreroll();
+
+    /**
+     * 追加 16kHz 单声道 PCM
+     */
+    void Feed(const int16_t* pcm, size_t samples);
+
+    /**
+     * 封存当前的 pre-roll 供 Pop() 读取, 之后的 Feed() 开始新的 pre-roll
+     */
+    void Seal();
+
+    /**
+     * 读取下一个封存的包, 尾部还在编码时等待
+     * @return 没有更多包时返回 false
+     */
+    bool Pop(std::vector<uint8_t>& opus);
+
+private:
+    void EncodeTask();
+
+    std::unique_ptr<OpusStreamEncoder> encoder_;
+    TaskHandle_t encode_task_ = nullptr;
+    StaticTask_t* encode_task_buffer_ = nullptr;
+    StackType_t* encode_task_stack_ = nullptr;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;       // 编码任务: 有新 PCM 或封存请求
+    std::condition_variable output_cv_;     // Pop(): 有新的封存包
+    std::vector<int16_t> pending_;          // 尚未交给编码器的 PCM
+    bool seal_requested_ = false;
+    // 编码好的包, 按时间顺序的环形缓冲, 包的容量在覆盖时复用
+    std::vector<uint8_t> ring_[WAKE_WORD_PREROLL_PACKETS];
+    size_t ring_head_ = 0;
+    size_t ring_count_ = 0;
+    // 封存的包, 空包表示结束
+    std::deque<std::vector<uint8_t>> sealed_;
+    bool sealing_ = false;      // Seal() 之后、编码任务处理完尾部之前, 新包直接进入 sealed_
+};
+
+#endif // WAKE_WORD_PREROLL_H
@@ -3,7 +3,7 @@
 #include <esp_log.h>
 #include <driver/i2c_master.h>
 #include <driver/i2s_tdm.h>
-#include <cmath>
+#include <algorithm>
 
 static const char TAG[] = "K10AudioCodec";
 
@@ -15,6 +15,8 @@ K10AudioCodec::K10AudioCodec(void* i2c_master_handle, int input_sample_rate, int
     input_channels_ = input_reference_ ? 2 : 1; // 输入通道数
     input_sample_rate_ = input_sample_rate;
     output_sample_rate_ = output_sample_rate;
+    // Write() 以 32 位样本写入 TX DMA, 快速中止的淡出按此解释 DMA 数据
+    tx_sample_bits_ = 32;
 
     CreateDuplexChannels(mclk, bclk, ws, dout, din);
 
@@ -200,27 +202,28 @@ int K10AudioCodec::Read(int16_t* dest, int samples) {
 
 int K10AudioCodec::Write(const int16_t* data, int samples) {
     if (output_enabled_) {
-        std::vector<int32_t> buffer(samples * 2);  // Allocate buffer for 2x samples
-
-        // Apply volume adjustment (same as before)
-        int32_t volume_factor = pow(double(output_volume_) / 100.0, 2) * 65536;
-        for (int i = 0; i < samples; i++) {
-            int64_t temp = int64_t(data[i]) * volume_factor;
-            if (temp > INT32_MAX) {
-            buffer[i * 2] = INT32_MAX;
-            } else if (temp < INT32_MIN) {
-            buffer[i * 2] = INT32_MIN;
-            } else {
-            buffer[i * 2] = static_cast<int32_t>(temp);
+        int32_t* buffer = tx_scratch();
+        if (buffer == nullptr) {
+            return 0;
+        }
+
+        // 每个样本重复一次写入两个声道, 一段最多处理半个中转缓冲区的单声道样本
+        const int capacity = AUDIO_CODEC_SCRATCH_SAMPLES / 2;
+        int32_t gain = output_gain_q15();
+        int written = 0;
+        for (int offset = 0; offset < samples; offset += capacity) {
+            int count = std::min(samples - offset, capacity);
+            audio_dsp::Widen16To32(data + offset, buffer, count, gain);
+            for (int i = count - 1; i >= 0; i--) {
+                buffer[i * 2 + 1] = buffer[i];
+                buffer[i * 2] = buffer[i];
             }
 
-            // Repeat each sample for slow playback (assuming mono audio)
-            buffer[i * 2 + 1] = buffer[i * 2];
+            size_t bytes_written;
+            ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, buffer, count * 2 * sizeof(int32_t), &bytes_written, portMAX_DELAY));
+            written += bytes_written / sizeof(int32_t);
         }
-
-        size_t bytes_written;
-        ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, buffer.data(), samples * 2 * sizeof(int32_t), &bytes_written, portMAX_DELAY));
-        return bytes_written / sizeof(int32_t);
+        return written;
     }
     return samples;
 }
@@ -4,6 +4,7 @@
 #include <driver/i2c_master.h>
 #include <driver/i2s_tdm.h>
 #include <cstring>
+#include <algorithm>
 
 static const char TAG[] = "BoxAudioCodecLite";
 
@@ -226,18 +227,26 @@ int BoxAudioCodecLite::Read(int16_t* dest, int samples) {
         else {
             int size = samples / input_channels_;
             int channels = input_channels_ - input_reference_;
-            std::vector<int16_t> data(size * channels);
-            // read mic data
-            ESP_ERROR_CHECK_WITHOUT_ABORT(esp_codec_dev_read(input_dev_, (void*)data.data(), data.size() * sizeof(int16_t)));
-            int j = 0;
+            // 复用基类的中转缓冲区读麦克风数据, 按容量分段与参考数据交织
+            auto data = reinterpret_cast<int16_t*>(rx_scratch());
+            if (data == nullptr) {
+                return 0;
+            }
+            const int capacity = AUDIO_CODEC_SCRATCH_SAMPLES * 2 / channels;
             int i = 0;
-            while (i< samples) {
-                // mic data
-                for (int p = 0; p < channels; p++) {
-                    dest[i++] = data[j++];
+            for (int offset = 0; offset < size; offset += capacity) {
+                int count = std::min(size - offset, capacity);
+                // read mic data
+                ESP_ERROR_CHECK_WITHOUT_ABORT(esp_codec_dev_read(input_dev_, (void*)data, count * channels * sizeof(int16_t)));
+                int j = 0;
+                for (int k = 0; k < count; k++) {
+                    // mic data
+                    for (int p = 0; p < channels; p++) {
+                        dest[i++] = data[j++];
+                    }
+                    // ref data
+                    dest[i++] = read_pos_ < write_pos_? ref_buffer_[read_pos_++] : 0;
                 }
-                // ref data
-                dest[i++] = read_pos_ < write_pos_? ref_buffer_[read_pos_++] : 0;
             }
     
             if (read_pos_ == write_pos_) {
@@ -196,7 +196,7 @@ void AdcPdmAudioCodec::Start() {
         output_volume_ = 10;
     }
 
-    ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
+    EnableTxChannel();
 
     EnableInput(true);
     EnableOutput(true);
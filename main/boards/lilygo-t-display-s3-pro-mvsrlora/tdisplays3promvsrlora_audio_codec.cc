@@ -1,6 +1,7 @@
 #include "tdisplays3promvsrlora_audio_codec.h"
 
 #include <esp_log.h>
+#include <algorithm>
 #include <driver/i2c_master.h>
 #include <driver/i2s_tdm.h>
 #include <driver/i2s_pdm.h>
@@ -138,13 +139,19 @@ int Tdisplays3promvsrloraAudioCodec::Read(int16_t *dest, int samples){
 
 int Tdisplays3promvsrloraAudioCodec::Write(const int16_t *data, int samples){
     if (output_enabled_){
-        size_t bytes_read;
-        auto output_data = (int16_t *)malloc(samples * sizeof(int16_t));
-        for (size_t i = 0; i < samples; i++){
-            output_data[i] = (float)data[i] * (float)(volume_ / 100.0);
+        // 复用基类的中转缓冲区, 按 16 位样本分段施加音量
+        auto output_data = reinterpret_cast<int16_t *>(tx_scratch());
+        if (output_data == nullptr) {
+            return 0;
+        }
+        const int capacity = AUDIO_CODEC_SCRATCH_SAMPLES * 2;
+        int32_t gain = volume_ * audio_dsp::kUnityGain / 100;
+        for (int offset = 0; offset < samples; offset += capacity) {
+            int count = std::min(samples - offset, capacity);
+            audio_dsp::ApplyGain(data + offset, output_data, count, gain);
+            size_t bytes_written;
+            i2s_channel_write(tx_handle_, output_data, count * sizeof(int16_t), &bytes_written, portMAX_DELAY);
         }
-        i2s_channel_write(tx_handle_, output_data, samples * sizeof(int16_t), &bytes_read, portMAX_DELAY);
-        free(output_data);
     }
     return samples;
 }
@@ -0,0 +1,83 @@
+#include "audio_stream_packet.h"
+
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+// 速率统计窗口
+#define COPY_RATE_WINDOW_US 1000000
+
+static std::atomic<uint64_t> copied_bytes{0};
+
+static ObjectPool<AudioStreamPacket>& GetPacketPool() {
+    static bool has_psram = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+    static ObjectPool<AudioStreamPacket> pool(has_psram ? AUDIO_PACKET_POOL_SIZE : AUDIO_PACKET_POOL_SIZE_INTERNAL,
+                                              has_psram ? MALLOC_CAP_SPIRAM : MALLOC_CAP_DEFAULT);
+    static bool prepared = []() {
+        pool.Prepare([](AudioStreamPacket& packet) {
+            packet.payload.reserve(AUDIO_PACKET_PAYLOAD_RESERVE);
+        }, AUDIO_PACKET_PAYLOAD_RESERVE_COUNT);
+        return true;
+    }();
+    (void)prepared;
+    return pool;
+}
+
+void AudioStreamPacketDeleter::operator()(AudioStreamPacket* packet) const {
+    packet->sample_rate = 0;
+    packet->frame_duration = 0;
+    packet->timestamp = 0;
+    packet->timestamp_skew_us = 0;
+    packet->missing_before = 0;
+    packet->queued_us = 0;
+    packet->capture_us = 0;
+    packet->payload.clear();
+    GetPacketPool().Release(packet);
+}
+
+void AudioStreamPacket::AssignPayload(const uint8_t* data, size_t size) {
+    payload.resize(size);
+    if (size > 0) {
+        memcpy(payload.data(), data, size);
+    }
+    CountCopiedBytes(size);
+}
+
+AudioStreamPacketPtr AudioStreamPacket::Create() {
+    return AudioStreamPacketPtr(GetPacketPool().Acquire());
+}
+
+ObjectPoolStatistics AudioStreamPacket::GetPoolStatistics() {
+    return GetPacketPool().GetStatistics();
+}
+
+void AudioStreamPacket::CountCopiedBytes(size_t size) {
+    copied_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+AudioCopyStatistics AudioStreamPacket::GetCopyStatistics() {
+    static std::mutex mutex;
+    static int64_t window_start_us = 0;
+    static uint64_t window_start_bytes = 0;
+    static uint32_t bytes_per_second = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    AudioCopyStatistics statistics;
+    statistics.total_bytes = copied_bytes.load(std::memory_order_relaxed);
+
+    int64_t now_us = esp_timer_get_time();
+    int64_t elapsed_us = now_us - window_start_us;
+    if (window_start_us == 0) {
+        window_start_us = now_us;
+        window_start_bytes = statistics.total_bytes;
+    } else if (elapsed_us >= COPY_RATE_WINDOW_US) {
+        bytes_per_second = (statistics.total_bytes - window_start_bytes) * 1000000 / elapsed_us;
+        window_start_us = now_us;
+        window_start_bytes = statistics.total_bytes;
+    }
+    statistics.bytes_per_second = bytes_per_second;
+    return statistics;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file audio_stream_packet.h
+ * @brief 音频数据包 (Opus 帧) 及其对象池
+ */
+
+#ifndef AUDIO_STREAM_PACKET_H
+#define AUDIO_STREAM_PACKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "object_pool.h"
+#include "ref_ptr.h"
+
+// A full decode queue and send queue at 20ms frames (see audio_service.h) plus packets in flight.
+// The pool lives in PSRAM, boards without PSRAM keep a small internal pool and fall back to the heap beyond it.
+#define AUDIO_PACKET_POOL_SIZE 768
+#define AUDIO_PACKET_POOL_SIZE_INTERNAL 64
+// 60ms Opus frames are well below this size, the payload keeps its capacity across reuse.
+// Only the packets handed out first are reserved up front, the rest grow their payload on first use.
+#define AUDIO_PACKET_PAYLOAD_RESERVE 256
+#define AUDIO_PACKET_PAYLOAD_RESERVE_COUNT 64
+
+struct AudioStreamPacket;
+
+// Returns packets to the pool once the last reference is dropped
+struct AudioStreamPacketDeleter {
+    void operator()(AudioStreamPacket* packet) const;
+};
+
+/**
+ * 数据包句柄 (引用计数)
+ *
+ * 协议层收到一帧后只拷贝一次到池化的 payload, 之后事件总线和解码队列
+ * 共享同一个包, 最后一个持有者释放时才归还对象池.
+ */
+using AudioStreamPacketPtr = RefPtr<AudioStreamPacket, AudioStreamPacketDeleter>;
+
+/**
+ * 数据拷贝统计
+ */
+struct AudioCopyStatistics {
+    uint64_t total_bytes = 0;       // 累计拷贝字节数
+    uint32_t bytes_per_second = 0;  // 最近一个统计窗口的拷贝速率
+};
+
+struct AudioStreamPacket : RefCounted {
+    int sample_rate = 0;
+    int frame_duration = 0;
+    uint32_t timestamp = 0;
+    uint32_t timestamp_skew_us = 0; // 上行: timestamp 的不确定度 (播放时钟的残差), 服务器端 AEC 用
+    uint16_t missing_before = 0;    // 此包之前丢失的帧数 (由序号或本地丢包得出)
+    int64_t queued_us = 0;          // 进入解码队列或发送队列的时间 (esp_timer), 用于统计排队等待
+    int64_t capture_us = 0;         // 上行包的麦克风采集时间, 用于统计端到端延迟
+    std::vector<uint8_t> payload;
+
+    // Copy bytes into the payload, counted in GetCopyStatistics()
+    void AssignPayload(const uint8_t* data, size_t size);
+
+    // Take a packet from the preallocated pool (falls back to the heap when exhausted)
+    static AudioStreamPacketPtr Create();
+    static ObjectPoolStatistics GetPoolStatistics();
+
+    // Every payload copy on the audio path reports here so zero-copy regressions show up in the rate
+    static void CountCopiedBytes(size_t size);
+    static AudioCopyStatistics GetCopyStatistics();
+};
+
+#endif // AUDIO_STREAM_PACKET_H
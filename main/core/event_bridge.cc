@@ -48,12 +48,12 @@ void EventBridge::EmitAudioOutputStart() {
     EventBus::GetInstance().Emit(event);
 }
 
-void EventBridge::EmitAudioOutputData(const uint8_t* data, size_t len, int duration_ms) {
+void EventBridge::EmitAudioOutputData(const AudioStreamPacketPtr& packet) {
     AudioDataEvent event(EventType::AUDIO_OUTPUT_DATA);
     event.timestamp = esp_timer_get_time() / 1000;
-    event.duration_ms = duration_ms;
-    if (data && len > 0) {
-        event.data.assign(data, data + len);
+    if (packet) {
+        event.duration_ms = packet->frame_duration;
+        event.packet = packet;
     }
     EventBus::GetInstance().Emit(event);
 }
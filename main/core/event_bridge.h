@@ -26,7 +26,7 @@
  * EventBridge::EmitConnectionStart();
  * EventBridge::EmitConnectionSuccess();
  * EventBridge::EmitAudioStart();
- * EventBridge::EmitAudioData(data, len, duration_ms);
+ * EventBridge::EmitAudioOutputData(packet);
  * EventBridge::EmitAudioEnd();
  * ```
  */
@@ -68,8 +68,9 @@ public:
 
     /**
      * 发布音频数据事件
+     * 事件持有数据包的引用, 订阅者与解码队列看到的是同一份 payload
      */
-    static void EmitAudioOutputData(const uint8_t* data, size_t len, int duration_ms = 60);
+    static void EmitAudioOutputData(const AudioStreamPacketPtr& packet);
 
     /**
      * 发布音频结束事件
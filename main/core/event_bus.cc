@@ -2,7 +2,6 @@
 
 #include <esp_log.h>
 #include <algorithm>
-#include <cstring>
 
 static const char* TAG = "EventBus";
 
@@ -11,27 +10,82 @@ EventBus& EventBus::GetInstance() {
     return instance;
 }
 
+// 只关心最新值的事件, 排队中的旧事件可以直接被替换
+static bool IsCoalescable(EventType type) {
+    switch (type) {
+        case EventType::AUDIO_INPUT_VAD:
+        case EventType::AUDIO_BUFFER_LOW:
+        case EventType::DISPLAY_SET_EMOTION:
+        case EventType::DISPLAY_SET_STATUS:
+        case EventType::DISPLAY_POWER_SAVE:
+        case EventType::SYSTEM_LOW_BATTERY:
+            return true;
+        default:
+            return false;
+    }
+}
+
 EventBus::EventBus() {
     mutex_ = xSemaphoreCreateMutex();
-    event_queue_ = xQueueCreate(EVENT_QUEUE_SIZE, sizeof(QueuedEvent));
+    queue_mutex_ = xSemaphoreCreateMutex();
+    // 多留一个位置给 StopEventLoop 的唤醒消息
+    event_queue_ = xQueueCreate(EVENT_QUEUE_SIZE + 1, sizeof(QueueItem));
+    free_slots_ = xQueueCreate(EVENT_QUEUE_SIZE, sizeof(Slot*));
 
-    if (mutex_ == nullptr || event_queue_ == nullptr) {
+    if (mutex_ == nullptr || queue_mutex_ == nullptr || event_queue_ == nullptr || free_slots_ == nullptr) {
         ESP_LOGE(TAG, "Failed to create mutex or queue");
+        return;
+    }
+
+    slots_ = new Slot[EVENT_QUEUE_SIZE];
+    for (int i = 0; i < EVENT_QUEUE_SIZE; i++) {
+        Slot* slot = &slots_[i];
+        xQueueSend(free_slots_, &slot, 0);
     }
 }
 
 EventBus::~EventBus() {
     StopEventLoop();
 
+    for (auto& slot : subscribers_) {
+        delete slot.load();
+    }
+    while (retired_ != nullptr) {
+        SubscriberList* next = retired_->next_retired;
+        delete retired_;
+        retired_ = next;
+    }
+
+    if (slots_ != nullptr) {
+        for (int i = 0; i < EVENT_QUEUE_SIZE; i++) {
+            if (slots_[i].event != nullptr) {
+                slots_[i].event->~Event();
+            }
+        }
+        delete[] slots_;
+    }
+
     if (mutex_) {
         vSemaphoreDelete(mutex_);
     }
+    if (queue_mutex_) {
+        vSemaphoreDelete(queue_mutex_);
+    }
     if (event_queue_) {
         vQueueDelete(event_queue_);
     }
+    if (free_slots_) {
+        vQueueDelete(free_slots_);
+    }
 }
 
 int EventBus::Subscribe(EventType type, EventHandler handler, Priority priority) {
+    size_t index = static_cast<size_t>(type);
+    if (index >= subscribers_.size()) {
+        ESP_LOGE(TAG, "Invalid event type: %d", static_cast<int>(type));
+        return -1;
+    }
+
     if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE) {
         ESP_LOGE(TAG, "Failed to take mutex");
         return -1;
@@ -41,17 +95,24 @@ int EventBus::Subscribe(EventType type, EventHandler handler, Priority priority)
 
     Subscriber sub;
     sub.id = id;
-    sub.handler = handler;
+    sub.handler = std::move(handler);
     sub.priority = priority;
 
-    auto& subs = subscribers_[type];
-    subs.push_back(sub);
+    // 复制当前快照并加入新订阅者
+    auto list = new SubscriberList();
+    const SubscriberList* current = subscribers_[index].load();
+    if (current != nullptr) {
+        list->subscribers.reserve(current->subscribers.size() + 1);
+        list->subscribers = current->subscribers;
+    }
+    list->subscribers.push_back(std::move(sub));
 
-    // 按优先级排序 (高优先级在前)
-    std::sort(subs.begin(), subs.end(), [](const Subscriber& a, const Subscriber& b) {
+    // 按优先级排序 (高优先级在前, 同优先级保持订阅顺序)
+    std::stable_sort(list->subscribers.begin(), list->subscribers.end(), [](const Subscriber& a, const Subscriber& b) {
         return a.priority > b.priority;
     });
 
+    Publish(index, list);
     xSemaphoreGive(mutex_);
 
     ESP_LOGD(TAG, "Subscribe: type=%d, id=%d, priority=%d",
@@ -61,24 +122,31 @@ int EventBus::Subscribe(EventType type, EventHandler handler, Priority priority)
 }
 
 void EventBus::Unsubscribe(EventType type, int handler_id) {
+    size_t index = static_cast<size_t>(type);
+    if (index >= subscribers_.size()) {
+        return;
+    }
+
     if (xSemaphoreTake(mutex_, portMAX_DELAY) != pdTRUE) {
         ESP_LOGE(TAG, "Failed to take mutex");
         return;
     }
 
-    auto it = subscribers_.find(type);
-    if (it != subscribers_.end()) {
-        auto& subs = it->second;
-        subs.erase(
-            std::remove_if(subs.begin(), subs.end(),
-                [handler_id](const Subscriber& s) { return s.id == handler_id; }),
-            subs.end()
-        );
+    const SubscriberList* current = subscribers_[index].load();
+    if (current != nullptr) {
+        auto list = new SubscriberList();
+        for (const auto& sub : current->subscribers) {
+            if (sub.id != handler_id) {
+                list->subscribers.push_back(sub);
+            }
+        }
 
         // 如果没有订阅者了，移除整个条目
-        if (subs.empty()) {
-            subscribers_.erase(it);
+        if (list->subscribers.empty()) {
+            delete list;
+            list = nullptr;
         }
+        Publish(index, list);
     }
 
     xSemaphoreGive(mutex_);
@@ -86,64 +154,106 @@ void EventBus::Unsubscribe(EventType type, int handler_id) {
     ESP_LOGD(TAG, "Unsubscribe: type=%d, id=%d", static_cast<int>(type), handler_id);
 }
 
-void EventBus::Emit(const Event& event) {
-    // 复制订阅者列表，避免在回调中修改
-    std::vector<Subscriber> subs_copy;
+void EventBus::Publish(size_t index, SubscriberList* list) {
+    SubscriberList* old = subscribers_[index].exchange(list);
+    if (old != nullptr) {
+        old->next_retired = retired_;
+        retired_ = old;
+        has_retired_ = true;
+    }
+    ReclaimRetired();
+}
+
+void EventBus::ReclaimRetired() {
+    // 旧快照已从 subscribers_ 中摘下, 之后开始的 Emit 不会再读到它;
+    // 读者计数为 0 说明之前开始的 Emit 也都已结束
+    if (retired_ == nullptr || active_readers_.load() != 0) {
+        return;
+    }
+    while (retired_ != nullptr) {
+        SubscriberList* next = retired_->next_retired;
+        delete retired_;
+        retired_ = next;
+    }
+    has_retired_ = false;
+}
 
-    if (xSemaphoreTake(mutex_, portMAX_DELAY) == pdTRUE) {
-        auto it = subscribers_.find(event.type);
-        if (it != subscribers_.end()) {
-            subs_copy = it->second;
+void EventBus::ExitReader() {
+    if (active_readers_.fetch_sub(1) == 1 && has_retired_.load()) {
+        // 最后一个读者负责清理; 拿不到锁说明有写者, 它会自己清理
+        if (xSemaphoreTake(mutex_, 0) == pdTRUE) {
+            ReclaimRetired();
+            xSemaphoreGive(mutex_);
         }
-        xSemaphoreGive(mutex_);
+    }
+}
+
+void EventBus::Emit(const Event& event) {
+    size_t index = static_cast<size_t>(event.type);
+    if (index >= subscribers_.size()) {
+        return;
     }
 
-    // 在锁外执行回调
-    for (const auto& sub : subs_copy) {
-        try {
-            sub.handler(event);
-        } catch (...) {
-            ESP_LOGE(TAG, "Exception in event handler: type=%d, id=%d",
-                     static_cast<int>(event.type), sub.id);
+    // 快照不可变, 回调中订阅/取消订阅只影响之后的事件
+    active_readers_.fetch_add(1);
+    const SubscriberList* list = subscribers_[index].load();
+    if (list != nullptr) {
+        for (const auto& sub : list->subscribers) {
+            try {
+                sub.handler(event);
+            } catch (...) {
+                ESP_LOGE(TAG, "Exception in event handler: type=%d, id=%d",
+                         static_cast<int>(event.type), sub.id);
+            }
         }
     }
+    ExitReader();
 }
 
-bool EventBus::EmitAsync(const Event& event) {
-    if (event_queue_ == nullptr) {
-        return false;
+EventBus::Slot* EventBus::AcquireSlot(EventType type, TickType_t wait) {
+    Slot* slot = nullptr;
+    if (free_slots_ == nullptr || xQueueReceive(free_slots_, &slot, wait) != pdTRUE) {
+        xSemaphoreTake(queue_mutex_, portMAX_DELAY);
+        queue_stats_.dropped++;
+        xSemaphoreGive(queue_mutex_);
+        ESP_LOGW(TAG, "Event queue full, dropping event type=%d", static_cast<int>(type));
+        return nullptr;
     }
+    return slot;
+}
 
-    QueuedEvent qe;
-    memset(&qe, 0, sizeof(qe));
-    qe.type = event.type;
-    qe.timestamp = event.timestamp;
-
-    // 根据事件类型复制数据
-    if (event.type == EventType::SYSTEM_ERROR) {
-        const auto* err = static_cast<const ErrorEvent*>(&event);
-        qe.error_code = err->code;
-        strncpy(qe.message, err->message.c_str(), sizeof(qe.message) - 1);
-    } else if (event.type == EventType::DISPLAY_SET_EMOTION) {
-        const auto* disp = static_cast<const DisplayEvent*>(&event);
-        strncpy(qe.emotion, disp->emotion.c_str(), sizeof(qe.emotion) - 1);
-    } else if (event.type == EventType::DISPLAY_SET_TEXT) {
-        const auto* disp = static_cast<const DisplayEvent*>(&event);
-        strncpy(qe.text, disp->text.c_str(), sizeof(qe.text) - 1);
-    } else if (event.type >= EventType::CONN_STARTING &&
-               event.type <= EventType::CONN_HEARTBEAT_TIMEOUT) {
-        const auto* conn = static_cast<const ConnectionEvent*>(&event);
-        qe.error_code = conn->error_code;
-        strncpy(qe.message, conn->error_message.c_str(), sizeof(qe.message) - 1);
-    }
-
-    if (xQueueSend(event_queue_, &qe, 0) != pdTRUE) {
-        ESP_LOGW(TAG, "Event queue full, dropping event type=%d",
-                 static_cast<int>(event.type));
-        return false;
+void EventBus::Enqueue(Slot* slot) {
+    QueueItem item = { slot->event->type, slot };
+    Slot* replaced = nullptr;
+
+    xSemaphoreTake(queue_mutex_, portMAX_DELAY);
+    queue_stats_.enqueued++;
+    if (IsCoalescable(item.type)) {
+        auto& pending = pending_[static_cast<size_t>(item.type)];
+        replaced = pending;
+        pending = slot;
+        item.slot = nullptr;
     }
+    if (replaced != nullptr) {
+        // 已有同类型事件在排队, 沿用它的排队位置
+        queue_stats_.coalesced++;
+    } else {
+        // 槽位总数不超过队列容量, 这里不会失败
+        xQueueSend(event_queue_, &item, 0);
+        int depth = uxQueueMessagesWaiting(event_queue_);
+        queue_stats_.max_depth = std::max(queue_stats_.max_depth, depth);
+    }
+    xSemaphoreGive(queue_mutex_);
 
-    return true;
+    if (replaced != nullptr) {
+        ReleaseSlot(replaced);
+    }
+}
+
+void EventBus::ReleaseSlot(Slot* slot) {
+    slot->event->~Event();
+    slot->event = nullptr;
+    xQueueSend(free_slots_, &slot, 0);
 }
 
 void EventBus::StartEventLoop() {
@@ -177,9 +287,7 @@ void EventBus::StopEventLoop() {
     // 等待任务退出
     if (event_loop_task_) {
         // 发送一个空事件唤醒任务
-        QueuedEvent dummy;
-        memset(&dummy, 0, sizeof(dummy));
-        dummy.type = EventType::EVENT_TYPE_MAX;
+        QueueItem dummy = { EventType::EVENT_TYPE_MAX, nullptr };
         xQueueSend(event_queue_, &dummy, 0);
 
         vTaskDelay(pdMS_TO_TICKS(100));
@@ -194,61 +302,37 @@ bool EventBus::ProcessOne(int timeout_ms) {
         return false;
     }
 
-    QueuedEvent qe;
+    QueueItem item;
     TickType_t wait_ticks = (timeout_ms == 0) ? 0 : pdMS_TO_TICKS(timeout_ms);
 
-    if (xQueueReceive(event_queue_, &qe, wait_ticks) != pdTRUE) {
+    if (xQueueReceive(event_queue_, &item, wait_ticks) != pdTRUE) {
         return false;
     }
 
     // 跳过无效事件
-    if (qe.type == EventType::EVENT_TYPE_MAX) {
+    if (item.type == EventType::EVENT_TYPE_MAX) {
         return false;
     }
 
-    // 重建事件对象并分发
-    switch (qe.type) {
-        case EventType::SYSTEM_ERROR: {
-            ErrorEvent e;
-            e.type = qe.type;
-            e.timestamp = qe.timestamp;
-            e.code = qe.error_code;
-            e.message = qe.message;
-            Emit(e);
-            break;
-        }
-        case EventType::DISPLAY_SET_EMOTION: {
-            DisplayEvent e(qe.type);
-            e.timestamp = qe.timestamp;
-            e.emotion = qe.emotion;
-            Emit(e);
-            break;
-        }
-        case EventType::DISPLAY_SET_TEXT: {
-            DisplayEvent e(qe.type);
-            e.timestamp = qe.timestamp;
-            e.text = qe.text;
-            Emit(e);
-            break;
-        }
-        default: {
-            // 基本事件
-            if (qe.type >= EventType::CONN_STARTING &&
-                qe.type <= EventType::CONN_HEARTBEAT_TIMEOUT) {
-                ConnectionEvent e(qe.type);
-                e.timestamp = qe.timestamp;
-                e.error_code = qe.error_code;
-                e.error_message = qe.message;
-                Emit(e);
-            } else {
-                Event e(qe.type);
-                e.timestamp = qe.timestamp;
-                Emit(e);
-            }
-            break;
-        }
+    // 取出合并后的最新事件, 之后同类型的新事件重新排队
+    Slot* slot = item.slot;
+    if (slot == nullptr) {
+        xSemaphoreTake(queue_mutex_, portMAX_DELAY);
+        auto& pending = pending_[static_cast<size_t>(item.type)];
+        slot = pending;
+        pending = nullptr;
+        xSemaphoreGive(queue_mutex_);
+    }
+    if (slot == nullptr) {
+        return false;
     }
 
+    Emit(*slot->event);
+    ReleaseSlot(slot);
+
+    xSemaphoreTake(queue_mutex_, portMAX_DELAY);
+    queue_stats_.dispatched++;
+    xSemaphoreGive(queue_mutex_);
     return true;
 }
 
@@ -264,19 +348,33 @@ void EventBus::EventLoopTask() {
 }
 
 int EventBus::GetSubscriberCount(EventType type) const {
-    int count = 0;
-
-    if (xSemaphoreTake(mutex_, portMAX_DELAY) == pdTRUE) {
-        auto it = subscribers_.find(type);
-        if (it != subscribers_.end()) {
-            count = it->second.size();
-        }
-        xSemaphoreGive(mutex_);
+    size_t index = static_cast<size_t>(type);
+    if (index >= subscribers_.size()) {
+        return 0;
     }
 
+    int count = 0;
+    active_readers_.fetch_add(1);
+    const SubscriberList* list = subscribers_[index].load();
+    if (list != nullptr) {
+        count = list->subscribers.size();
+    }
+    active_readers_.fetch_sub(1);
     return count;
 }
 
+EventQueueStatistics EventBus::GetQueueStatistics() const {
+    EventQueueStatistics stats;
+    if (queue_mutex_ == nullptr) {
+        return stats;
+    }
+    xSemaphoreTake(queue_mutex_, portMAX_DELAY);
+    stats = queue_stats_;
+    xSemaphoreGive(queue_mutex_);
+    stats.depth = GetQueuedEventCount();
+    return stats;
+}
+
 int EventBus::GetQueuedEventCount() const {
     if (event_queue_ == nullptr) {
         return 0;
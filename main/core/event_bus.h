@@ -15,20 +15,39 @@
 #include <freertos/queue.h>
 #include <freertos/semphr.h>
 
-#include <map>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <new>
+#include <type_traits>
 #include <vector>
 #include <memory>
 #include <functional>
 #include <atomic>
 
+/**
+ * 异步事件队列统计
+ */
+struct EventQueueStatistics {
+    uint32_t enqueued = 0;      // 入队事件数
+    uint32_t coalesced = 0;     // 被同类型新事件替换掉的旧事件数
+    uint32_t dropped = 0;       // 等不到空闲槽位而丢弃的事件数
+    uint32_t dispatched = 0;    // 已分发事件数
+    int depth = 0;              // 当前排队数
+    int max_depth = 0;          // 排队数峰值
+};
+
 /**
  * 事件总线 - 发布/订阅模式的事件分发系统
  *
  * 特性:
  * - 同步发送: Emit() 立即在当前任务中执行所有处理器
- * - 异步发送: EmitAsync() 将事件放入队列，由事件循环处理
+ * - 异步发送: EmitAsync() 将事件对象整体移入队列 (保留派生类型和全部字段)，由事件循环处理
  * - 线程安全: 所有操作都是线程安全的
  * - 优先级: 支持处理器优先级 (高优先级先执行)
+ * - 无锁分发: 每个事件类型的订阅者列表是不可变快照 (按 EventType 下标存放),
+ *   Subscribe/Unsubscribe 复制并替换快照 (写时复制), Emit 不加锁也不分配内存.
+ *   被替换的旧快照等到没有 Emit 在执行时再释放.
  *
  * 使用示例:
  * ```cpp
@@ -40,7 +59,7 @@
  *
  * // 发送事件
  * AudioDataEvent event(EventType::AUDIO_OUTPUT_DATA);
- * event.data = audio_data;
+ * event.packet = packet;  // 共享引用, 不拷贝数据
  * bus.Emit(event);
  *
  * // 取消订阅
@@ -91,10 +110,28 @@ public:
     /**
      * 异步发送事件 (放入队列，由事件循环处理)
      *
+     * 事件按值移入固定大小的槽位 (不截断字符串, 不丢派生类字段), 由事件循环分发后析构.
+     * 注意按静态类型保存: 传入基类引用会只保存基类部分.
+     * 表情/状态栏这类只关心最新值的事件会合并: 队列中已有同类型事件时替换其内容,
+     * 保留原来的排队位置.
+     *
      * @param event 事件对象
+     * @param wait 没有空闲槽位时的最长等待 (0 = 不等待, 直接丢弃并计数)
      * @return 是否成功放入队列
      */
-    bool EmitAsync(const Event& event);
+    template <typename T>
+    bool EmitAsync(T event, TickType_t wait = 0) {
+        static_assert(std::is_base_of<Event, T>::value, "EmitAsync requires an Event type");
+        static_assert(sizeof(T) <= EVENT_SLOT_SIZE && alignof(T) <= alignof(std::max_align_t),
+                      "Event type does not fit into an event queue slot");
+        Slot* slot = AcquireSlot(event.type, wait);
+        if (slot == nullptr) {
+            return false;
+        }
+        slot->event = new (slot->storage) T(std::move(event));
+        Enqueue(slot);
+        return true;
+    }
 
     /**
      * 启动事件循环任务 (处理异步事件)
@@ -124,6 +161,11 @@ public:
      */
     int GetQueuedEventCount() const;
 
+    /**
+     * 获取异步队列统计
+     */
+    EventQueueStatistics GetQueueStatistics() const;
+
     // 禁止拷贝
     EventBus(const EventBus&) = delete;
     EventBus& operator=(const EventBus&) = delete;
@@ -142,28 +184,67 @@ private:
     };
 
     /**
-     * 序列化事件用于异步队列
+     * 订阅者快照, 发布后不再修改
+     */
+    struct SubscriberList {
+        std::vector<Subscriber> subscribers;
+        SubscriberList* next_retired = nullptr;
+    };
+
+    // 异步队列槽位大小: 能放下任意一种事件
+    static constexpr size_t EVENT_SLOT_SIZE = std::max({sizeof(Event), sizeof(UserEvent), sizeof(ConnectionEvent),
+                                                        sizeof(AudioDataEvent), sizeof(DisplayEvent), sizeof(ErrorEvent)});
+
+    /**
+     * 异步事件槽位 (事件原位构造在 storage 中)
+     */
+    struct Slot {
+        Event* event = nullptr;
+        alignas(std::max_align_t) uint8_t storage[EVENT_SLOT_SIZE];
+    };
+
+    /**
+     * 异步队列元素: slot 为 nullptr 时表示取 pending_[type] 中合并后的事件
      */
-    struct QueuedEvent {
+    struct QueueItem {
         EventType type;
-        uint32_t timestamp;
-        // 简化: 仅支持基本事件数据
-        int error_code;
-        char message[128];
-        char emotion[32];
-        char text[256];
+        Slot* slot;
     };
 
+    Slot* AcquireSlot(EventType type, TickType_t wait);
+    void Enqueue(Slot* slot);
+    void ReleaseSlot(Slot* slot);
+
     void EventLoopTask();
 
-    // 订阅者映射: EventType -> vector<Subscriber>
-    std::map<EventType, std::vector<Subscriber>> subscribers_;
+    // 替换某类型的快照, 旧快照进入待释放链表 (需持有 mutex_)
+    void Publish(size_t index, SubscriberList* list);
+    // 没有 Emit 在执行时释放旧快照 (需持有 mutex_)
+    void ReclaimRetired();
+    void ExitReader();
+
+    // 订阅者快照: 下标为 EventType, 没有订阅者时为 nullptr
+    std::array<std::atomic<SubscriberList*>, static_cast<size_t>(EventType::EVENT_TYPE_MAX)> subscribers_{};
+
+    // 正在读取快照的 Emit 数量 (包括嵌套调用)
+    mutable std::atomic<int> active_readers_{0};
 
-    // 保护订阅者列表的互斥锁
+    // 等待释放的旧快照
+    SubscriberList* retired_ = nullptr;
+    std::atomic<bool> has_retired_{false};
+
+    // 串行化订阅者列表的修改, Emit 不使用
     mutable SemaphoreHandle_t mutex_;
 
-    // 异步事件队列
+    // 异步事件队列 (QueueItem) 与空闲槽位队列 (Slot*), 槽位数即队列容量
     QueueHandle_t event_queue_;
+    QueueHandle_t free_slots_;
+    Slot* slots_ = nullptr;
+
+    // 可合并事件: 每个类型最多一个排队中的槽位, 由 queue_mutex_ 保护
+    std::array<Slot*, static_cast<size_t>(EventType::EVENT_TYPE_MAX)> pending_{};
+    mutable SemaphoreHandle_t queue_mutex_;
+    EventQueueStatistics queue_stats_;
 
     // 事件循环任务句柄
     TaskHandle_t event_loop_task_ = nullptr;
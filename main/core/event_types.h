@@ -14,6 +14,8 @@
 #include <cstdint>
 #include <functional>
 
+#include "audio_stream_packet.h"
+
 /**
  * 事件类型定义
  *
@@ -104,7 +106,7 @@ struct ConnectionEvent : Event {
  * 音频数据事件
  */
 struct AudioDataEvent : Event {
-    std::vector<uint8_t> data;
+    AudioStreamPacketPtr packet;  // 与解码队列共享同一个数据包, 不拷贝
     uint32_t sequence = 0;
     int duration_ms = 0;
 
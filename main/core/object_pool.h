@@ -0,0 +1,127 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <esp_heap_caps.h>
+
+/**
+ * 对象池统计
+ */
+struct ObjectPoolStatistics {
+    size_t capacity = 0;            // 预分配对象数量
+    size_t in_use = 0;              // 当前借出数量 (含池外分配)
+    size_t high_water = 0;          // 借出数量峰值
+    uint32_t fallback_allocations = 0;  // 池耗尽时的堆分配次数
+};
+
+/**
+ * 固定容量对象池
+ *
+ * 功能:
+ * - 启动时一次性构造 capacity 个对象, 之后 Acquire()/Release() 只移动空闲索引
+ * - 对象归还后保留其内部缓冲 (如 std::vector 的容量), 稳态下不再触发堆分配
+ * - 池耗尽时退化为 new/delete 并计数, 不会阻塞或失败
+ * - 对象存储可指定内存类型 (如 MALLOC_CAP_SPIRAM), 分配失败时退回默认堆
+ *
+ * 对象的字段复位由调用方在 Release() 之前完成 (见各自的 Deleter).
+ */
+template <typename T>
+class ObjectPool {
+public:
+    explicit ObjectPool(size_t capacity, uint32_t caps = MALLOC_CAP_DEFAULT) {
+        storage_ = static_cast<T*>(heap_caps_aligned_alloc(alignof(T), capacity * sizeof(T), caps));
+        if (storage_ == nullptr && caps != MALLOC_CAP_DEFAULT) {
+            storage_ = static_cast<T*>(heap_caps_aligned_alloc(alignof(T), capacity * sizeof(T), MALLOC_CAP_DEFAULT));
+        }
+        capacity_ = storage_ != nullptr ? capacity : 0;
+        free_list_.reserve(capacity_);
+        for (size_t i = capacity_; i > 0; --i) {
+            new (&storage_[i - 1]) T();
+            free_list_.push_back(i - 1);
+        }
+        statistics_.capacity = capacity_;
+    }
+
+    ~ObjectPool() {
+        for (size_t i = 0; i < capacity_; ++i) {
+            storage_[i].~T();
+        }
+        heap_caps_free(storage_);
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    /**
+     * 对空闲对象执行初始化 (例如预留缓冲容量)
+     * @param count 只初始化最先借出的 count 个对象, 其余对象的缓冲在首次使用时增长并保留
+     */
+    void Prepare(const std::function<void(T&)>& init, size_t count = SIZE_MAX) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = free_list_.rbegin(); it != free_list_.rend() && count > 0; ++it, --count) {
+            init(storage_[*it]);
+        }
+    }
+
+    T* Acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (++statistics_.in_use > statistics_.high_water) {
+                statistics_.high_water = statistics_.in_use;
+            }
+            if (!free_list_.empty()) {
+                size_t index = free_list_.back();
+                free_list_.pop_back();
+                return &storage_[index];
+            }
+            statistics_.fallback_allocations++;
+        }
+        return new T();
+    }
+
+    void Release(T* object) {
+        if (object == nullptr) {
+            return;
+        }
+        if (!Owns(object)) {
+            delete object;
+            std::lock_guard<std::mutex> lock(mutex_);
+            statistics_.in_use--;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_list_.push_back(object - storage_);
+        statistics_.in_use--;
+    }
+
+    ObjectPoolStatistics GetStatistics() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return statistics_;
+    }
+
+    void ResetStatistics() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        statistics_.high_water = statistics_.in_use;
+        statistics_.fallback_allocations = 0;
+    }
+
+private:
+    bool Owns(const T* object) const {
+        return capacity_ > 0 && object >= storage_ && object < storage_ + capacity_;
+    }
+
+    T* storage_ = nullptr;
+    size_t capacity_ = 0;
+    std::vector<size_t> free_list_;
+    mutable std::mutex mutex_;
+    ObjectPoolStatistics statistics_;
+};
+
+#endif // OBJECT_POOL_H
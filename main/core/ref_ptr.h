@@ -0,0 +1,119 @@
+#ifndef REF_PTR_H
+#define REF_PTR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * 侵入式引用计数基类
+ *
+ * 计数保存在对象内部, 复制 RefPtr 只做一次原子加减, 不需要额外的控制块分配
+ * (std::shared_ptr 每次 make/构造都会分配控制块).
+ */
+class RefCounted {
+public:
+    RefCounted() = default;
+    RefCounted(const RefCounted&) = delete;
+    RefCounted& operator=(const RefCounted&) = delete;
+
+    uint32_t use_count() const { return ref_count_.load(std::memory_order_relaxed); }
+
+private:
+    template <typename T, typename Releaser> friend class RefPtr;
+
+    std::atomic<uint32_t> ref_count_{0};
+};
+
+/**
+ * 引用计数智能指针
+ *
+ * - 可复制: 多个持有者 (协议层, 事件总线, 解码任务) 共享同一个对象, 不复制数据
+ * - 可移动: 移动不改变计数, 用法与 std::unique_ptr 相同
+ * - 最后一个引用释放时调用 Releaser (例如归还到对象池)
+ *
+ * @tparam T 派生自 RefCounted 的类型
+ * @tparam Releaser 释放函数对象, 签名 void(T*)
+ */
+template <typename T, typename Releaser>
+class RefPtr {
+public:
+    RefPtr() = default;
+    RefPtr(std::nullptr_t) {}
+
+    // 接管一个新对象 (计数从 0 变为 1)
+    explicit RefPtr(T* object) : object_(object) {
+        AddRef();
+    }
+
+    RefPtr(const RefPtr& other) : object_(other.object_) {
+        AddRef();
+    }
+
+    RefPtr(RefPtr&& other) noexcept : object_(other.object_) {
+        other.object_ = nullptr;
+    }
+
+    ~RefPtr() {
+        Release();
+    }
+
+    RefPtr& operator=(const RefPtr& other) {
+        if (object_ != other.object_) {
+            RefPtr(other).swap(*this);
+        }
+        return *this;
+    }
+
+    RefPtr& operator=(RefPtr&& other) noexcept {
+        if (this != &other) {
+            Release();
+            object_ = other.object_;
+            other.object_ = nullptr;
+        }
+        return *this;
+    }
+
+    RefPtr& operator=(std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    void reset() {
+        Release();
+        object_ = nullptr;
+    }
+
+    void swap(RefPtr& other) noexcept {
+        std::swap(object_, other.object_);
+    }
+
+    T* get() const { return object_; }
+    T* operator->() const { return object_; }
+    T& operator*() const { return *object_; }
+    explicit operator bool() const { return object_ != nullptr; }
+
+    // 当前持有者数量, 1 表示独占
+    uint32_t use_count() const { return object_ ? object_->ref_count_.load(std::memory_order_relaxed) : 0; }
+
+    friend bool operator==(const RefPtr& ptr, std::nullptr_t) { return ptr.object_ == nullptr; }
+    friend bool operator!=(const RefPtr& ptr, std::nullptr_t) { return ptr.object_ != nullptr; }
+
+private:
+    void AddRef() {
+        if (object_ != nullptr) {
+            object_->ref_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Release() {
+        if (object_ != nullptr && object_->ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Releaser()(object_);
+        }
+    }
+
+    T* object_ = nullptr;
+};
+
+#endif // REF_PTR_H
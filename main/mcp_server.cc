@@ -85,6 +85,44 @@ void McpServer::AddCommonTools() {
             return true;
         });
     
+    AddTool("self.audio_speaker.loopback_test",
+        "Play two short chirps through the speaker and record them with the microphone to measure the audio latency "
+        "and the clock drift of this device. Only use this tool when the user or an operator asks for an audio self-test.\n"
+        "Return:\n"
+        "  A JSON object with the round trip latency and its parts in microseconds and the clock drift in ppm.",
+        PropertyList(),
+        [&board](const PropertyList& properties) -> ReturnValue {
+            LoopbackTestResult result;
+            Application::GetInstance().RunAudioLoopbackTest(result);
+
+            auto root = cJSON_CreateObject();
+            cJSON_AddBoolToObject(root, "success", result.success);
+            cJSON_AddStringToObject(root, "board", board.GetBoardType().c_str());
+            cJSON_AddStringToObject(root, "codec", board.GetAudioCodec()->name());
+            if (!result.success) {
+                cJSON_AddStringToObject(root, "message", result.error);
+            } else {
+                cJSON_AddNumberToObject(root, "input_sample_rate", result.input_sample_rate);
+                cJSON_AddNumberToObject(root, "output_sample_rate", result.output_sample_rate);
+                cJSON_AddNumberToObject(root, "round_trip_us", result.round_trip_us);
+                cJSON_AddNumberToObject(root, "output_buffer_us", result.output_buffer_us);
+                cJSON_AddNumberToObject(root, "playback_to_capture_us", result.playback_to_capture_us);
+                if (result.has_reference) {
+                    cJSON_AddNumberToObject(root, "reference_us", result.reference_us);
+                    cJSON_AddNumberToObject(root, "acoustic_us", result.acoustic_us);
+                }
+                if (result.drift_valid) {
+                    cJSON_AddNumberToObject(root, "drift_ppm", result.drift_ppm);
+                }
+                cJSON_AddNumberToObject(root, "correlation", result.correlation);
+            }
+            auto json_str = cJSON_PrintUnformatted(root);
+            std::string json(json_str);
+            cJSON_free(json_str);
+            cJSON_Delete(root);
+            return json;
+        });
+
     auto backlight = board.GetBacklight();
     if (backlight) {
         AddTool("self.screen.set_brightness",
@@ -1,4 +1,5 @@
 #include "protocol.h"
+#include "board.h"
 
 #include <esp_log.h>
 
@@ -8,7 +9,7 @@ void Protocol::OnIncomingJson(std::function<void(const cJSON* root)> callback) {
     on_incoming_json_ = callback;
 }
 
-void Protocol::OnIncomingAudio(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> callback) {
+void Protocol::OnIncomingAudio(std::function<void(AudioStreamPacketPtr packet)> callback) {
     on_incoming_audio_ = callback;
 }
 
@@ -80,3 +81,25 @@ bool Protocol::IsTimeout() const {
     }
     return timeout;
 }
+
+int Protocol::GetPreferredFrameDuration() const {
+    if (Board::GetInstance().GetBoardType() == "ml307") {
+        return PROTOCOL_FRAME_DURATION_CELLULAR_MS;
+    }
+    return PROTOCOL_FRAME_DURATION_WIFI_MS;
+}
+
+void Protocol::NegotiateFrameDuration(const cJSON* frame_duration) {
+    if (!cJSON_IsNumber(frame_duration)) {
+        server_frame_duration_ = requested_frame_duration_;
+        ESP_LOGI(TAG, "Server did not confirm frame duration, using requested %d ms", server_frame_duration_);
+        return;
+    }
+    int duration = frame_duration->valueint;
+    if (duration != 20 && duration != 40 && duration != 60) {
+        ESP_LOGW(TAG, "Unsupported server frame duration %d ms, using %d ms", duration, PROTOCOL_FRAME_DURATION_DEFAULT_MS);
+        duration = PROTOCOL_FRAME_DURATION_DEFAULT_MS;
+    }
+    server_frame_duration_ = duration;
+    ESP_LOGI(TAG, "Frame duration: requested %d ms, negotiated %d ms", requested_frame_duration_, server_frame_duration_);
+}
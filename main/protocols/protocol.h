@@ -14,18 +14,14 @@
 #include <functional>
 #include <chrono>
 #include <vector>
+#include <memory>
 
-struct AudioStreamPacket {
-    int sample_rate = 0;
-    int frame_duration = 0;
-    uint32_t timestamp = 0;
-    std::vector<uint8_t> payload;
-};
+#include "audio_stream_packet.h"
 
 struct BinaryProtocol2 {
     uint16_t version;
     uint16_t type;          // Message type (0: OPUS, 1: JSON)
-    uint32_t reserved;      // Reserved for future use
+    uint32_t reserved;      // Uplink: uncertainty of timestamp in microseconds (server-side AEC), otherwise 0
     uint32_t timestamp;     // Timestamp in milliseconds (used for server-side AEC)
     uint32_t payload_size;  // Payload size in bytes
     uint8_t payload[];      // Payload data
@@ -38,6 +34,12 @@ struct BinaryProtocol3 {
     uint8_t payload[];
 } __attribute__((packed));
 
+// 会话帧时长 (ms): Wi-Fi 用短帧降低端到端延迟, 4G 模组经 AT 指令收发, 每包开销大, 保持长帧
+#define PROTOCOL_FRAME_DURATION_WIFI_MS 20
+#define PROTOCOL_FRAME_DURATION_CELLULAR_MS 60
+// 服务器不回复或回复了不支持的帧时长时使用
+#define PROTOCOL_FRAME_DURATION_DEFAULT_MS 60
+
 enum AbortReason {
     kAbortReasonNone,
     kAbortReasonWakeWordDetected
@@ -56,6 +58,7 @@ public:
     inline int server_sample_rate() const {
         return server_sample_rate_;
     }
+    // 本会话协商的帧时长, 上下行共用
     inline int server_frame_duration() const {
         return server_frame_duration_;
     }
@@ -63,7 +66,7 @@ public:
         return session_id_;
     }
 
-    void OnIncomingAudio(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> callback);
+    void OnIncomingAudio(std::function<void(AudioStreamPacketPtr packet)> callback);
     void OnIncomingJson(std::function<void(const cJSON* root)> callback);
     void OnAudioChannelOpened(std::function<void()> callback);
     void OnAudioChannelClosed(std::function<void()> callback);
@@ -73,7 +76,7 @@ public:
     virtual bool OpenAudioChannel() = 0;
     virtual void CloseAudioChannel() = 0;
     virtual bool IsAudioChannelOpened() const = 0;
-    virtual bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) = 0;
+    virtual bool SendAudio(AudioStreamPacketPtr packet) = 0;
     virtual void SendWakeWordDetected(const std::string& wake_word);
     virtual void SendStartListening(ListeningMode mode);
     virtual void SendStopListening();
@@ -82,17 +85,29 @@ public:
 
 protected:
     std::function<void(const cJSON* root)> on_incoming_json_;
-    std::function<void(std::unique_ptr<AudioStreamPacket> packet)> on_incoming_audio_;
+    std::function<void(AudioStreamPacketPtr packet)> on_incoming_audio_;
     std::function<void()> on_audio_channel_opened_;
     std::function<void()> on_audio_channel_closed_;
     std::function<void(const std::string& message)> on_network_error_;
 
     int server_sample_rate_ = 24000;
-    int server_frame_duration_ = 60;
+    int server_frame_duration_ = PROTOCOL_FRAME_DURATION_DEFAULT_MS;
+    int requested_frame_duration_ = PROTOCOL_FRAME_DURATION_DEFAULT_MS;
     bool error_occurred_ = false;
     std::string session_id_;
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
 
+    /**
+     * hello 中请求的帧时长, 由当前网络决定
+     */
+    int GetPreferredFrameDuration() const;
+
+    /**
+     * 处理服务器 hello 中 audio_params.frame_duration
+     * 服务器确认的值作为本会话帧时长; 未返回时沿用请求值; 不支持的值回退到默认值
+     */
+    void NegotiateFrameDuration(const cJSON* frame_duration);
+
     virtual bool SendText(const std::string& text) = 0;
     virtual void SetError(const std::string& message);
     virtual bool IsTimeout() const;
@@ -69,7 +69,7 @@ bool WebsocketProtocol::Start() {
     return true;
 }
 
-bool WebsocketProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
+bool WebsocketProtocol::SendAudio(AudioStreamPacketPtr packet) {
     if (websocket_ == nullptr || !websocket_->IsConnected()) {
         return false;
     }
@@ -80,7 +80,7 @@ bool WebsocketProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
         auto bp2 = (BinaryProtocol2*)serialized.data();
         bp2->version = htons(version_);
         bp2->type = 0;
-        bp2->reserved = 0;
+        bp2->reserved = htonl(packet->timestamp_skew_us);
         bp2->timestamp = htonl(packet->timestamp);
         bp2->payload_size = htonl(packet->payload.size());
         memcpy(bp2->payload, packet->payload.data(), packet->payload.size());
@@ -176,12 +176,12 @@ bool WebsocketProtocol::OpenAudioChannel() {
                     bp2->timestamp = ntohl(bp2->timestamp);
                     bp2->payload_size = ntohl(bp2->payload_size);
                     auto payload = (uint8_t*)bp2->payload;
-                    on_incoming_audio_(std::make_unique<AudioStreamPacket>(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = bp2->timestamp,
-                        .payload = std::vector<uint8_t>(payload, payload + bp2->payload_size)
-                    }));
+                    auto packet = AudioStreamPacket::Create();
+                    packet->sample_rate = server_sample_rate_;
+                    packet->frame_duration = server_frame_duration_;
+                    packet->timestamp = bp2->timestamp;
+                    packet->AssignPayload(payload, bp2->payload_size);
+                    on_incoming_audio_(std::move(packet));
                 }
             } else if (version_ == 3) {
                 // BinaryProtocol3: type(1) + reserved(1) + payload_size(2) + payload
@@ -211,12 +211,11 @@ bool WebsocketProtocol::OpenAudioChannel() {
                     }
 
                     if (on_incoming_audio_ != nullptr) {
-                        on_incoming_audio_(std::make_unique<AudioStreamPacket>(AudioStreamPacket{
-                            .sample_rate = server_sample_rate_,
-                            .frame_duration = server_frame_duration_,
-                            .timestamp = 0,
-                            .payload = std::vector<uint8_t>(payload, payload + payload_size)
-                        }));
+                        auto packet = AudioStreamPacket::Create();
+                        packet->sample_rate = server_sample_rate_;
+                        packet->frame_duration = server_frame_duration_;
+                        packet->AssignPayload(payload, payload_size);
+                        on_incoming_audio_(std::move(packet));
                     }
                 } else if (msg_type == 0x12) {
                     // AUDIO_END: 音频结束 - 恢复心跳，打印完整统计
@@ -224,6 +223,9 @@ bool WebsocketProtocol::OpenAudioChannel() {
                     ESP_LOGI(TAG, "=== AUDIO RX STATS (heartbeat resumed) ===");
                     ESP_LOGI(TAG, "Total frames: %lu", (unsigned long)rx_frame_count_);
                     ESP_LOGI(TAG, "Total bytes: %lu", (unsigned long)rx_total_bytes_);
+                    auto copy_stats = AudioStreamPacket::GetCopyStatistics();
+                    ESP_LOGI(TAG, "Bytes copied: %lu/s (total %llu)",
+                             (unsigned long)copy_stats.bytes_per_second, (unsigned long long)copy_stats.total_bytes);
 
                     // 打印前20帧大小签名，用于和服务器对比
                     if (!rx_frame_sizes_.empty()) {
@@ -313,12 +315,11 @@ bool WebsocketProtocol::OpenAudioChannel() {
             } else {
                 // version 1: 原始音频数据
                 if (on_incoming_audio_ != nullptr) {
-                    on_incoming_audio_(std::make_unique<AudioStreamPacket>(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = 0,
-                        .payload = std::vector<uint8_t>((uint8_t*)data, (uint8_t*)data + len)
-                    }));
+                    auto packet = AudioStreamPacket::Create();
+                    packet->sample_rate = server_sample_rate_;
+                    packet->frame_duration = server_frame_duration_;
+                    packet->AssignPayload((const uint8_t*)data, len);
+                    on_incoming_audio_(std::move(packet));
                 }
             }
         } else {
@@ -414,11 +415,12 @@ std::string WebsocketProtocol::GetHelloMessage() {
     cJSON_AddBoolToObject(features, "mcp", true);
     cJSON_AddItemToObject(root, "features", features);
     cJSON_AddStringToObject(root, "transport", "websocket");
+    requested_frame_duration_ = GetPreferredFrameDuration();
     cJSON* audio_params = cJSON_CreateObject();
     cJSON_AddStringToObject(audio_params, "format", "opus");
     cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
     cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
+    cJSON_AddNumberToObject(audio_params, "frame_duration", requested_frame_duration_);
     cJSON_AddItemToObject(root, "audio_params", audio_params);
     auto json_str = cJSON_PrintUnformatted(root);
     std::string message(json_str);
@@ -454,18 +456,16 @@ void WebsocketProtocol::ParseServerHello(const cJSON* root) {
     }
 
     auto audio_params = cJSON_GetObjectItem(root, "audio_params");
+    const cJSON* frame_duration = nullptr;
     if (cJSON_IsObject(audio_params)) {
         auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
         if (cJSON_IsNumber(sample_rate)) {
             server_sample_rate_ = sample_rate->valueint;
             ESP_LOGI(TAG, "ParseServerHello: sample_rate=%d", server_sample_rate_);
         }
-        auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
-        if (cJSON_IsNumber(frame_duration)) {
-            server_frame_duration_ = frame_duration->valueint;
-            ESP_LOGI(TAG, "ParseServerHello: frame_duration=%d", server_frame_duration_);
-        }
+        frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
     }
+    NegotiateFrameDuration(frame_duration);
 
     ESP_LOGI(TAG, "ParseServerHello: setting SERVER_HELLO_EVENT");
     xEventGroupSetBits(event_group_handle_, WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT);
@@ -1,54 +1,141 @@
+import os
 import socket
+import struct
 import wave
 import argparse
 
 
 '''
-  Create a UDP socket and bind it to the server's IP:8000.
-  Listen for incoming messages and print them to the console.
-  Save the audio to a WAV file.
+  Create a UDP socket and bind it to the server's IP:PORT.
+  Receive the audio debugger packets and demultiplex the capture taps
+  into one WAV file per tap.
+
+  Packet: little-endian header followed by int16 PCM (interleaved)
+    uint32 magic 'ADBG', uint8 version, uint8 tap, uint8 channels, uint8 reserved,
+    uint32 sample_rate, uint32 sequence, int64 timestamp_us
+  Packets without the header (older firmware) are saved as raw PCM.
 '''
-def main(samplerate, channels):
+HEADER = struct.Struct('<IBBBBIIq')
+MAGIC = 0x47424441
+VERSION = 1
+# Same order as AudioDebugTap in main/audio/processors/audio_debugger.h
+TAP_NAMES = ['mic', 'reference', 'processed', 'decoded', 'output']
+
+
+class TapWriter:
+    def __init__(self, name, sample_rate, channels, output_dir, start_us):
+        suffix = f"_{channels}ch" if channels > 1 else ""
+        self.filename = os.path.join(output_dir, f"{name}_{sample_rate}{suffix}.wav")
+        self.sample_rate = sample_rate
+        self.channels = channels
+        self.wav_file = wave.open(self.filename, "wb")
+        self.wav_file.setnchannels(channels)
+        self.wav_file.setsampwidth(2)
+        self.wav_file.setframerate(sample_rate)
+        self.next_us = start_us
+        self.next_sequence = None
+        self.lost_packets = 0
+        self.silence_ms = 0
+        self.frames = 0
+
+    def write(self, sequence, timestamp_us, pcm):
+        if self.next_sequence is not None and sequence != self.next_sequence:
+            self.lost_packets += (sequence - self.next_sequence) & 0xFFFFFFFF
+        self.next_sequence = (sequence + 1) & 0xFFFFFFFF
+
+        # Fill gaps of at least one packet with silence, so all taps stay on the same timeline
+        frames = len(pcm) // (2 * self.channels)
+        duration_us = frames * 1000000 // self.sample_rate
+        gap_us = timestamp_us - self.next_us if self.next_us is not None else 0
+        if gap_us >= duration_us and gap_us > 0:
+            gap_frames = gap_us * self.sample_rate // 1000000
+            self.wav_file.writeframes(b'\x00' * (gap_frames * 2 * self.channels))
+            self.silence_ms += gap_us // 1000
+            self.frames += gap_frames
+        self.next_us = timestamp_us + duration_us
+
+        self.wav_file.writeframes(pcm)
+        self.frames += frames
+
+    def close(self):
+        self.wav_file.close()
+        print(f"WAV file '{self.filename}' saved: {self.frames * 1000 // self.sample_rate} ms, "
+              f"{self.lost_packets} packets lost, {self.silence_ms} ms silence filled")
+
+
+def main(port, output_dir, samplerate, channels, align):
     # Create a UDP socket
     server_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    server_socket.bind(('0.0.0.0', 8000))
+    server_socket.bind(('0.0.0.0', port))
+    os.makedirs(output_dir, exist_ok=True)
 
-    # Create WAV file with parameters
-    filename = f"{samplerate}_{channels}.wav"
-    wav_file = wave.open(filename, "wb")
-    wav_file.setnchannels(channels)     # channels parameter
-    wav_file.setsampwidth(2)            # 2 bytes per sample (16-bit)
-    wav_file.setframerate(samplerate)   # samplerate parameter
+    writers = {}
+    base_us = None
+    legacy_file = None
 
-    print(f"Start saving audio from 0.0.0.0:8000 to {filename}...")
+    print(f"Start saving audio from 0.0.0.0:{port} to {output_dir}...")
 
     try:
         while True:
             # Receive a message from the client
-            message, address = server_socket.recvfrom(8000)
-            
-            # Write PCM data to WAV file
-            wav_file.writeframes(message)
-
-            # Print length of the message
-            print(f"Received {len(message)} bytes from {address}")
-    
+            message, address = server_socket.recvfrom(65536)
+
+            magic = struct.unpack_from('<I', message)[0] if len(message) >= HEADER.size else None
+            if magic != MAGIC:
+                if legacy_file is None:
+                    filename = os.path.join(output_dir, f"{samplerate}_{channels}.wav")
+                    legacy_file = wave.open(filename, "wb")
+                    legacy_file.setnchannels(channels)
+                    legacy_file.setsampwidth(2)
+                    legacy_file.setframerate(samplerate)
+                    print(f"Raw PCM from {address}, saving to {filename}")
+                legacy_file.writeframes(message)
+                continue
+
+            _, version, tap, tap_channels, _, sample_rate, sequence, timestamp_us = HEADER.unpack_from(message)
+            if version != VERSION or tap_channels == 0 or sample_rate == 0:
+                print(f"Unsupported packet from {address}: version {version}")
+                continue
+            name = TAP_NAMES[tap] if tap < len(TAP_NAMES) else f"tap{tap}"
+            if base_us is None:
+                base_us = timestamp_us
+
+            writer = writers.get(tap)
+            if writer is not None and (writer.sample_rate != sample_rate or writer.channels != tap_channels):
+                writer.close()
+                writer = None
+            if writer is None:
+                # With alignment every file starts at the first packet of any tap
+                writer = TapWriter(name, sample_rate, tap_channels, output_dir, base_us if align else None)
+                writers[tap] = writer
+                print(f"Tap '{name}' from {address}: {sample_rate} Hz, {tap_channels} channel(s)")
+
+            writer.write(sequence, timestamp_us, message[HEADER.size:])
+
     except KeyboardInterrupt:
         print("\nStopping recording...")
-    
+
     finally:
         # Close files and socket
-        wav_file.close()
+        for writer in writers.values():
+            writer.close()
+        if legacy_file is not None:
+            legacy_file.close()
         server_socket.close()
-        print(f"WAV file '{filename}' saved successfully")
 
 
 if __name__ == "__main__":
-    parser = argparse.ArgumentParser(description='UDP音频数据接收器，保存为WAV文件')
-    parser.add_argument('--samplerate', '-s', type=int, default=16000, 
-                        help='采样率 (默认: 16000)')
-    parser.add_argument('--channels', '-c', type=int, default=2, 
-                        help='声道数 (默认: 2)')
-    
+    parser = argparse.ArgumentParser(description='UDP音频调试数据接收器，按抓取点分别保存为WAV文件')
+    parser.add_argument('--port', '-p', type=int, default=8000,
+                        help='监听端口 (默认: 8000)')
+    parser.add_argument('--output-dir', '-o', default='.',
+                        help='WAV 文件目录 (默认: 当前目录)')
+    parser.add_argument('--no-align', action='store_true',
+                        help='不在各文件开头和间断处补静音对齐时间轴')
+    parser.add_argument('--samplerate', '-s', type=int, default=16000,
+                        help='无包头的原始 PCM 的采样率 (默认: 16000)')
+    parser.add_argument('--channels', '-c', type=int, default=2,
+                        help='无包头的原始 PCM 的声道数 (默认: 2)')
+
     args = parser.parse_args()
-    main(args.samplerate, args.channels)
+    main(args.port, args.output_dir, args.samplerate, args.channels, not args.no_align)
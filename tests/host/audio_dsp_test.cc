@@ -0,0 +1,144 @@
+#include "host_test.h"
+
+#include "dsp/audio_dsp.h"
+
+#include <algorithm>
+#include <vector>
+
+using audio_dsp::kUnityGain;
+
+HOST_TEST(AudioDspInterleaveRoundTrip) {
+    // Odd frame count, the SIMD paths finish the tail with the scalar kernel
+    const size_t frames = 13;
+    std::vector<int16_t> stereo(frames * 2), left(frames), right(frames), back(frames * 2);
+    for (size_t i = 0; i < stereo.size(); i++) {
+        stereo[i] = (int16_t)(i * 2521 - 16000);
+    }
+    audio_dsp::Deinterleave2(stereo.data(), left.data(), right.data(), frames);
+    for (size_t i = 0; i < frames; i++) {
+        CHECK_EQ(left[i], stereo[2 * i]);
+        CHECK_EQ(right[i], stereo[2 * i + 1]);
+    }
+    audio_dsp::Interleave2(left.data(), right.data(), back.data(), frames);
+    CHECK(back == stereo);
+
+    std::vector<int16_t> channel(frames);
+    audio_dsp::ExtractChannel(stereo.data(), channel.data(), frames, 2, 1);
+    CHECK(channel == right);
+    // In place, as AudioInputTask does it
+    audio_dsp::ExtractChannel(stereo.data(), stereo.data(), frames, 2, 0);
+    CHECK(std::equal(left.begin(), left.end(), stereo.begin()));
+}
+
+HOST_TEST(AudioDspDownmixHalvesEachChannel) {
+    const int16_t stereo[] = {INT16_MAX, INT16_MAX, INT16_MIN, INT16_MIN, 1, 1, -1, -1, -3, 3, 101, -50};
+    int16_t mono[6];
+    audio_dsp::DownmixStereo(stereo, mono, 6);
+    // Each channel is shifted before the sum, so it never overflows and rounds towards minus infinity
+    CHECK_EQ(mono[0], INT16_MAX - 1);
+    CHECK_EQ(mono[1], INT16_MIN);
+    CHECK_EQ(mono[2], 0);
+    CHECK_EQ(mono[3], -2);
+    CHECK_EQ(mono[4], -1);
+    CHECK_EQ(mono[5], 25);
+}
+
+HOST_TEST(AudioDspApplyGain) {
+    const int16_t input[] = {3, -3, 20000, -20000, INT16_MIN, INT16_MAX};
+    int16_t output[6];
+
+    audio_dsp::ApplyGain(input, output, 6, kUnityGain);
+    CHECK(std::equal(input, input + 6, output));
+
+    // Half gain: the shift rounds towards minus infinity
+    audio_dsp::ApplyGain(input, output, 6, kUnityGain / 2);
+    CHECK_EQ(output[0], 1);
+    CHECK_EQ(output[1], -2);
+    CHECK_EQ(output[2], 10000);
+    CHECK_EQ(output[4], -16384);
+
+    // +6 dB saturates, larger gains are clamped to 65535
+    audio_dsp::ApplyGain(input, output, 6, 1000000);
+    CHECK_EQ(output[0], 5);
+    CHECK_EQ(output[2], INT16_MAX);
+    CHECK_EQ(output[3], INT16_MIN);
+    CHECK_EQ(output[5], INT16_MAX);
+
+    // An inverted full-scale negative sample saturates instead of wrapping
+    audio_dsp::ApplyGain(input, output, 6, -kUnityGain);
+    CHECK_EQ(output[1], 3);
+    CHECK_EQ(output[4], INT16_MAX);
+    CHECK_EQ(output[5], -INT16_MAX);
+
+    // Odd gain, in place
+    int16_t samples[] = {1000, -1000};
+    audio_dsp::ApplyGain(samples, samples, 2, 12345);
+    CHECK_EQ(samples[0], (1000 * 12345) >> 15);
+    CHECK_EQ(samples[1], (-1000 * 12345) >> 15);
+}
+
+HOST_TEST(AudioDspMixSaturate) {
+    int16_t dst[] = {30000, -30000, 16384, 1000, -7};
+    const int16_t src[] = {30000, -30000, 0, -1000, 0};
+    audio_dsp::MixSaturate(dst, src, 5, kUnityGain, kUnityGain);
+    CHECK_EQ(dst[0], INT16_MAX);
+    CHECK_EQ(dst[1], INT16_MIN);
+    CHECK_EQ(dst[2], 16384);
+    CHECK_EQ(dst[3], 0);
+    CHECK_EQ(dst[4], -7);
+}
+
+HOST_TEST(AudioDspMixOddGainRoundsToEven) {
+    // The gains are applied as half gains in Q14, an odd gain acts as the even gain below it
+    int16_t odd[] = {16384, -16384, 12345};
+    int16_t even[] = {16384, -16384, 12345};
+    const int16_t src[] = {0, 0, 0};
+    audio_dsp::MixSaturate(odd, src, 3, kUnityGain - 1, 0);
+    audio_dsp::MixSaturate(even, src, 3, kUnityGain - 2, 0);
+    CHECK(std::equal(odd, odd + 3, even));
+    CHECK_EQ(odd[0], 16383);
+    CHECK_EQ(odd[1], -16383);
+
+    // Gains outside [0, unity] are clamped
+    int16_t dst[] = {1000};
+    const int16_t other[] = {2000};
+    audio_dsp::MixSaturate(dst, other, 1, -kUnityGain, 2 * kUnityGain);
+    CHECK_EQ(dst[0], 2000);
+}
+
+HOST_TEST(AudioDspWidenNarrow) {
+    const int16_t input[] = {INT16_MIN, -1, 0, 1, 12345, INT16_MAX};
+    int32_t wide[6];
+    audio_dsp::Widen16To32(input, wide, 6, kUnityGain);
+    for (int i = 0; i < 6; i++) {
+        CHECK_EQ(wide[i], (int32_t)input[i] * 65536);
+    }
+    // Above unity is clamped, it could overflow
+    int32_t clamped[6];
+    audio_dsp::Widen16To32(input, clamped, 6, 2 * kUnityGain);
+    CHECK(std::equal(wide, wide + 6, clamped));
+
+    audio_dsp::Widen16To32(input, wide, 6, 12345);
+    CHECK_EQ(wide[4], 12345 * 12345 * 2);
+    CHECK_EQ(wide[0], -32768 * 12345 * 2);
+
+    // The round trip is exact, except that full-scale negative saturates symmetrically
+    int16_t narrow[6];
+    audio_dsp::Widen16To32(input, wide, 6, kUnityGain);
+    audio_dsp::Narrow32To16(wide, narrow, 6, 16);
+    CHECK_EQ(narrow[0], -INT16_MAX);
+    CHECK(std::equal(input + 1, input + 6, narrow + 1));
+
+    // 24-bit samples in a 32-bit slot, with a smaller shift that saturates
+    const int32_t samples[] = {0x7fffff00, -0x7fffff00, 0x00012300, -0x00000100};
+    audio_dsp::Narrow32To16(samples, narrow, 4, 8);
+    CHECK_EQ(narrow[0], INT16_MAX);
+    CHECK_EQ(narrow[1], -INT16_MAX);
+    CHECK_EQ(narrow[2], 0x123);
+    CHECK_EQ(narrow[3], -1);
+}
+
+HOST_TEST(AudioDspNoSimdOnHost) {
+    CHECK(!audio_dsp::SelfTest());
+    CHECK(!audio_dsp::simd_enabled());
+}
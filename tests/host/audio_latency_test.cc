@@ -0,0 +1,42 @@
+#include "host_test.h"
+
+#include "audio_latency.h"
+
+#include <string>
+
+HOST_TEST(LatencyRecorderBuckets) {
+    LatencyRecorder recorder;
+    for (int i = 0; i < 90; i++) {
+        recorder.Add(4000);     // 5ms bucket
+    }
+    for (int i = 0; i < 10; i++) {
+        recorder.Add(150000);   // 200ms bucket
+    }
+    auto histogram = recorder.Get();
+    CHECK_EQ(histogram.count, 100);
+    CHECK_EQ(histogram.max_us, 150000);
+    CHECK_EQ(histogram.buckets[2], 90);
+    CHECK_EQ(histogram.buckets[7], 10);
+    CHECK_EQ(histogram.PercentileUs(50), 5000);
+    CHECK_EQ(histogram.PercentileUs(90), 5000);
+    CHECK_EQ(histogram.PercentileUs(95), 200000);
+}
+
+HOST_TEST(LatencyRecorderOverflowUsesMax) {
+    LatencyRecorder recorder;
+    recorder.Add(-5);
+    recorder.Add(3500000);
+    auto histogram = recorder.Get();
+    CHECK_EQ(histogram.buckets[0], 1);
+    CHECK_EQ(histogram.buckets[AUDIO_LATENCY_BUCKETS - 1], 1);
+    CHECK_EQ(histogram.PercentileUs(100), 3500000);
+
+    recorder.Reset();
+    CHECK_EQ(recorder.Get().count, 0);
+    CHECK_EQ(recorder.Get().PercentileUs(50), 0);
+}
+
+HOST_TEST(LatencyStageNames) {
+    CHECK(std::string(AudioLatencyStageName(kAudioLatencyDownlink)) == "downlink");
+    CHECK(std::string(AudioLatencyStageName(kAudioLatencyStageCount)) == "unknown");
+}
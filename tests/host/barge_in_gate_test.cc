@@ -0,0 +1,81 @@
+#include "host_test.h"
+
+#include "barge_in_gate.h"
+
+static AudioStreamPacketPtr Packet(uint32_t timestamp) {
+    auto packet = AudioStreamPacket::Create();
+    packet->frame_duration = 60;
+    packet->timestamp = timestamp;
+    packet->payload.assign(40, 0);
+    return packet;
+}
+
+HOST_TEST(BargeInGateHoldsSilence) {
+    BargeInGate gate;
+    std::vector<AudioStreamPacketPtr> out;
+    for (int i = 0; i < 20; i++) {
+        CHECK(!gate.Feed(Packet(i * 60), false, i * 60000LL, out));
+    }
+    CHECK(out.empty());
+    CHECK_EQ(gate.GetStatistics().input_packets, 20);
+}
+
+HOST_TEST(BargeInGateSendsPrerollThenTriggers) {
+    BargeInGate gate;
+    std::vector<AudioStreamPacketPtr> out;
+    int i = 0;
+    for (; i < 10; i++) {
+        gate.Feed(Packet(i * 60), false, i * 60000LL, out);
+    }
+    // Voice starts: the pre-roll (at most BARGE_IN_PREROLL_MS) goes out first, in order
+    gate.Feed(Packet(i * 60), true, i * 60000LL, out);
+    size_t preroll = BARGE_IN_PREROLL_MS / 60 + 1;
+    CHECK_EQ(out.size(), preroll);
+    for (size_t j = 1; j < out.size(); j++) {
+        CHECK(out[j]->timestamp > out[j - 1]->timestamp);
+    }
+    CHECK_EQ(out.back()->timestamp, i * 60);
+
+    int triggers = 0;
+    int64_t voice_start = i * 60000LL;
+    for (i++; i < 30; i++) {
+        if (gate.Feed(Packet(i * 60), true, i * 60000LL, out)) {
+            triggers++;
+            CHECK(i * 60000LL - voice_start >= BARGE_IN_TRIGGER_MS * 1000);
+        }
+    }
+    CHECK_EQ(triggers, 1);
+    CHECK_EQ(gate.GetStatistics().bursts, 1);
+    CHECK_EQ(gate.GetStatistics().triggers, 1);
+}
+
+HOST_TEST(BargeInGateHangoverThenCloses) {
+    BargeInGate gate;
+    std::vector<AudioStreamPacketPtr> out;
+    gate.Feed(Packet(0), true, 0, out);
+    out.clear();
+    int sent_after_voice = 0;
+    for (int i = 1; i < 20; i++) {
+        gate.Feed(Packet(i * 60), false, i * 60000LL, out);
+        sent_after_voice = out.size();
+    }
+    CHECK_EQ(sent_after_voice, BARGE_IN_HANGOVER_MS / 60);
+}
+
+HOST_TEST(BargeInGateBacksOffAfterSendFailure) {
+    BargeInGate gate;
+    std::vector<AudioStreamPacketPtr> out;
+    gate.OnSendFailure(0);
+    bool triggered = false;
+    for (int i = 0; i < 10; i++) {
+        triggered |= gate.Feed(Packet(i * 60), true, i * 60000LL, out);
+    }
+    // Still detects the barge-in, but sends nothing during the backoff
+    CHECK(triggered);
+    CHECK(out.empty());
+    CHECK_EQ(gate.GetStatistics().backoff_drops, 10);
+
+    int64_t after = BARGE_IN_BACKOFF_MS * 1000LL;
+    gate.Feed(Packet(0), true, after, out);
+    CHECK_EQ(out.size(), 1);
+}
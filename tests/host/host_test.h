@@ -0,0 +1,47 @@
+// Minimal test registry for the host build, no external dependencies
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+struct HostTest {
+    const char* name;
+    std::function<void()> body;
+};
+
+std::vector<HostTest>& HostTests();
+// Failed checks of the running test
+int& HostTestFailures();
+
+struct HostTestRegistrar {
+    HostTestRegistrar(const char* name, std::function<void()> body) {
+        HostTests().push_back({name, std::move(body)});
+    }
+};
+
+#define HOST_TEST(name) \
+    static void name(); \
+    static HostTestRegistrar name##_registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            HostTestFailures()++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        long long a_ = (long long)(a); \
+        long long b_ = (long long)(b); \
+        if (a_ != b_) { \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, a_, b_); \
+            HostTestFailures()++; \
+        } \
+    } while (0)
+
+#endif // HOST_TEST_H
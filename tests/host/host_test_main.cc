@@ -0,0 +1,36 @@
+#include "host_test.h"
+
+#include <cstring>
+
+std::vector<HostTest>& HostTests() {
+    static std::vector<HostTest> tests;
+    return tests;
+}
+
+int& HostTestFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+// Usage: audio_host_tests [name-filter]
+int main(int argc, char* argv[]) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0;
+    int failed = 0;
+    for (auto& test : HostTests()) {
+        if (filter != nullptr && strstr(test.name, filter) == nullptr) {
+            continue;
+        }
+        HostTestFailures() = 0;
+        test.body();
+        run++;
+        if (HostTestFailures() > 0) {
+            failed++;
+            fprintf(stderr, "[FAIL] %s\n", test.name);
+        } else {
+            printf("[ OK ] %s\n", test.name);
+        }
+    }
+    printf("%d tests, %d failed\n", run, failed);
+    return (run == 0 || failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+#include "host_test.h"
+
+#include "jitter_buffer.h"
+
+HOST_TEST(JitterBufferInitialTarget) {
+    JitterBuffer buffer;
+    CHECK_EQ(buffer.target_frames(), JITTER_BUFFER_INITIAL_MS / JITTER_BUFFER_DEFAULT_FRAME_MS);
+    CHECK(!buffer.stream_active());
+}
+
+HOST_TEST(JitterBufferSteadyArrivalKeepsMinimum) {
+    JitterBuffer buffer;
+    buffer.StartStream(0);
+    for (int i = 0; i < 50; i++) {
+        buffer.OnPacketArrival(i * 60000LL, 60);
+    }
+    // No delay: one frame on top of the minimum depth
+    CHECK_EQ(buffer.target_frames(), JITTER_BUFFER_MIN_MS / 60);
+    CHECK_EQ(buffer.GetStatistics().jitter_ms, 0);
+}
+
+HOST_TEST(JitterBufferLateBurstRaisesTarget) {
+    JitterBuffer buffer;
+    buffer.StartStream(0);
+    int64_t now = 0;
+    for (int i = 0; i < 20; i++) {
+        // Every fifth packet is 600ms late, the next ones follow right behind it
+        now = i * 60000LL + (i % 5 == 4 ? 600000 : 0);
+        buffer.OnPacketArrival(now, 60);
+    }
+    auto stats = buffer.GetStatistics();
+    CHECK(stats.peak_delay_ms >= 500);
+    CHECK(buffer.target_frames() >= 600 / 60 + 1);
+    CHECK(buffer.target_frames() <= JITTER_BUFFER_MAX_MS / 60);
+}
+
+HOST_TEST(JitterBufferTargetFollowsFrameDuration) {
+    JitterBuffer buffer;
+    buffer.StartStream(0);
+    for (int i = 0; i < 10; i++) {
+        buffer.OnPacketArrival(i * 20000LL + (i == 5 ? 200000 : 0), 20);
+    }
+    auto stats = buffer.GetStatistics();
+    CHECK_EQ(stats.frame_duration_ms, 20);
+    CHECK_EQ(stats.target_ms, stats.target_frames * 20);
+    CHECK(stats.target_ms >= 200);
+}
+
+HOST_TEST(JitterBufferUnderrunMarginGrowsAndShrinks) {
+    JitterBuffer buffer;
+    buffer.StartStream(0);
+    buffer.OnPacketArrival(0, 60);
+    int before = buffer.target_frames();
+    buffer.OnPlaybackStarted(300000);
+    buffer.OnUnderrun(1000000);
+    buffer.OnPlaybackStarted(1240000);
+    CHECK(buffer.target_frames() > before);
+
+    auto stats = buffer.GetStatistics();
+    CHECK_EQ(stats.underruns, 1);
+    CHECK_EQ(stats.rebuffer_ms, 240);
+    CHECK_EQ(stats.last_time_to_first_audio_ms, 300);
+    CHECK_EQ(stats.streams, 1);
+
+    for (int i = 0; i < JITTER_BUFFER_UNDERRUN_STEP_MS / 60 * JITTER_BUFFER_SHRINK_INTERVAL_MS / 60; i++) {
+        buffer.OnFramePlayed();
+    }
+    CHECK_EQ(buffer.target_frames(), before);
+}
+
+HOST_TEST(JitterBufferKeepsDepthAcrossStreams) {
+    JitterBuffer buffer;
+    buffer.StartStream(0);
+    buffer.OnPacketArrival(0, 60);
+    buffer.OnPacketArrival(60000 + 900000, 60);
+    int learned = buffer.target_frames();
+    buffer.EndStream();
+    CHECK(!buffer.stream_active());
+
+    buffer.StartStream(10000000);
+    CHECK(buffer.stream_active());
+    CHECK_EQ(buffer.target_frames(), learned);
+}
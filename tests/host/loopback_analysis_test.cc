@@ -0,0 +1,103 @@
+#include "host_test.h"
+
+#include "loopback_analysis.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// The played signal at t seconds after the output started. The chirp is sampled at a fine rate,
+// so a delay or a clock drift does not have to be a whole number of samples.
+static double PlayedAt(double t) {
+    const int fine_rate = 16000000;
+    const double starts[] = {LOOPBACK_TEST_LEAD_MS / 1000.0,
+                             (LOOPBACK_TEST_LEAD_MS + LOOPBACK_TEST_CHIRP_INTERVAL_MS) / 1000.0};
+    for (double start : starts) {
+        if (t >= start && t < start + LOOPBACK_TEST_CHIRP_MS / 1000.0) {
+            return LoopbackChirpSample((size_t)llround((t - start) * fine_rate), fine_rate);
+        }
+    }
+    return 0;
+}
+
+// Recording of the played signal, delay_s late, on an input clock drift_ppm fast, with some noise
+static std::vector<int16_t> Record(int input_rate, double delay_s, double drift_ppm, double gain) {
+    std::vector<int16_t> recording(LoopbackSignalSamples(input_rate) + input_rate / 2);
+    uint32_t noise = 1;
+    for (size_t n = 0; n < recording.size(); n++) {
+        double t = n / (input_rate * (1 + drift_ppm * 1e-6)) - delay_s;
+        noise = noise * 1664525 + 1013904223;
+        recording[n] = (int16_t)(gain * PlayedAt(t) + (int)(noise >> 23) - 256);
+    }
+    return recording;
+}
+
+static LoopbackCapture Capture(int input_rate, int output_rate, const std::vector<int16_t>& mic) {
+    LoopbackCapture capture;
+    capture.input_sample_rate = input_rate;
+    capture.output_sample_rate = output_rate;
+    capture.mic = mic.data();
+    capture.samples = mic.size();
+    // The capture starts with the output
+    capture.chirp_index = (double)input_rate * LOOPBACK_TEST_LEAD_MS / 1000;
+    capture.output_buffer_us = 40000;
+    return capture;
+}
+
+HOST_TEST(LoopbackAnalysisFindsDelay) {
+    auto mic = Record(16000, 0.0234, 0, 0.3);
+    LoopbackTestResult result;
+    CHECK(AnalyzeLoopbackCapture(Capture(16000, 16000, mic), result));
+    CHECK(result.success);
+    CHECK(abs(result.playback_to_capture_us - 23400) <= 20);
+    CHECK_EQ(result.round_trip_us, result.playback_to_capture_us + 40000);
+    CHECK(result.correlation > 0.9f);
+    CHECK(result.drift_valid);
+    CHECK(fabsf(result.drift_ppm) < 0.5f);
+    CHECK(!result.has_reference);
+}
+
+// Parabolic interpolation of the correlation peaks is biased by a few hundredths of a sample,
+// up to about 1.3 ppm over the 2 s interval
+HOST_TEST(LoopbackAnalysisMeasuresDrift) {
+    for (double drift : {150.0, -400.0, 2000.0}) {
+        auto mic = Record(16000, 0.0234, drift, 0.3);
+        LoopbackTestResult result;
+        CHECK(AnalyzeLoopbackCapture(Capture(16000, 16000, mic), result));
+        CHECK(result.drift_valid);
+        CHECK(fabs(result.drift_ppm - drift) < 1.5);
+    }
+}
+
+HOST_TEST(LoopbackAnalysisDifferentRates) {
+    auto mic = Record(16000, 0.0312, -80, 0.3);
+    LoopbackTestResult result;
+    CHECK(AnalyzeLoopbackCapture(Capture(16000, 24000, mic), result));
+    CHECK_EQ(result.output_sample_rate, 24000);
+    CHECK(abs(result.playback_to_capture_us - 31200) <= 40);
+    CHECK(fabs(result.drift_ppm + 80) < 1.5);
+}
+
+HOST_TEST(LoopbackAnalysisSplitsReference) {
+    auto mic = Record(16000, 0.0234, 0, 0.3);
+    auto reference = Record(16000, 0.0021, 0, 0.8);
+    auto capture = Capture(16000, 16000, mic);
+    capture.reference = reference.data();
+    LoopbackTestResult result;
+    CHECK(AnalyzeLoopbackCapture(capture, result));
+    CHECK(result.has_reference);
+    CHECK(abs(result.reference_us - 2100) <= 20);
+    CHECK(abs(result.acoustic_us - 21300) <= 40);
+}
+
+HOST_TEST(LoopbackAnalysisRejectsSilence) {
+    auto mic = Record(16000, 0.0234, 0, 0);
+    LoopbackTestResult result;
+    CHECK(!AnalyzeLoopbackCapture(Capture(16000, 16000, mic), result));
+    CHECK(result.error != nullptr && std::string(result.error) == "chirp not detected, check the volume");
+
+    LoopbackTestResult empty;
+    CHECK(!AnalyzeLoopbackCapture(LoopbackCapture(), empty));
+    CHECK(empty.error != nullptr && std::string(empty.error) == "no input captured");
+}
@@ -0,0 +1,95 @@
+#include "host_test.h"
+
+#include "opus_rate_controller.h"
+
+// One decision interval of 60ms frames
+static bool RunInterval(OpusRateController& controller, OpusEncoderSettings& settings, int encode_us, int queued_ms) {
+    for (int ms = 0; ms < OPUS_RATE_CONTROL_INTERVAL_MS; ms += 60) {
+        controller.OnFrameEncoded(encode_us, 60, queued_ms);
+    }
+    return controller.Update(settings);
+}
+
+static OpusRateBounds Bounds() {
+    OpusRateBounds bounds;
+    bounds.min_frame_duration_ms = 20;
+    bounds.max_frame_duration_ms = 60;
+    return bounds;
+}
+
+HOST_TEST(OpusRateBacksOffOnBacklog) {
+    OpusRateController controller;
+    OpusEncoderSettings settings;
+    settings.frame_duration_ms = 20;
+    controller.Configure(Bounds(), settings);
+
+    CHECK(RunInterval(controller, settings, 10000, OPUS_RATE_CONGESTED_QUEUE_MS));
+    CHECK_EQ(settings.bitrate, OPUS_RATE_INITIAL_BITRATE * 3 / 4);
+    CHECK(settings.dtx);
+    CHECK_EQ(settings.frame_duration_ms, 60);
+    CHECK_EQ(controller.GetStatistics().congestion_events, 1);
+
+    // Multiplicative decrease stops at the floor
+    for (int i = 0; i < 10; i++) {
+        RunInterval(controller, settings, 10000, OPUS_RATE_CONGESTED_QUEUE_MS);
+    }
+    CHECK_EQ(settings.bitrate, OPUS_RATE_MIN_BITRATE);
+}
+
+HOST_TEST(OpusRateBacksOffOnSendFailure) {
+    OpusRateController controller;
+    OpusEncoderSettings settings;
+    controller.Configure(Bounds(), settings);
+    controller.OnSendFailure();
+    CHECK(RunInterval(controller, settings, 10000, 0));
+    CHECK(settings.bitrate < OPUS_RATE_INITIAL_BITRATE);
+    CHECK_EQ(controller.GetStatistics().send_failures, 1);
+}
+
+HOST_TEST(OpusRateRecoversAfterClearIntervals) {
+    OpusRateController controller;
+    OpusEncoderSettings settings;
+    settings.bitrate = 12000;
+    settings.dtx = true;
+    settings.frame_duration_ms = 60;
+    controller.Configure(Bounds(), settings);
+
+    for (int i = 0; i < OPUS_RATE_UPGRADE_INTERVALS - 1; i++) {
+        CHECK(!RunInterval(controller, settings, 10000, 0));
+    }
+    CHECK(RunInterval(controller, settings, 10000, 0));
+    CHECK_EQ(settings.bitrate, 12000 + OPUS_RATE_BITRATE_STEP);
+    CHECK(settings.dtx);
+
+    for (int i = 0; i < OPUS_RATE_UPGRADE_INTERVALS; i++) {
+        RunInterval(controller, settings, 10000, 0);
+    }
+    CHECK_EQ(settings.bitrate, OPUS_RATE_INITIAL_BITRATE);
+    CHECK(!settings.dtx);
+    CHECK_EQ(settings.frame_duration_ms, 20);
+}
+
+HOST_TEST(OpusRateLowersComplexityUnderLoad) {
+    OpusRateController controller;
+    OpusEncoderSettings settings;
+    settings.complexity = 3;
+    controller.Configure(Bounds(), settings);
+    // 40ms of encoding per 60ms frame
+    CHECK(RunInterval(controller, settings, 40000, 0));
+    CHECK_EQ(settings.complexity, 2);
+    CHECK(controller.GetStatistics().load_percent > OPUS_RATE_HIGH_LOAD_PERCENT);
+}
+
+HOST_TEST(OpusRateCeilingAppliesImmediately) {
+    OpusRateController controller;
+    OpusEncoderSettings settings;
+    controller.Configure(Bounds(), settings);
+
+    controller.SetBitrateCeiling(12000);
+    CHECK(controller.Update(settings));
+    CHECK_EQ(settings.bitrate, 12000);
+
+    controller.SetBitrateCeiling(0);
+    CHECK(controller.Update(settings));
+    CHECK_EQ(settings.bitrate, OPUS_RATE_INITIAL_BITRATE);
+}
@@ -0,0 +1,97 @@
+#include "host_test.h"
+
+#include "playback_buffering.h"
+#include "time_stretcher.h"
+
+HOST_TEST(PlaybackBufferingWaitsForTarget) {
+    PlaybackBuffering buffering;
+    buffering.StartStream(0);
+    CHECK(buffering.state() == AudioState::BUFFERING);
+    int target = buffering.GetStatistics().target_frames;
+    CHECK(!buffering.IsOutputReady(100000, target - 1, true));
+    CHECK(buffering.state() == AudioState::BUFFERING);
+    CHECK(buffering.IsOutputReady(300000, target, true));
+    CHECK(buffering.state() == AudioState::PLAYING);
+    CHECK_EQ(buffering.GetStatistics().last_time_to_first_audio_ms, 300);
+}
+
+HOST_TEST(PlaybackBufferingRebuffersOnUnderrun) {
+    PlaybackBuffering buffering;
+    buffering.StartStream(0);
+    int target = buffering.GetStatistics().target_frames;
+    CHECK(buffering.IsOutputReady(0, target, true));
+    // Frames still being decoded are not an underrun
+    CHECK(!buffering.IsOutputReady(10000, 1, false));
+    CHECK(buffering.state() == AudioState::PLAYING);
+    CHECK(!buffering.IsOutputReady(20000, 0, false));
+    CHECK(buffering.state() == AudioState::REBUFFERING);
+    CHECK_EQ(buffering.GetStatistics().underruns, 1);
+    int resume = buffering.GetStatistics().target_frames;
+    CHECK(buffering.IsOutputReady(520000, resume, true));
+    CHECK(buffering.state() == AudioState::PLAYING);
+    CHECK_EQ(buffering.GetStatistics().rebuffer_ms, 500);
+}
+
+HOST_TEST(PlaybackBufferingEndStreamDrains) {
+    PlaybackBuffering buffering;
+    buffering.StartStream(0);
+    // Too short to reach the target, the end releases it
+    CHECK(buffering.EndStream(100000));
+    CHECK(buffering.state() == AudioState::PLAYING);
+    CHECK(buffering.IsOutputReady(100000, 1, true));
+    CHECK(!buffering.IsOutputReady(160000, 0, false));
+    CHECK(buffering.state() == AudioState::IDLE);
+    CHECK_EQ(buffering.GetStatistics().underruns, 0);
+    CHECK(!buffering.EndStream(200000));
+}
+
+HOST_TEST(PlaybackBufferingResetKeepsStreamBuffering) {
+    PlaybackBuffering buffering;
+    buffering.StartStream(0);
+    CHECK(buffering.IsOutputReady(0, 20, true));
+    buffering.Reset();
+    CHECK(buffering.state() == AudioState::BUFFERING);
+    buffering.EndStream(0);
+    buffering.Reset();
+    CHECK(buffering.state() == AudioState::IDLE);
+}
+
+HOST_TEST(PlaybackBufferingStretchRatioGlides) {
+    PlaybackBuffering buffering;
+    buffering.StartStream(0);
+    int target = buffering.GetStatistics().target_frames;
+    // Not playing yet: no stretch
+    CHECK(buffering.UpdateStretchRatio(0, 60) == 1.0f);
+    CHECK(buffering.IsOutputReady(0, target, true));
+
+    // Empty buffer asks for the full slow-down, reached 1% per frame
+    float ratio = 1.0f;
+    for (int i = 0; i < 20; i++) {
+        float next = buffering.UpdateStretchRatio(0, 60);
+        CHECK(next - ratio <= 0.0101f);
+        ratio = next;
+    }
+    CHECK(ratio > 1.0f + TIME_STRETCH_MAX_PERCENT / 100.0f - 0.001f);
+
+    // Far above the high water mark speeds up
+    int overfull = target + 2 * TIME_STRETCH_HIGH_WATER_MS / 60;
+    for (int i = 0; i < 40; i++) {
+        ratio = buffering.UpdateStretchRatio(overfull, 60);
+    }
+    CHECK(ratio < 1.0f - TIME_STRETCH_MAX_PERCENT / 100.0f + 0.001f);
+
+    // At the target it returns to exactly 1
+    for (int i = 0; i < 20; i++) {
+        ratio = buffering.UpdateStretchRatio(target, 60);
+    }
+    CHECK(ratio == 1.0f);
+}
+
+HOST_TEST(PlaybackBufferingFixedTarget) {
+    PlaybackBuffering buffering;
+    buffering.SetFixedTarget(30);
+    buffering.StartStream(0);
+    CHECK(!buffering.IsOutputReady(0, 29, true));
+    CHECK(buffering.IsOutputReady(0, 30, true));
+    CHECK(buffering.UpdateStretchRatio(0, 60) == 1.0f);
+}
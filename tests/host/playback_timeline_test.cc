@@ -0,0 +1,48 @@
+#include "host_test.h"
+
+#include "playback_timeline.h"
+
+HOST_TEST(PlaybackTimelineMapsWithinFrame) {
+    PlaybackTimeline timeline;
+    timeline.Configure(24000);
+    // 60ms frames at 24kHz, server timestamps 60ms apart
+    for (int i = 0; i < 5; i++) {
+        timeline.OnFrameWritten(i * 1440ULL, 1440, 1000 + i * 60);
+    }
+    CHECK_EQ(timeline.TimestampAt(0), 1000);
+    CHECK_EQ(timeline.TimestampAt(1440 * 2 + 720), 1120 + 30);
+    CHECK_EQ(timeline.TimestampAt(1440 * 5 - 1), 1000 + 4 * 60 + 59);
+    CHECK_EQ(timeline.GetStatistics().mapped, 3);
+}
+
+HOST_TEST(PlaybackTimelineGapsAreUnmapped) {
+    PlaybackTimeline timeline;
+    timeline.Configure(16000);
+    timeline.OnFrameWritten(0, 960, 500);
+    // A prompt was played in between, it is not part of the server timeline
+    timeline.OnFrameWritten(960 * 3, 960, 560);
+    CHECK_EQ(timeline.TimestampAt(960 + 10), 0);
+    CHECK_EQ(timeline.TimestampAt(960 * 3 + 16), 561);
+    CHECK_EQ(timeline.TimestampAt(960 * 10), 0);
+    CHECK_EQ(timeline.GetStatistics().unmapped, 2);
+}
+
+HOST_TEST(PlaybackTimelineForgetsOldFrames) {
+    PlaybackTimeline timeline;
+    timeline.Configure(16000);
+    for (int i = 0; i < PLAYBACK_TIMELINE_ENTRIES + 4; i++) {
+        timeline.OnFrameWritten(i * 960ULL, 960, 100 + i * 60);
+    }
+    CHECK_EQ(timeline.TimestampAt(0), 0);
+    CHECK_EQ(timeline.TimestampAt(4 * 960), 100 + 4 * 60);
+}
+
+HOST_TEST(PlaybackTimelineScalesStretchedFrames) {
+    PlaybackTimeline timeline;
+    timeline.Configure(16000);
+    // A 60ms frame slowed down to 64.8ms still covers 60ms of the server timeline
+    timeline.OnFrameWritten(0, 1037, 300, 1.08f);
+    CHECK_EQ(timeline.TimestampAt(0), 300);
+    CHECK_EQ(timeline.TimestampAt(864), 300 + 50);
+    CHECK_EQ(timeline.TimestampAt(1036), 300 + 59);
+}
@@ -0,0 +1,107 @@
+#include "host_test.h"
+
+#include "prompt_player.h"
+
+#include <string>
+
+// BinaryProtocol3 frames with payloads of the given sizes
+static std::string MakeSound(std::initializer_list<size_t> sizes) {
+    std::string sound;
+    for (size_t size : sizes) {
+        sound.push_back(0);
+        sound.push_back(0);
+        sound.push_back((char)(size >> 8));
+        sound.push_back((char)(size & 0xff));
+        sound.append(size, (char)size);
+    }
+    return sound;
+}
+
+HOST_TEST(PromptPlayerFramesAndCompletion) {
+    static const std::string sound = MakeSound({10, 20, 30});
+    CHECK_EQ(PromptPlayer::CountFrames(sound), 3);
+
+    PromptPlayer player;
+    int completed = 0;
+    uint32_t id = player.Enqueue(sound, [&](bool done) { completed += done ? 1 : -100; });
+    CHECK(id != 0);
+    CHECK(player.HasFrames());
+
+    PromptFrame frame;
+    size_t sizes[3];
+    bool last = false;
+    for (int i = 0; i < 3; i++) {
+        CHECK(player.NextFrame(frame));
+        CHECK_EQ(frame.id, id);
+        CHECK_EQ(frame.first, i == 0);
+        sizes[i] = frame.size;
+        CHECK_EQ(frame.data[0], frame.size);
+        last = frame.last;
+    }
+    CHECK(last);
+    CHECK_EQ(sizes[0] + sizes[1] + sizes[2], 60);
+    CHECK(!player.HasFrames());
+    CHECK(!player.NextFrame(frame));
+    CHECK(!player.IsIdle());
+
+    player.OnFramePlayed(id, false);
+    CHECK_EQ(completed, 0);
+    player.OnFramePlayed(id, true);
+    CHECK_EQ(completed, 1);
+    CHECK(player.IsIdle());
+    CHECK_EQ(player.GetStatistics().completed, 1);
+}
+
+HOST_TEST(PromptPlayerIgnoresTruncatedTail) {
+    std::string sound = MakeSound({10, 10});
+    sound.append("\0\0\0\x20short", 9);
+    CHECK_EQ(PromptPlayer::CountFrames(sound), 2);
+
+    PromptPlayer player;
+    player.Enqueue(sound);
+    PromptFrame frame;
+    CHECK(player.NextFrame(frame));
+    CHECK(!frame.last);
+    CHECK(player.NextFrame(frame));
+    CHECK(frame.last);
+}
+
+HOST_TEST(PromptPlayerCancelAndReject) {
+    static const std::string sound = MakeSound({8, 8});
+    PromptPlayer player;
+    CHECK_EQ(player.Enqueue(std::string_view()), 0);
+
+    bool result = true;
+    uint32_t first = player.Enqueue(sound, [&](bool done) { result = done; });
+    uint32_t second = player.Enqueue(sound);
+    CHECK(player.Cancel(first));
+    CHECK(!result);
+    CHECK(!player.IsActive(first));
+    CHECK(!player.Cancel(first));
+
+    // The second prompt is read next
+    PromptFrame frame;
+    CHECK(player.NextFrame(frame));
+    CHECK_EQ(frame.id, second);
+
+    for (int i = 1; i < PROMPT_QUEUE_SIZE; i++) {
+        CHECK(player.Enqueue(sound) != 0);
+    }
+    CHECK_EQ(player.Enqueue(sound), 0);
+    CHECK_EQ(player.GetStatistics().rejected, 2);
+
+    player.CancelAll();
+    CHECK(player.IsIdle());
+    CHECK(!player.HasFrames());
+}
+
+HOST_TEST(PromptPlayerSkipRest) {
+    static const std::string sound = MakeSound({8, 8, 8});
+    PromptPlayer player;
+    uint32_t id = player.Enqueue(sound);
+    PromptFrame frame;
+    CHECK(player.NextFrame(frame));
+    player.SkipRest(id);
+    CHECK(!player.HasFrames());
+    CHECK(player.IsActive(id));
+}
@@ -0,0 +1,35 @@
+// Host shim: every capability maps to the C heap, there is no PSRAM
+#ifndef HOST_SHIM_ESP_HEAP_CAPS_H
+#define HOST_SHIM_ESP_HEAP_CAPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_DEFAULT (1 << 12)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_8BIT (1 << 2)
+
+inline void* heap_caps_malloc(size_t size, uint32_t) {
+    return malloc(size);
+}
+
+inline void* heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t) {
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    void* pointer = nullptr;
+    return posix_memalign(&pointer, alignment, size) == 0 ? pointer : nullptr;
+}
+
+inline void heap_caps_free(void* pointer) {
+    free(pointer);
+}
+
+inline size_t heap_caps_get_total_size(uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : SIZE_MAX;
+}
+
+#endif // HOST_SHIM_ESP_HEAP_CAPS_H
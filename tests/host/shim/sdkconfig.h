@@ -0,0 +1,6 @@
+// Host shim: no CONFIG_IDF_TARGET_* is defined, so code that selects a chip-specific path
+// (the ESP32-S3 PIE kernels in audio_dsp.cc) builds its portable one
+#ifndef HOST_SHIM_SDKCONFIG_H
+#define HOST_SHIM_SDKCONFIG_H
+
+#endif // HOST_SHIM_SDKCONFIG_H
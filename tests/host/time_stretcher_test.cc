@@ -0,0 +1,131 @@
+#include "host_test.h"
+
+#include "time_stretcher.h"
+
+#include <cmath>
+#include <cstdlib>
+
+static std::vector<int16_t> Tone(size_t samples, size_t& phase) {
+    std::vector<int16_t> pcm(samples);
+    for (auto& sample : pcm) {
+        sample = (int16_t)(8000 * sin(2 * M_PI * 220 * phase++ / 16000.0));
+    }
+    return pcm;
+}
+
+HOST_TEST(TimeStretcherPassThroughAtUnity) {
+    TimeStretcher stretcher;
+    stretcher.Configure(16000);
+    size_t phase = 0;
+    auto input = Tone(960, phase);
+    auto pcm = input;
+    stretcher.Process(pcm, 1.0f);
+    CHECK(!stretcher.active());
+    CHECK(pcm == input);
+}
+
+// Feeds 60ms frames at a fixed ratio, returns output/input length over the run
+static double MeasureRatio(float ratio) {
+    TimeStretcher stretcher;
+    stretcher.Configure(16000);
+    size_t phase = 0;
+    size_t input = 0;
+    size_t output = 0;
+    for (int i = 0; i < 100; i++) {
+        auto pcm = Tone(960, phase);
+        input += pcm.size();
+        stretcher.Process(pcm, ratio);
+        output += pcm.size();
+    }
+    return double(output) / input;
+}
+
+HOST_TEST(TimeStretcherSlowsDown) {
+    double measured = MeasureRatio(1.05f);
+    CHECK(fabs(measured - 1.05) < 0.01);
+}
+
+HOST_TEST(TimeStretcherSpeedsUp) {
+    double measured = MeasureRatio(0.95f);
+    CHECK(fabs(measured - 0.95) < 0.01);
+}
+
+HOST_TEST(TimeStretcherClampsRatio) {
+    double measured = MeasureRatio(1.5f);
+    CHECK(measured < 1.0 + TIME_STRETCH_MAX_PERCENT / 100.0 + 0.01);
+}
+
+HOST_TEST(TimeStretcherReturnsToPassThrough) {
+    TimeStretcher stretcher;
+    stretcher.Configure(16000);
+    size_t phase = 0;
+    size_t input = 0;
+    size_t output = 0;
+    for (int i = 0; i < 10; i++) {
+        auto pcm = Tone(960, phase);
+        input += pcm.size();
+        stretcher.Process(pcm, 1.04f);
+        output += pcm.size();
+    }
+    CHECK(stretcher.active());
+    // The first unity frame flushes the held look-ahead
+    for (int i = 0; i < 2; i++) {
+        auto pcm = Tone(960, phase);
+        input += pcm.size();
+        stretcher.Process(pcm, 1.0f);
+        output += pcm.size();
+    }
+    CHECK(!stretcher.active());
+    CHECK(output > input);
+
+    auto pcm = Tone(960, phase);
+    auto expected = pcm;
+    stretcher.Process(pcm, 1.0f);
+    CHECK(pcm == expected);
+}
+
+HOST_TEST(TimeStretcherKeepsContinuity) {
+    TimeStretcher stretcher;
+    stretcher.Configure(16000);
+    size_t phase = 0;
+    std::vector<int16_t> output;
+    for (int i = 0; i < 20; i++) {
+        auto pcm = Tone(960, phase);
+        stretcher.Process(pcm, 0.93f);
+        output.insert(output.end(), pcm.begin(), pcm.end());
+    }
+    // A 220Hz tone at 8000 peak changes by at most ~700 per sample, splices must not add clicks
+    int max_step = 0;
+    for (size_t i = 1; i < output.size(); i++) {
+        max_step = std::max(max_step, abs(output[i] - output[i - 1]));
+    }
+    CHECK(max_step < 1500);
+}
+
+HOST_TEST(TimeStretcherReportsOutputPosition) {
+    TimeStretcher stretcher;
+    stretcher.Configure(16000);
+    const int tolerance = 16000 * TIME_STRETCH_TOLERANCE_MS / 1000;
+    size_t phase = 0;
+    // Input position of the next output sample, predicted from the previous output frame. Each
+    // segment may sit up to the search tolerance off its nominal position, so two of them apart
+    double expected = 0;
+    for (int i = 0; i < 30; i++) {
+        auto pcm = Tone(960, phase);
+        float ratio = i < 12 ? 1.06f : i < 24 ? 0.94f : 1.0f;
+        stretcher.Process(pcm, ratio);
+        if (pcm.empty()) {
+            continue;
+        }
+        double position = i * 960.0 + stretcher.output_offset();
+        CHECK(fabs(position - expected) <= 2 * tolerance);
+        CHECK(stretcher.output_offset() <= 0);
+        if (stretcher.active()) {
+            CHECK(stretcher.output_scale() == ratio);
+        }
+        expected = position + pcm.size() / stretcher.output_scale();
+    }
+    CHECK(!stretcher.active());
+    CHECK_EQ(stretcher.output_offset(), 0);
+    CHECK(stretcher.output_scale() == 1.0f);
+}
@@ -0,0 +1,323 @@
+// Replays a downlink packet arrival trace through the jitter buffer and time stretcher in virtual time.
+//
+// Usage: audio_trace_replay <trace> [--fixed <frames>] [--max-underruns <n>] [--no-steady-alloc]
+//
+// Trace format, one event per line, times in ms from the start of the trace:
+//   start <ms>                     AUDIO_START (TTS stream begins)
+//   packet <ms> <frame_ms>         a packet arrives
+//   end <ms>                       AUDIO_END
+// Lines starting with '#' are comments.
+//
+// The buffering state machine and the stretch ratio are PlaybackBuffering, the same code AudioService runs.
+// Decoding is replaced by synthetic PCM of the frame duration, so the CPU figures cover the
+// time stretcher only and are host timings, not ESP32 timings.
+
+#include "playback_buffering.h"
+#include "time_stretcher.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define OUTPUT_SAMPLE_RATE 16000
+// Frames played before allocations count as steady state
+#define WARMUP_FRAMES 50
+
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* pointer = malloc(size > 0 ? size : 1);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+struct TraceEvent {
+    enum Type { kStart, kPacket, kEnd } type;
+    int64_t us;
+    int frame_ms;
+};
+
+static bool LoadTrace(const char* path, std::vector<TraceEvent>& events) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    std::string line;
+    int number = 0;
+    while (std::getline(file, line)) {
+        number++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string type;
+        double ms = 0;
+        int frame_ms = 0;
+        fields >> type >> ms;
+        bool ok = !fields.fail();
+        TraceEvent event{TraceEvent::kStart, (int64_t)(ms * 1000), 0};
+        if (type == "packet") {
+            fields >> frame_ms;
+            ok = ok && !fields.fail() && frame_ms > 0;
+            event.type = TraceEvent::kPacket;
+            event.frame_ms = frame_ms;
+        } else if (type == "end") {
+            event.type = TraceEvent::kEnd;
+        } else if (type != "start") {
+            ok = false;
+        }
+        if (!ok || (!events.empty() && event.us < events.back().us)) {
+            fprintf(stderr, "%s:%d: invalid event: %s\n", path, number, line.c_str());
+            return false;
+        }
+        events.push_back(event);
+    }
+    return true;
+}
+
+struct ReplayOptions {
+    int fixed_frames = 0;       // > 0: fixed prebuffer and no time stretch (the old behaviour)
+};
+
+struct ReplayReport {
+    int streams = 0;
+    int frames = 0;
+    int stretched_frames = 0;
+    std::vector<uint32_t> ttfa_ms;
+    uint32_t underruns = 0;
+    uint32_t rebuffer_ms = 0;
+    uint64_t steady_allocations = 0;
+    int steady_frames = 0;
+    std::vector<int64_t> wait_us;           // arrival -> start of playout, per frame
+    std::vector<int64_t> stretch_cpu_us;    // TimeStretcher::Process() per frame
+};
+
+static int64_t Percentile(std::vector<int64_t> values, int percent) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = (values.size() * percent + 99) / 100;
+    index = std::min(std::max(index, (size_t)1), values.size()) - 1;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+class PlaybackSimulator {
+public:
+    explicit PlaybackSimulator(const ReplayOptions& options) {
+        buffering_.SetFixedTarget(options.fixed_frames);
+        stretcher_.Configure(OUTPUT_SAMPLE_RATE);
+        // Playback tasks come from the pool with this much PCM reserved
+        pcm_.reserve(OPUS_FRAME_DURATION_MS * OUTPUT_SAMPLE_RATE / 1000 * (100 + TIME_STRETCH_MAX_PERCENT) / 100);
+    }
+
+    ReplayReport Run(const std::vector<TraceEvent>& events) {
+        size_t next = 0;
+        int64_t now = 0;
+        while (true) {
+            Output(now);
+            int64_t wake = INT64_MAX;
+            if (next < events.size()) {
+                wake = events[next].us;
+            }
+            if (busy_until_ > now) {
+                wake = std::min(wake, busy_until_);
+            }
+            if (wake == INT64_MAX) {
+                break;
+            }
+            now = wake;
+            while (next < events.size() && events[next].us <= now) {
+                Handle(events[next++]);
+            }
+        }
+
+        auto stats = buffering_.GetStatistics();
+        report_.underruns = stats.underruns;
+        report_.rebuffer_ms = stats.rebuffer_ms;
+        return report_;
+    }
+
+private:
+    struct Frame {
+        int64_t arrival_us;
+        int frame_ms;
+    };
+
+    void Handle(const TraceEvent& event) {
+        switch (event.type) {
+        case TraceEvent::kStart:
+            buffering_.StartStream(event.us);
+            report_.streams++;
+            break;
+        case TraceEvent::kPacket:
+            buffering_.OnPacketArrival(event.us, event.frame_ms);
+            frame_ms_ = event.frame_ms;
+            queue_.push_back({event.us, event.frame_ms});
+            break;
+        case TraceEvent::kEnd:
+            buffering_.EndStream(event.us);
+            RecordFirstAudio();
+            break;
+        }
+    }
+
+    // The jitter buffer counts a stream once its first frame is released
+    void RecordFirstAudio() {
+        auto stats = buffering_.GetStatistics();
+        if (stats.streams > started_streams_) {
+            started_streams_ = stats.streams;
+            report_.ttfa_ms.push_back(stats.last_time_to_first_audio_ms);
+        }
+    }
+
+    // Speech-like test signal: two harmonics under a syllable-rate envelope
+    void Synthesize(std::vector<int16_t>& pcm, int frame_ms) {
+        pcm.resize(OUTPUT_SAMPLE_RATE * frame_ms / 1000);
+        for (auto& sample : pcm) {
+            double t = (double)phase_++ / OUTPUT_SAMPLE_RATE;
+            double envelope = 0.5 + 0.5 * sin(2 * M_PI * 4 * t);
+            sample = (int16_t)(6000 * envelope * (sin(2 * M_PI * 180 * t) + 0.5 * sin(2 * M_PI * 720 * t)));
+        }
+    }
+
+    // AudioOutputTask(): plays frames back to back while the output is ready. There is no separate
+    // decode queue, a frame is decoded and stretched as it is taken.
+    void Output(int64_t now) {
+        while (busy_until_ <= now) {
+            bool ready = buffering_.IsOutputReady(now, queue_.size(), !queue_.empty());
+            RecordFirstAudio();
+            if (!ready) {
+                break;
+            }
+            Frame frame = queue_.front();
+            float ratio = buffering_.UpdateStretchRatio(queue_.size(), frame_ms_);
+            queue_.pop_front();
+
+            Synthesize(pcm_, frame.frame_ms);
+            bool steady = report_.frames >= WARMUP_FRAMES;
+            uint64_t allocated = allocations.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            stretcher_.Process(pcm_, ratio);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            if (steady) {
+                report_.steady_allocations += allocations.load(std::memory_order_relaxed) - allocated;
+                report_.steady_frames++;
+            }
+            report_.stretch_cpu_us.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1000);
+
+            report_.frames++;
+            if (ratio != 1.0f) {
+                report_.stretched_frames++;
+            }
+            report_.wait_us.push_back(now - frame.arrival_us);
+            buffering_.OnFramePlayed();
+            // A frame held back as look-ahead takes no time, the next one is taken right away
+            busy_until_ = now + (int64_t)pcm_.size() * 1000000 / OUTPUT_SAMPLE_RATE;
+        }
+    }
+
+    PlaybackBuffering buffering_;
+    TimeStretcher stretcher_;
+    std::deque<Frame> queue_;
+    std::vector<int16_t> pcm_;
+    uint32_t started_streams_ = 0;
+    int frame_ms_ = JITTER_BUFFER_DEFAULT_FRAME_MS;
+    int64_t busy_until_ = 0;
+    uint64_t phase_ = 0;
+    ReplayReport report_;
+};
+
+static void PrintReport(const char* trace, const ReplayOptions& options, const ReplayReport& report) {
+    if (options.fixed_frames > 0) {
+        printf("trace: %s (fixed prebuffer of %d frames, no time stretch)\n", trace, options.fixed_frames);
+    } else {
+        printf("trace: %s (adaptive)\n", trace);
+    }
+    printf("  streams %d, frames %d, stretched %d (%.1f%%)\n", report.streams, report.frames, report.stretched_frames,
+           report.frames > 0 ? 100.0 * report.stretched_frames / report.frames : 0.0);
+    printf("  underruns %u, rebuffering %u ms\n", report.underruns, report.rebuffer_ms);
+    printf("  time to first audio (ms):");
+    for (uint32_t ttfa : report.ttfa_ms) {
+        printf(" %u", ttfa);
+    }
+    printf("\n");
+    printf("  arrival to playout: p50 %lld ms, p95 %lld ms, max %lld ms\n",
+           (long long)Percentile(report.wait_us, 50) / 1000, (long long)Percentile(report.wait_us, 95) / 1000,
+           (long long)Percentile(report.wait_us, 100) / 1000);
+    printf("  stretcher cpu per frame (host): p50 %lld us, p95 %lld us, max %lld us\n",
+           (long long)Percentile(report.stretch_cpu_us, 50), (long long)Percentile(report.stretch_cpu_us, 95),
+           (long long)Percentile(report.stretch_cpu_us, 100));
+    printf("  steady-state allocations: %llu over %d frames\n", (unsigned long long)report.steady_allocations,
+           report.steady_frames);
+}
+
+int main(int argc, char* argv[]) {
+    const char* trace = nullptr;
+    ReplayOptions options;
+    int max_underruns = -1;
+    bool no_steady_alloc = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--fixed") == 0 && i + 1 < argc) {
+            options.fixed_frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-underruns") == 0 && i + 1 < argc) {
+            max_underruns = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-steady-alloc") == 0) {
+            no_steady_alloc = true;
+        } else if (trace == nullptr && argv[i][0] != '-') {
+            trace = argv[i];
+        } else {
+            trace = nullptr;
+            break;
+        }
+    }
+    if (trace == nullptr) {
+        fprintf(stderr, "Usage: %s <trace> [--fixed <frames>] [--max-underruns <n>] [--no-steady-alloc]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<TraceEvent> events;
+    if (!LoadTrace(trace, events)) {
+        return 1;
+    }
+    PlaybackSimulator simulator(options);
+    ReplayReport report = simulator.Run(events);
+    PrintReport(trace, options, report);
+
+    int result = 0;
+    if (report.frames == 0) {
+        fprintf(stderr, "No frames played\n");
+        result = 2;
+    }
+    if (max_underruns >= 0 && (int)report.underruns > max_underruns) {
+        fprintf(stderr, "%u underruns, expected at most %d\n", report.underruns, max_underruns);
+        result = 2;
+    }
+    if (no_steady_alloc && report.steady_allocations > 0) {
+        fprintf(stderr, "%llu allocations in steady state\n", (unsigned long long)report.steady_allocations);
+        result = 2;
+    }
+    return result;
+}
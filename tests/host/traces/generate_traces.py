@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+'''
+  Generate the synthetic arrival traces used by audio_trace_replay.
+
+  Each trace holds a few TTS replies. The server sends the first packets
+  of a reply faster than real time, then paces at the frame rate. The
+  network adds per-packet jitter plus occasional stalls during which the
+  packets queue up and arrive back to back. The seed is fixed, so the
+  output is reproducible.
+
+  Recorded traces can be replayed the same way once converted to the
+  format below (see trace_replay.cc):
+    start <ms> / packet <ms> <frame_ms> / end <ms>
+'''
+import argparse
+import os
+import random
+
+PROFILES = {
+    # Home Wi-Fi: small jitter, rare short stalls
+    'wifi': dict(jitter_ms=8, stall_probability=0.01, stall_ms=(80, 200)),
+    # 4G: larger jitter and longer stalls during handovers
+    'lte': dict(jitter_ms=35, stall_probability=0.03, stall_ms=(300, 900)),
+}
+
+
+def generate(profile, frame_ms, replies, seed):
+    rng = random.Random(seed)
+    events = []
+    now = 0.0
+    for _ in range(replies):
+        now += rng.uniform(1500, 3000)
+        events.append((now, 'start'))
+        # Server side: first audio after the TTS latency, then a burst, then real time
+        send = now + rng.uniform(200, 400)
+        frames = int(rng.uniform(4000, 9000) / frame_ms)
+        burst = int(600 / frame_ms)
+        network_free = 0.0
+        last = send
+        for i in range(frames):
+            send += frame_ms * (0.25 if i < burst else 1.0)
+            arrival = send + 30 + abs(rng.gauss(0, profile['jitter_ms']))
+            if rng.random() < profile['stall_probability']:
+                network_free = send + rng.uniform(*profile['stall_ms'])
+            # Packets stalled by the network are delivered in order once it recovers
+            arrival = max(arrival, network_free, last)
+            last = arrival
+            events.append((arrival, 'packet'))
+        now = last + 20
+        events.append((now, 'end'))
+        now = last + rng.uniform(500, 1500)
+    return events
+
+
+def write(path, name, frame_ms, events):
+    with open(path, 'w') as f:
+        f.write(f'# Synthetic {name} trace, {frame_ms} ms frames, generated by generate_traces.py\n')
+        for time_ms, kind in events:
+            if kind == 'packet':
+                f.write(f'packet {time_ms:.1f} {frame_ms}\n')
+            else:
+                f.write(f'{kind} {time_ms:.1f}\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate synthetic downlink arrival traces')
+    parser.add_argument('--output', default=os.path.dirname(os.path.abspath(__file__)))
+    parser.add_argument('--replies', type=int, default=4)
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    for name, profile in PROFILES.items():
+        for frame_ms in (60, 20):
+            events = generate(profile, frame_ms, args.replies, args.seed)
+            path = os.path.join(args.output, f'{name}_{frame_ms}ms.trace')
+            write(path, name, frame_ms, events)
+            print(f'{path}: {sum(1 for e in events if e[1] == "packet")} packets')
+
+
+if __name__ == '__main__':
+    main()